@@ -0,0 +1,456 @@
+// 参数解析框架的性能测试程序
+//
+// 通过替换全局的 `operator new` / `operator delete` 统计内存分配次数，用于验证：
+// - 反复解析时，内存占用是平稳的（存活的内存块数量不随解析次数增长）；
+// - 反复解析时，单次解析的耗时是恒定的（不随解析次数增长）。
+//
+// 运行方式：编译后在工程的根目录下执行 `./scripts/run_all_bench.sh`，
+// 任意一项检查不通过时，程序返回非零值。
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "argparse.h"
+
+using namespace zul;
+
+static std::atomic<uint64_t> g_alloc_count{0};
+static std::atomic<uint64_t> g_free_count{0};
+
+void *operator new(size_t size)
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr != nullptr) {
+        g_free_count.fetch_add(1, std::memory_order_relaxed);
+        free(ptr);
+    }
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+// `std::pmr::new_delete_resource` 通过带对齐参数的版本分配，也需要统计
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    void *ptr = aligned_alloc(align, (size + align - 1) / align * align);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+    if (ptr != nullptr) {
+        g_free_count.fetch_add(1, std::memory_order_relaxed);
+        free(ptr);
+    }
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t alignment) noexcept { operator delete(ptr, alignment); }
+
+namespace {
+
+// 当前存活（已分配未释放）的内存块数量
+int64_t live_allocations()
+{
+    return static_cast<int64_t>(g_alloc_count.load() - g_free_count.load());
+}
+
+// 一个较大的命令：`option_count` 个参数（长短名字、各种类型混合），外加一个子命令
+std::shared_ptr<Command> make_big_command(int option_count, std::vector<std::string> &names)
+{
+    auto cmd = Command::new_command("bench")->usage("bench usage");
+    names.reserve(option_count);
+    for (int i = 0; i < option_count; i++) {
+        names.push_back("option_" + std::to_string(i));
+    }
+    for (int i = 0; i < option_count; i++) {
+        ArgType type = i % 3 == 0 ? ArgType::FLAG : ArgType::OPTIONAL;
+        auto arg = Arg::new_arg(type)->long_name(names[i].c_str());
+        if (i < 26) {
+            arg->short_name(static_cast<char>('A' + i));
+        }
+        if (type == ArgType::OPTIONAL && i % 3 == 1) {
+            arg->range(NumType::INT, "0", "1000000");
+        }
+        if (type == ArgType::OPTIONAL && i % 3 == 2) {
+            arg->default_value("42");
+        }
+        cmd->arg(arg);
+    }
+    cmd->subcommand(Command::new_command("run")
+                        ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("target"))
+                        ->arg(Arg::new_arg(ArgType::POSITION)));
+    return cmd;
+}
+
+// 同上，但命令和参数都分配在 `arena` 中
+CommandRef make_big_arena_command(SchemaArena &arena, int option_count, const std::vector<std::string> &names)
+{
+    CommandRef cmd = arena.new_command("bench").usage("bench usage");
+    for (int i = 0; i < option_count; i++) {
+        ArgType type = i % 3 == 0 ? ArgType::FLAG : ArgType::OPTIONAL;
+        ArgRef arg = arena.new_arg(type).long_name(names[i].c_str());
+        if (i < 26) {
+            arg.short_name(static_cast<char>('A' + i));
+        }
+        if (type == ArgType::OPTIONAL && i % 3 == 1) {
+            arg.range(NumType::INT, "0", "1000000");
+        }
+        if (type == ArgType::OPTIONAL && i % 3 == 2) {
+            arg.default_value("42");
+        }
+        cmd.arg(arg);
+    }
+    cmd.subcommand(arena.new_command("run")
+                       .arg(arena.new_arg(ArgType::REQUIRED).long_name("target"))
+                       .arg(arena.new_arg(ArgType::POSITION)));
+    return cmd;
+}
+
+struct RoundResult {
+    double ns_per_parse;
+    double allocs_per_parse;
+    int64_t live_allocations;
+};
+
+// 反复执行 `parse_once`，记录每一轮的单次耗时、单次内存分配次数以及该轮结束后存活的内存块数量
+std::vector<RoundResult> run_soak(const std::function<void()> &parse_once, int rounds, int parses_per_round)
+{
+    for (int i = 0; i < parses_per_round / 10; i++) {
+        parse_once();
+    }
+    // 预先分配好，避免统计结果本身的内存分配干扰存活内存块数量的统计
+    std::vector<RoundResult> results;
+    results.reserve(rounds);
+    for (int r = 0; r < rounds; r++) {
+        uint64_t alloc_before = g_alloc_count.load();
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < parses_per_round; i++) {
+            parse_once();
+        }
+        auto end = std::chrono::steady_clock::now();
+        uint64_t alloc_after = g_alloc_count.load();
+        double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+        results.push_back(RoundResult{ns / parses_per_round,
+                                      static_cast<double>(alloc_after - alloc_before) / parses_per_round,
+                                      live_allocations()});
+    }
+    return results;
+}
+
+// 检查内存平稳、耗时恒定，并打印每一轮的数据
+bool report_soak(const char *name, const std::vector<RoundResult> &results)
+{
+    std::printf("\n[%s]\n", name);
+    std::printf("%8s %14s %16s %18s\n", "round", "ns/parse", "allocs/parse", "live allocations");
+    for (size_t r = 0; r < results.size(); r++) {
+        std::printf("%8zu %14.1f %16.2f %18lld\n", r, results[r].ns_per_parse, results[r].allocs_per_parse,
+                    static_cast<long long>(results[r].live_allocations));
+    }
+
+    bool ok = true;
+    // 内存平稳：每一轮结束后存活的内存块数量都相同，且每次解析的分配次数不变
+    for (const auto &result : results) {
+        if (result.live_allocations != results.front().live_allocations ||
+            result.allocs_per_parse != results.front().allocs_per_parse) {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        std::printf("FAILED: memory is not flat across rounds\n");
+        return false;
+    }
+
+    // 耗时恒定：最后三轮的平均耗时不超过前三轮平均耗时的 1.5 倍（留出测量噪声的余量）
+    size_t window = std::min<size_t>(3, results.size());
+    double head = 0, tail = 0;
+    for (size_t i = 0; i < window; i++) {
+        head += results[i].ns_per_parse;
+        tail += results[results.size() - 1 - i].ns_per_parse;
+    }
+    if (tail > head * 1.5) {
+        std::printf("FAILED: parse time grows across rounds (%.1f ns -> %.1f ns)\n", head / window, tail / window);
+        return false;
+    }
+    std::printf("PASSED: flat memory and constant time\n");
+    return true;
+}
+
+}  // namespace
+
+int main()
+{
+    constexpr int option_count = 200;
+    constexpr int rounds = 10;
+    constexpr int parses_per_round = 20000;
+
+    std::vector<std::string> names;
+    auto cmd = make_big_command(option_count, names);
+
+    std::vector<std::string> storage;
+    std::vector<const char *> argv{"bench"};
+    for (int i = 0; i < option_count; i += 10) {
+        storage.push_back("--" + names[i]);
+        if (i % 3 != 0) {
+            storage.push_back(std::to_string(i));
+        }
+    }
+    storage.push_back("-B");
+    storage.push_back("7");
+    storage.push_back("run");
+    storage.push_back("--target=all");
+    storage.push_back("file.txt");
+    for (const auto &elem : storage) {
+        argv.push_back(elem.c_str());
+    }
+
+    bool ok = true;
+
+    // 兼容接口：`parse_args` 把结果保存在命令中，反复调用不能导致命令内部的表增长
+    ok &= report_soak("parse_args (steady-state reparse)",
+                      run_soak(
+                          [&]() {
+                              cmd->parse_args(std::vector<const char *>(argv));
+                              if (cmd->get_one_value<int>('B') != 7) {
+                                  std::abort();
+                              }
+                          },
+                          rounds, parses_per_round));
+
+    // 线程安全接口：每次返回独立的 `ParseResult`
+    ok &= report_soak("parse (independent ParseResult)",
+                      run_soak(
+                          [&]() {
+                              ParseResult result = cmd->parse(argv);
+                              if (result.get_subcommand().get_one_value<std::string_view>("target") != "all") {
+                                  std::abort();
+                              }
+                          },
+                          rounds, parses_per_round));
+
+    // 内存资源：解析结果从栈上缓冲区分配，每次解析后一次性丢弃，不应该使用全局的堆
+    static unsigned char buffer[64 * 1024];
+    std::vector<RoundResult> resource_parse = run_soak(
+        [&]() {
+            std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+            ParseResult result = cmd->parse(static_cast<int>(argv.size()), argv.data(), &resource);
+            if (result.get_subcommand().get_one_value<std::string_view>("target") != "all") {
+                std::abort();
+            }
+        },
+        rounds, parses_per_round);
+    ok &= report_soak("parse (monotonic_buffer_resource)", resource_parse);
+    if (resource_parse.front().allocs_per_parse != 0) {
+        std::printf("FAILED: parse with a memory resource should not allocate from the global heap\n");
+        ok = false;
+    }
+
+    // 取值：反复从同一个 `ParseResult` 中取出所有数值参数的值，数值转换不应该有任何内存分配
+    ParseResult fetched = cmd->parse(argv);
+    ok &= report_soak("get_one_value (numeric conversion)",
+                      run_soak(
+                          [&]() {
+                              int64_t sum = 0;
+                              for (int i = 2; i < option_count; i += 3) {
+                                  sum += fetched.get_one_value<int>(names[i].c_str());
+                                  sum += static_cast<int64_t>(fetched.get_one_value<double>(names[i].c_str()));
+                              }
+                              if (sum == 0) {
+                                  std::abort();
+                              }
+                          },
+                          rounds, parses_per_round / 10));
+
+    // 拒绝非法输入：`parse` 抛出异常并格式化错误信息，`try_parse` 只返回错误记录，后者不应该有任何内存分配
+    std::vector<const char *> rejected_argv(argv);
+    // `--option_10` 的值超出取值范围
+    rejected_argv[3] = "2000000";
+    ParseResult rejected;
+    std::vector<RoundResult> throw_reject = run_soak(
+        [&]() {
+            try {
+                cmd->parse(rejected_argv, rejected);
+                std::abort();
+            } catch (const ParseArgsError &) {
+            }
+        },
+        rounds, parses_per_round);
+    std::vector<RoundResult> status_reject = run_soak(
+        [&]() {
+            if (cmd->try_parse(rejected_argv, rejected).code != ParseErrorCode::OUT_OF_RANGE) {
+                std::abort();
+            }
+        },
+        rounds, parses_per_round);
+    // 收集所有错误：错误列表预先分配好，一次解析报告全部错误，同样不应该有任何内存分配
+    std::vector<const char *> multi_rejected_argv(rejected_argv);
+    // 再加上 `--option_40` 的值超出取值范围，以及一个未知的参数
+    multi_rejected_argv[8] = "-1";
+    multi_rejected_argv.insert(multi_rejected_argv.begin() + 1, "--unknown");
+    ParseErrorList errors;
+    std::vector<RoundResult> multi_reject = run_soak(
+        [&]() {
+            if (cmd->try_parse_all(multi_rejected_argv, rejected, errors) || errors.size() != 3) {
+                std::abort();
+            }
+        },
+        rounds, parses_per_round);
+    ok &= report_soak("reject (parse, exception)", throw_reject);
+    ok &= report_soak("reject (try_parse, status code)", status_reject);
+    ok &= report_soak("reject (try_parse_all, 3 errors)", multi_reject);
+    std::printf("ns per rejection: exception %.1f, status code %.1f\n", throw_reject.front().ns_per_parse,
+                status_reject.front().ns_per_parse);
+    if (status_reject.front().allocs_per_parse != 0 || multi_reject.front().allocs_per_parse != 0) {
+        std::printf("FAILED: try_parse and try_parse_all should not allocate when rejecting an input\n");
+        ok = false;
+    }
+
+    // 解析结果缓存：命中时跳过整个解析过程，也不应该有任何内存分配
+    cmd->enable_parse_cache(64);
+    std::vector<RoundResult> cached_parse = run_soak(
+        [&]() {
+            std::shared_ptr<const ParseResult> result = cmd->cached_parse(argv);
+            if (result->get_one_value<int>('B') != 7) {
+                std::abort();
+            }
+        },
+        rounds, parses_per_round);
+    ok &= report_soak("cached_parse (hit)", cached_parse);
+    if (cached_parse.front().allocs_per_parse != 0) {
+        std::printf("FAILED: cached_parse should not allocate on a cache hit\n");
+        ok = false;
+    }
+    cmd->enable_parse_cache(0);
+
+    // 持久化的解析结果缓存：命中时同样不分配内存；每次重新打开缓存文件再命中，模拟一次新的进程启动
+    {
+        std::string path = "/tmp/bench_argparse_cache_" + std::to_string(getpid());
+        unlink(path.c_str());
+        unlink((path + ".key").c_str());
+        PersistentParseCache cache(path.c_str());
+        ParseResult result;
+        cache.parse(*cmd, static_cast<int>(argv.size()), argv.data(), result);
+        std::vector<RoundResult> persistent_hit = run_soak(
+            [&]() {
+                cache.parse(*cmd, static_cast<int>(argv.size()), argv.data(), result);
+                if (result.get_one_value<int>('B') != 7) {
+                    std::abort();
+                }
+            },
+            rounds, parses_per_round);
+        ok &= report_soak("PersistentParseCache (hit)", persistent_hit);
+        if (persistent_hit.front().allocs_per_parse != 0) {
+            std::printf("FAILED: PersistentParseCache should not allocate on a cache hit\n");
+            ok = false;
+        }
+        std::vector<RoundResult> persistent_open = run_soak(
+            [&]() {
+                PersistentParseCache reopened(path.c_str());
+                reopened.parse(*cmd, static_cast<int>(argv.size()), argv.data(), result);
+                if (result.get_one_value<int>('B') != 7) {
+                    std::abort();
+                }
+            },
+            rounds, 100);
+        ok &= report_soak("PersistentParseCache (open + hit)", persistent_open);
+        // 同一个参数列表不经过缓存直接解析，与命中时的耗时对比
+        std::vector<RoundResult> plain_parse = run_soak(
+            [&]() {
+                cmd->parse(static_cast<int>(argv.size()), argv.data(), result);
+                if (result.get_one_value<int>('B') != 7) {
+                    std::abort();
+                }
+            },
+            rounds, parses_per_round);
+        double hit_ns = persistent_hit.back().ns_per_parse;
+        double parse_ns = plain_parse.back().ns_per_parse;
+        std::printf("persistent cache: hit %.2f us, parse %.2f us (%.2fx), open + hit %.2f us, %llu hits\n",
+                    hit_ns / 1000, parse_ns / 1000, parse_ns / hit_ns, persistent_open.back().ns_per_parse / 1000,
+                    static_cast<unsigned long long>(cache.stats().hits));
+        unlink(path.c_str());
+        unlink((path + ".key").c_str());
+    }
+
+    // 批量解析：同一批参数列表分别用 1 个线程和所有核并行解析，内存平稳并打印吞吐量的加速比
+    {
+        constexpr size_t batch_size = 1024;
+        std::vector<std::vector<const char *>> batch(batch_size, argv);
+        for (size_t i = 0; i < batch_size; i += 8) {
+            batch[i] = rejected_argv;
+        }
+        size_t core_count = std::max(1U, std::thread::hardware_concurrency());
+        const size_t batch_threads[2] = {1, core_count};
+        double batch_ns[2] = {0, 0};
+        for (int t = 0; t < 2; t++) {
+            size_t thread_count = batch_threads[t];
+            BatchParser parser(*cmd, thread_count);
+            std::vector<RoundResult> batch_parse = run_soak(
+                [&]() {
+                    if (parser.parse(batch) != batch_size - batch_size / 8) {
+                        std::abort();
+                    }
+                },
+                rounds, 10);
+            std::string name = "BatchParser (" + std::to_string(thread_count) + " threads, per batch)";
+            ok &= report_soak(name.c_str(), batch_parse);
+            batch_ns[t] = batch_parse.back().ns_per_parse;
+        }
+        std::printf("batch throughput on %zu cores: %.0f argv/s -> %.0f argv/s (%.2fx)\n", core_count,
+                    batch_size * 1e9 / batch_ns[0], batch_size * 1e9 / batch_ns[1], batch_ns[0] / batch_ns[1]);
+    }
+
+    // 构造命令：`shared_ptr` 对象图与 `SchemaArena` 对比，后者的内存分配次数应该更少
+    constexpr int constructs_per_round = 200;
+    std::vector<RoundResult> shared_construct = run_soak(
+        [&]() {
+            std::vector<std::string> local_names;
+            if (make_big_command(option_count, local_names)->compile() == nullptr) {
+                std::abort();
+            }
+        },
+        rounds, constructs_per_round);
+    std::vector<RoundResult> arena_construct = run_soak(
+        [&]() {
+            SchemaArena arena;
+            if (!make_big_arena_command(arena, option_count, names).compile().get().is_compiled()) {
+                std::abort();
+            }
+        },
+        rounds, constructs_per_round);
+    ok &= report_soak("construct (shared_ptr)", shared_construct);
+    ok &= report_soak("construct (SchemaArena)", arena_construct);
+    // `make_big_command` 还会为 `local_names` 分配一次内存（名字都很短，字符串本身不分配内存）
+    double shared_allocs = shared_construct.front().allocs_per_parse - 1;
+    double arena_allocs = arena_construct.front().allocs_per_parse;
+    std::printf("allocations per construction: shared_ptr %.0f, SchemaArena %.0f\n", shared_allocs, arena_allocs);
+    if (arena_allocs >= shared_allocs) {
+        std::printf("FAILED: SchemaArena should allocate less than shared_ptr\n");
+        ok = false;
+    }
+
+    std::printf("\n%s\n", ok ? "All benchmarks passed." : "Some benchmarks failed!");
+    return ok ? 0 : 1;
+}
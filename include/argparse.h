@@ -18,22 +18,28 @@
 #ifndef ARGPARSE_HEADER_
 #define ARGPARSE_HEADER_
 
-#include <getopt.h>
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <exception>
+#include <initializer_list>
 #include <iostream>
 #include <limits>
 #include <map>
 #include <memory>
-#include <set>
+#include <memory_resource>
+#include <mutex>
+#include <new>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <system_error>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace zul {  // zul = Zhang Dongyu's utils library.
@@ -44,12 +50,20 @@ namespace zul {  // zul = Zhang Dongyu's utils library.
                               std::is_same<int, T>::value || std::is_same<uint32_t, T>::value ||                   \
                                   std::is_same<int64_t, T>::value || std::is_same<uint64_t, T>::value ||           \
                                   std::is_same<float, T>::value || std::is_same<double, T>::value ||               \
-                                  std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value, \
+                                  std::is_same<T, std::string>::value ||                                           \
+                                  std::is_same<T, std::string_view>::value || std::is_enum<T>::value,              \
                               int>::type = 0>
 
 // 参数解析框架内部使用，使用者不应该调用
+class Arg;
+class Command;
+class ParseResult;
+class PersistentParseCache;
+
 namespace internel {
 
+class ErrorSink;
+
 // 唯一配置项（根据实际需求进行配置）
 // - 如果 `config_exit_when_error == true`，则解析到非法参数时直接退出程序，一般应该用这种模式。
 // - 如果 `config_exit_when_error == false`，则解析到非法参数时抛出异常。
@@ -59,55 +73,536 @@ namespace internel {
 constexpr bool config_exit_when_error = false;
 
 // 解析失败时根据 `config_exit_when_error` 的值打印错误信息或抛出类型为 `ParseArgsError` 的异常
+// 错误信息由调用者在局部的 `error_msg` 中构造，不使用任何全局状态，因此可以在多个线程中同时使用
 void exit_or_throw(std::stringstream &error_msg);
 
-// 记录参数解析过程中遇到的错误信息，解析失败时会打印
-extern std::stringstream error_msg;
-
+// 支持与 `std::string_view` 进行异构比较，以便在不构造临时字符串的情况下按名字（或名字前缀）查找
 struct CStrCmp {
+    using is_transparent = void;
     bool operator()(const char *s1, const char *s2) const { return strcmp(s1, s2) < 0; }
+    bool operator()(std::string_view s1, const char *s2) const { return s1 < std::string_view(s2); }
+    bool operator()(const char *s1, std::string_view s2) const { return std::string_view(s1) < s2; }
+};
+
+// 静态命令（`StaticCommand`）的描述不合法时报错
+// 此函数不是 `constexpr` 的，在编译期构造静态命令时调用到它会导致编译失败，错误信息就是参数 `message`
+void static_schema_error(const char *message);
+
+// 计算名字的哈希值（64 位 FNV-1a），可在编译期计算
+constexpr uint64_t hash_name(std::string_view name, uint64_t seed = 0)
+{
+    uint64_t hash = 14695981039346656037ULL ^ seed;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// 完美哈希表，在命令编译时一次性构建，之后只读，用于按名字查找对应的值（例如参数的下标）
+// 采用 CHD（Compress, Hash and Displace）算法：先把所有名字按哈希值分到若干个桶中，再为每个桶找到一组位移值，
+// 使所有名字都落到互不冲突的槽位上。查找时只需计算一次哈希、读取一次位移值、比较一次名字（先比较预先计算好的
+// 长度，再比较内容），没有任何树节点或链表的遍历。
+// 表中只保存名字的指针，名字本身的生命周期需要长于哈希表。
+class PerfectHashTable {
+   public:
+    // 构建哈希表，`values[i]` 是 `names[i]` 对应的值
+    // `names` 中有重复的名字时返回 `false`
+    bool build(const std::vector<std::string_view> &names, const std::vector<int32_t> &values);
+
+    // 查找名字对应的值，找不到时返回 -1
+    int32_t find(std::string_view name) const
+    {
+        if (slots_.empty()) {
+            return -1;
+        }
+        return find(name, hash_name(name, seed_));
+    }
+
+    // 使用预先计算好的哈希值（`hash_name(name, seed())`）查找名字对应的值，找不到时返回 -1
+    int32_t find(std::string_view name, uint64_t hash) const
+    {
+        if (slots_.empty()) {
+            return -1;
+        }
+        const Slot &slot = slots_[slot_index(hash, displacements_[bucket_index(hash)])];
+        if (slot.length == name.size() && slot.value >= 0 && memcmp(slot.name, name.data(), name.size()) == 0) {
+            return slot.value;
+        }
+        return -1;
+    }
+
+    uint64_t seed() const { return seed_; }
+    size_t size() const { return size_; }
+
+   private:
+    struct Slot {
+        const char *name = nullptr;
+        uint32_t length = 0;  // 预先计算好的名字长度，比较时先比较长度
+        int32_t value = -1;
+    };
+
+    struct Displacement {
+        uint32_t d0 = 0;
+        uint32_t d1 = 0;
+    };
+
+    uint32_t bucket_index(uint64_t hash) const
+    {
+        uint32_t mixed = static_cast<uint32_t>((hash * 0x9E3779B97F4A7C15ULL) >> 32);
+        return mixed % static_cast<uint32_t>(displacements_.size());
+    }
+
+    uint32_t slot_index(uint64_t hash, const Displacement &displacement) const
+    {
+        uint32_t h1 = static_cast<uint32_t>(hash);
+        uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+        return (h1 + displacement.d0 * h2 + displacement.d1) & slot_mask_;
+    }
+
+    bool try_build(const std::vector<std::string_view> &names, const std::vector<int32_t> &values,
+                   uint32_t slot_count);
+
+    uint64_t seed_ = 0;
+    uint32_t slot_mask_ = 0;
+    size_t size_ = 0;
+    std::vector<Displacement> displacements_;
+    std::vector<Slot> slots_;
+};
+
+// 压缩前缀树（基数树），在命令编译时一次性构建，之后只读，用于按名字或名字的无歧义前缀查找对应的值
+// 每个节点的边标签是一段连续的字符，同一节点的子节点连续存放并按首字符排序，节点记录了其子树中唯一的值
+// （子树中有多个值时为 `AMBIGUOUS`），因此查找的时间只与名字的长度有关，与树中名字的个数无关。
+// 表中的标签是名字的拷贝，不依赖名字本身的生命周期。
+class RadixTrie {
+   public:
+    // 找不到名字
+    static constexpr int32_t NOT_FOUND = -1;
+    // 名字是多个名字的前缀，无法确定唯一的值
+    static constexpr int32_t AMBIGUOUS = -2;
+
+    // 构建前缀树，`values[i]` 是 `names[i]` 对应的值，值必须是非负数
+    // `names` 中有重复的名字时返回 `false`
+    bool build(const std::vector<std::string_view> &names, const std::vector<int32_t> &values);
+
+    // 查找名字对应的值：名字完全匹配时返回其值；否则名字是唯一一个名字的前缀时返回该名字的值；
+    // 名字是多个名字的前缀时返回 `AMBIGUOUS`，其它情况返回 `NOT_FOUND`
+    int32_t find_prefix(std::string_view prefix) const;
+
+    // 按字典序收集所有以 `prefix` 为前缀的名字对应的值，用于生成有歧义时的错误信息
+    void collect(std::string_view prefix, std::vector<int32_t> &values) const;
+
+    size_t size() const { return size_; }
+
+   private:
+    struct Node {
+        uint32_t label_offset = 0;  // 边标签在 `labels_` 中的位置
+        uint32_t label_length = 0;
+        uint32_t first_child = 0;  // 子节点在 `nodes_` 中连续存放
+        uint32_t child_count = 0;
+        int32_t value = NOT_FOUND;         // 以此节点结尾的名字对应的值
+        int32_t unique_value = NOT_FOUND;  // 子树（含自身）中唯一的值，有多个值时为 `AMBIGUOUS`
+    };
+
+    using Entry = std::pair<std::string_view, int32_t>;
+
+    void build_node(uint32_t node, const std::vector<Entry> &entries, size_t begin, size_t end, size_t depth);
+    // 沿着 `prefix` 向下查找，返回 `prefix` 结束位置所在的节点，找不到时返回 `nodes_.size()`
+    // `prefix` 恰好结束在该节点边标签的末尾时 `at_node_end` 为 `true`，结束在边标签中间时为 `false`
+    uint32_t descend(std::string_view prefix, bool &at_node_end) const;
+    void collect_node(uint32_t node, std::vector<int32_t> &values) const;
+
+    size_t size_ = 0;
+    std::string labels_;
+    std::vector<Node> nodes_;
+};
+
+// 定长位集合，用于记录一次解析中每个参数是否被用户传递（以参数下标为位下标）
+// `has_arg`、必选参数、与所有参数互斥的参数以及参数组的校验都基于它进行按位运算
+class BitSet {
+   public:
+    explicit BitSet(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : words_(resource) {}
+
+    // 调整为 `bit_count` 位，并清空所有位
+    void reset(size_t bit_count) { words_.assign((bit_count + 63) / 64, 0); }
+    void set(size_t bit) { words_[bit >> 6] |= uint64_t(1) << (bit & 63); }
+    void clear(size_t bit) { words_[bit >> 6] &= ~(uint64_t(1) << (bit & 63)); }
+    bool test(size_t bit) const { return (words_[bit >> 6] >> (bit & 63)) & 1; }
+    uint64_t word(size_t index) const { return words_[index]; }
+    // 为 1 的位的个数
+    size_t count() const
+    {
+        size_t count = 0;
+        for (uint64_t word : words_) {
+            count += static_cast<size_t>(__builtin_popcountll(word));
+        }
+        return count;
+    }
+
+   private:
+    std::pmr::vector<uint64_t> words_;
+};
+
+// 编译后的参数集合（关联组、互斥组、至少选其一组、必选参数等），用于统计集合中被用户传递的参数个数
+// 只记录组中参数所在的字及该字上的掩码，统计时每个字只需一次按位与和一次 popcount
+class GroupMask {
+   public:
+    // 根据组中参数的下标生成掩码，重复的下标只计一次
+    void build(const std::vector<uint32_t> &indexes);
+
+    size_t count_hits(const BitSet &hits) const
+    {
+        size_t count = 0;
+        for (const auto &word : words_) {
+            count += static_cast<size_t>(__builtin_popcountll(hits.word(word.first) & word.second));
+        }
+        return count;
+    }
+
+    // 组中参数的个数（去重后）
+    size_t size() const { return size_; }
+
+   private:
+    std::vector<std::pair<uint32_t, uint64_t>> words_;
+    size_t size_ = 0;
+};
+
+// 命令行词法单元，由 `Command::next_token` 产生
+struct Token {
+    // `INVALID` 表示出错的词法单元，错误已经记录，解析时跳过
+    enum class Kind { OPTION, POSITION, INVALID };
+
+    Kind kind = Kind::POSITION;
+    // 命令行中实际书写的参数名字（不含前缀 `-` 或 `--`），仅用于输出错误信息
+    // 对于短参数，它只包含一个字符
+    std::string_view name;
+    bool is_short = false;
+    // 命中的参数，位置参数时为空
+    const Arg *arg = nullptr;
+    // 参数的值，标志参数时为空
+    const char *value = nullptr;
+};
+
+// 词法分析器的上下文
+// 所有的解析状态都保存在这里，而不是像 `getopt_long_only` 那样保存在全局变量 `optind`、`optarg` 中，
+// 并且只读地访问 `argv`（不会像 GNU `getopt` 那样重排 `argv`），因此多个线程可以同时进行参数解析。
+struct TokenizerContext {
+    TokenizerContext(int argc, const char *const *argv) : argc(argc), argv(argv) {}
+
+    int argc;
+    const char *const *argv;
+    // 下一个待处理的 `argv` 下标，`argv[0]` 是命令名字，跳过
+    int index = 1;
+    // 正在处理的短参数簇中下一个字符的位置，例如 `-abc` 处理完 `a` 之后指向 `bc`
+    const char *short_cluster = nullptr;
+    // 遇到 `--` 之后，剩余的所有参数都被当作位置参数
+    bool only_positions = false;
 };
 
+// 数值转换的结果
+enum class ConvertResult { OK, INVALID, OUT_OF_RANGE };
+
+// 数值类型的名字，用于输出错误信息
+template <typename T>
+constexpr const char *type_name()
+{
+    if constexpr (std::is_same_v<T, int>) {
+        return "int";
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        return "int64_t";
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+        return "uint32_t";
+    } else if constexpr (std::is_same_v<T, uint64_t>) {
+        return "uint64_t";
+    } else if constexpr (std::is_same_v<T, float>) {
+        return "float";
+    } else if constexpr (std::is_same_v<T, double>) {
+        return "double";
+    } else {
+        static_assert(sizeof(T) == 0, "Unsupported numeric type");
+    }
+}
+
+// 将字符串转换为数值，基于 `std::from_chars` 实现：不分配内存、不受 locale 影响、浮点数按 IEEE 正确舍入。
+// 整个字符串都必须是合法的数字（不允许前后有空白或多余的字符），为了与之前的行为保持一致，允许开头有一个正号。
+// 失败时不抛出异常，由调用者决定如何处理
+template <typename T>
+ConvertResult try_to_number(std::string_view str, T &value)
+{
+    const char *first = str.data();
+    const char *last = first + str.size();
+    if (last - first > 1 && *first == '+' && first[1] != '+' && first[1] != '-') {
+        first++;
+    }
+
+    std::from_chars_result result;
+    if constexpr (std::is_integral_v<T>) {
+        result = std::from_chars(first, last, value);
+    } else {
+        result = std::from_chars(first, last, value, std::chars_format::general);
+    }
+    if (result.ec == std::errc::result_out_of_range) {
+        return ConvertResult::OUT_OF_RANGE;
+    }
+    if (result.ec != std::errc() || result.ptr != last) {
+        return ConvertResult::INVALID;
+    }
+    return ConvertResult::OK;
+}
+
 // 将字符串转换为值。由于布尔值的语义比较模糊，因此不支持将字符串转换为布尔值。
 // 例如：对于字符串，字符串 `true` 应该被判定为布尔值吗？或者，字符串 `xxx`
 // 能被判定为布尔值吗？对于数字，非零值会被判定为布尔值吗？
 // 如果你确实想转换为布尔值，可以先转换为整数，然后根据你自己的需求进行判断。
+// 字符串不是合法的数字或超出了类型的表示范围时，通过 `exit_or_throw` 报错
 ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
 T to_value(const char *str)
 {
-    if constexpr (std::is_integral_v<T>) {
-        if constexpr (std::is_same_v<T, int>) {
-            return std::stoi(str);
-        } else if constexpr (std::is_same_v<T, int64_t>) {
-            return std::stol(str);
-        } else if constexpr (std::is_same_v<T, uint32_t>) {
-            return static_cast<uint32_t>(std::stoul(str));
-        } else if constexpr (std::is_same_v<T, uint64_t>) {
-            return std::stoul(str);
-        } else {
-            static_assert(sizeof(T) == 0, "Unsupported integral type");
-        }
-    } else if constexpr (std::is_floating_point_v<T>) {
-        if constexpr (std::is_same_v<T, float>) {
-            return std::stof(str);
-        } else if constexpr (std::is_same_v<T, double>) {
-            return std::stod(str);
-        } else {
-            static_assert(sizeof(T) == 0, "Unsupported floating point type");
+    if constexpr (std::is_arithmetic_v<T>) {
+        T value{};
+        ConvertResult ret = try_to_number(str, value);
+        if (ret != ConvertResult::OK) {
+            std::stringstream error_msg;
+            if (ret == ConvertResult::OUT_OF_RANGE) {
+                error_msg << "The value '" << str << "' is out of the range of " << type_name<T>() << ".";
+            } else {
+                error_msg << "The value '" << str << "' is not a valid " << type_name<T>() << ".";
+            }
+            exit_or_throw(error_msg);
         }
+        return value;
     } else if constexpr (std::is_same_v<T, std::string>) {
         return str;
     } else if constexpr (std::is_same_v<T, std::string_view>) {
         return str;
+    } else if constexpr (std::is_enum_v<T>) {
+        // 只有通过 `Arg::choices` 设置了 ID 的可选值才能取出为枚举值，见 `ParsedValue::get`
+        std::stringstream error_msg;
+        error_msg << "The value '" << str << "' does not have a choice ID and can not be converted to an enum.";
+        exit_or_throw(error_msg);
+        return T{};
     } else {
         static_assert(sizeof(T) == 0, "Unsupported type");
     }
 }
 
-}  // namespace internel
+// 参数的一个值：用户传递（或默认）的原始字符串，以及预先转换好的数值
+// 构造时（即解析参数值或设置默认值时）把字符串尝试转换为 `int64_t`、`uint64_t` 和 `double` 并缓存起来，
+// 取值和校验取值范围时直接读取缓存，同一个值不会被重复转换
+class ParsedValue {
+   public:
+    ParsedValue() = default;
+    explicit ParsedValue(const char *str);
+
+    const char *str() const { return str_; }
+
+    bool is_int() const { return kinds_ & INT; }
+    bool is_uint() const { return kinds_ & UINT; }
+    bool is_double() const { return kinds_ & DOUBLE; }
+    int64_t as_int() const { return static_cast<int64_t>(bits_); }
+    uint64_t as_uint() const { return bits_; }
+    double as_double() const { return double_; }
+
+    // 值是带 ID 的可选值之一时，由 `Arg::check_choice` 记录其 ID；值是逗号分隔的多个可选值时，记录其位掩码
+    void set_choice_id(int64_t id);
+    void set_choice_mask(uint64_t mask);
+    bool has_choice_id() const { return kinds_ & CHOICE_ID; }
+    bool has_choice_mask() const { return kinds_ & (CHOICE_ID | CHOICE_MASK); }
+    int64_t choice_id() const { return static_cast<int64_t>(choice_); }
+    // 单个可选值的位掩码为 `1 << ID`（ID 不在 [0, 64) 范围内时为 0）
+    uint64_t choice_mask() const
+    {
+        if (kinds_ & CHOICE_MASK) {
+            return choice_;
+        }
+        return choice_ < 64 ? (uint64_t(1) << choice_) : 0;
+    }
 
-class Arg;
-class Command;
+    // 取出指定类型的值。缓存中有合适的值时直接返回，否则（例如 `float`，或者超出了类型的范围、不是合法的数字）
+    // 调用 `to_value` 直接转换，转换失败时由 `to_value` 报错。
+    // `float` 不从缓存的 `double` 转换，以免两次舍入导致结果与直接转换不一致
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get() const
+    {
+        if constexpr (std::is_same_v<T, int>) {
+            if (is_int() && as_int() >= std::numeric_limits<int>::min() &&
+                as_int() <= std::numeric_limits<int>::max()) {
+                return static_cast<int>(as_int());
+            }
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            if (is_int()) {
+                return as_int();
+            }
+        } else if constexpr (std::is_same_v<T, uint32_t>) {
+            if (is_uint() && as_uint() <= std::numeric_limits<uint32_t>::max()) {
+                return static_cast<uint32_t>(as_uint());
+            }
+        } else if constexpr (std::is_same_v<T, uint64_t>) {
+            if (is_uint()) {
+                return as_uint();
+            }
+        } else if constexpr (std::is_same_v<T, double>) {
+            if (is_double()) {
+                return as_double();
+            }
+        } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+            return str_;
+        } else if constexpr (std::is_enum_v<T>) {
+            if (has_choice_id()) {
+                return static_cast<T>(choice_id());
+            }
+        }
+        return to_value<T>(str_);
+    }
+
+   private:
+    friend class zul::PersistentParseCache;
+
+    // 字符串能够转换成的数值类型，以及解析出的可选值 ID 或位掩码
+    enum : uint8_t { INT = 1, UINT = 2, DOUBLE = 4, CHOICE_ID = 8, CHOICE_MASK = 16 };
+
+    const char *str_ = nullptr;
+    // `int64_t` 和 `uint64_t` 共用的存储，二者同时有效时（非负数）表示同一个值
+    uint64_t bits_ = 0;
+    double double_ = 0;
+    // 可选值的 ID（`CHOICE_ID`）或位掩码（`CHOICE_MASK`）
+    uint64_t choice_ = 0;
+    uint8_t kinds_ = 0;
+};
+
+// 带内联存储的数组，元素个数不超过 `N` 时不分配内存，超过后从 `resource` 分配
+// 只用于可平凡复制的元素类型，绝大多数参数只有零个或一个值，因此值的数组默认内联一个元素
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector only supports trivially copyable types");
+
+   public:
+    explicit SmallVector(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : resource_(resource)
+    {
+    }
+
+    SmallVector(const SmallVector &other) : SmallVector(other.resource_) { append(other); }
+
+    SmallVector(SmallVector &&other) noexcept : resource_(other.resource_)
+    {
+        if (other.is_inline()) {
+            std::copy(other.begin(), other.end(), begin());
+            size_ = other.size_;
+        } else {
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            other.data_ = reinterpret_cast<T *>(other.storage_);
+            other.capacity_ = N;
+        }
+        other.size_ = 0;
+    }
+
+    SmallVector &operator=(const SmallVector &other)
+    {
+        if (this != &other) {
+            clear();
+            append(other);
+        }
+        return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&other)
+    {
+        // 内存资源不同时不能直接接管对方的内存
+        if (this == &other) {
+            return *this;
+        }
+        if (other.is_inline() || *resource_ != *other.resource_) {
+            return *this = static_cast<const SmallVector &>(other);
+        }
+        release();
+        data_ = other.data_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        other.data_ = reinterpret_cast<T *>(other.storage_);
+        other.size_ = 0;
+        other.capacity_ = N;
+        return *this;
+    }
+
+    ~SmallVector() { release(); }
+
+    void push_back(const T &value)
+    {
+        if (size_ == capacity_) {
+            grow(capacity_ * 2);
+        }
+        data_[size_++] = value;
+    }
+
+    void assign(size_t count, const T &value)
+    {
+        clear();
+        for (size_t i = 0; i < count; i++) {
+            push_back(value);
+        }
+    }
+
+    void clear() { size_ = 0; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T *begin() { return data_; }
+    T *end() { return data_ + size_; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+    const T *cbegin() const { return data_; }
+    const T *cend() const { return data_ + size_; }
+    T &operator[](size_t index) { return data_[index]; }
+    const T &operator[](size_t index) const { return data_[index]; }
+
+   private:
+    bool is_inline() const { return data_ == reinterpret_cast<const T *>(storage_); }
+
+    void append(const SmallVector &other)
+    {
+        for (const T &value : other) {
+            push_back(value);
+        }
+    }
+
+    void grow(uint32_t capacity)
+    {
+        T *data = static_cast<T *>(resource_->allocate(capacity * sizeof(T), alignof(T)));
+        std::copy(begin(), end(), data);
+        release();
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    void release()
+    {
+        if (!is_inline()) {
+            resource_->deallocate(data_, capacity_ * sizeof(T), alignof(T));
+            data_ = reinterpret_cast<T *>(storage_);
+            capacity_ = N;
+        }
+    }
+
+    T *data_ = reinterpret_cast<T *>(storage_);
+    std::pmr::memory_resource *resource_;
+    uint32_t size_ = 0;
+    uint32_t capacity_ = N;
+    alignas(T) unsigned char storage_[N * sizeof(T)];
+};
+
+// 一个参数的所有值，内联一个值。解析结果中超出内联容量的值从 `ParseResult` 的内存资源分配，参看 `Command::parse`
+using ParsedValues = SmallVector<ParsedValue, 1>;
+
+// 取值范围的一个边界，按 `Arg` 的 `NumType` 决定哪一个成员有效
+union RangeBound {
+    int64_t int_value;
+    uint64_t uint_value;
+    double double_value;
+};
+
+}  // namespace internel
 
 // 当 `config_exit_when_error == false` 时，参数解析错误时会抛出这个类型的异常
 class ParseArgsError : public std::exception {
@@ -120,6 +615,106 @@ class ParseArgsError : public std::exception {
     std::string error_msg_;
 };
 
+// 参数解析错误的类型，参看 `ParseError`
+enum class ParseErrorCode : uint8_t {
+    OK = 0,
+    HELP,                       // 传递了 `--help` 或 `-h`，不是真正的错误，调用者一般应该输出帮助信息
+    UNRECOGNIZED_OPTION,        // 未知的长参数
+    AMBIGUOUS_OPTION,           // 长参数的前缀缩写匹配到多个参数
+    INVALID_OPTION,             // 未知的短参数
+    UNEXPECTED_VALUE,           // 标志参数通过 `--name=value` 传递了值
+    MISSING_VALUE,              // 参数缺少值
+    INVALID_NUMBER,             // 设置了取值范围的参数的值不是合法的数字
+    OUT_OF_RANGE,               // 值超出了 `range` 设置的取值范围
+    INVALID_CHOICE,             // 值不是 `choices` 设置的可选值
+    MISSING_REQUIRED_OPTION,    // 缺少必选参数
+    MISSING_POSITION_ARGUMENT,  // 缺少位置参数
+    CONFLICT_WITH_ALL,          // 与所有参数互斥的参数与其它参数一起传递
+    RELATED_GROUP,              // 不满足参数关联组
+    CONFLICT_GROUP,             // 不满足参数互斥组
+    ONE_REQUIRED_GROUP,         // 不满足至少选其一组
+    MISSING_SUBCOMMAND,         // 缺少子命令
+};
+
+// 参数解析错误的紧凑记录，由 `Command::try_parse` 返回
+// 记录中只有错误的类型和位置，不包含任何文本，只有调用 `message()` 时才生成与 `Command::parse` 相同的错误信息，
+// 因此大量输入被拒绝时也没有格式化错误信息的开销
+struct ParseError {
+    ParseErrorCode code = ParseErrorCode::OK;
+    // 出错的词法单元在 `argv` 中的下标，值相关的错误为值所在的词法单元，与具体的词法单元无关时（例如缺少必选参数）为 -1
+    int32_t argv_index = -1;
+    // 出错的参数的 ID，与具体的参数无关时为 `INT32_MIN`
+    int32_t arg_id = INT32_MIN;
+    // 出错的参数组在所属命令的同类参数组中的下标，只有参数组相关的错误有效
+    uint32_t group_index = 0;
+    // 出错的文本，指向 `argv` 中的字符串：未知的长参数为整个词法单元，短参数为参数的字符，前缀缩写为缩写的名字，
+    // 值相关的错误为参数的值
+    std::string_view text;
+    // 出错的命令，可能是子命令
+    const Command *command = nullptr;
+
+    bool ok() const { return code == ParseErrorCode::OK; }
+    // 是否是参数 `arg` 出错
+    bool is_arg(const Arg &arg) const;
+
+    // 生成错误信息，`code == HELP` 时为空。`argv` 需要仍然有效
+    std::string message() const;
+};
+
+// 一次解析中的所有错误，由 `Command::try_parse_all` 填写
+// 容量在构造时给定并预先分配，解析时不再分配内存，错误超出容量时停止解析，并通过 `truncated()` 标识
+// 可以在多次解析间复用
+class ParseErrorList {
+   public:
+    explicit ParseErrorList(size_t capacity = 16);
+
+    size_t size() const { return errors_.size(); }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return errors_.empty(); }
+    const ParseError &operator[](size_t index) const { return errors_[index]; }
+    std::vector<ParseError>::const_iterator begin() const { return errors_.cbegin(); }
+    std::vector<ParseError>::const_iterator end() const { return errors_.cend(); }
+
+    // 错误的个数是否超出了容量，超出时只记录了前 `capacity()` 个错误
+    bool truncated() const { return truncated_; }
+    void clear();
+
+    // 生成所有错误的信息，每个错误一行
+    std::string message() const;
+
+   private:
+    friend class internel::ErrorSink;
+
+    std::vector<ParseError> errors_;
+    size_t capacity_;
+    bool truncated_ = false;
+};
+
+namespace internel {
+
+// 解析时记录错误的位置：`Command::try_parse` 遇到第一个错误就停止解析，`Command::try_parse_all` 继续解析，
+// 收集所有错误直到错误列表满了为止。解析函数通过 `report` 的返回值决定是否继续解析
+class ErrorSink {
+   public:
+    explicit ErrorSink(ParseError &first) : first_(&first) {}
+    explicit ErrorSink(ParseErrorList &list) : list_(&list) {}
+
+    // 记录一个错误，返回是否继续解析。`HELP` 总是停止解析
+    bool report(ParseError error);
+    // 是否已经停止解析
+    bool stopped() const { return stopped_; }
+
+    // 子命令中的 `argv` 下标是相对于子命令的，记录时加上子命令在 `argv` 中的偏移
+    int32_t argv_offset = 0;
+
+   private:
+    ParseError *first_ = nullptr;
+    ParseErrorList *list_ = nullptr;
+    bool stopped_ = false;
+};
+
+}  // namespace internel
+
 // 参数类型
 enum class ArgType {
     // 标志参数
@@ -197,59 +792,153 @@ class Arg : public std::enable_shared_from_this<Arg> {
 
     // 设置可选参数的默认值，即对于可选参数，如果用户不传递，则它的值就是这个默认值
     // 如果用户传递了，则用用户传递的值覆盖默认值
-    // 数据的底层存储方式为 `const char *`，取出时转换成所需的类型（即字符串转数字）
+    // 数据的底层存储方式为 `const char *`，设置时就预先转换为数值，取出时直接读取
     // 参看单元测试用例 `test_optional_long_name_arg_with_default_value`
     std::shared_ptr<Arg> default_value(const char *value);
 
     // 设置可选参数的默认值为一个 `vector` 数组，即对于可选参数，如果用户不传递，则它的值就是这个默认值
     // 如果用户传递了，则用用户传递的值覆盖默认值
-    // 数据的底层存储方式为 `const char *`，取出时转换成所需的类型（即字符串转数字）
+    // 数据的底层存储方式为 `const char *`，设置时就预先转换为数值，取出时直接读取
     // 参看单元测试用例 `test_optional_long_name_arg_with_default_values`
     std::shared_ptr<Arg> default_values(std::vector<const char *> &&values);
 
     // 设置参数的取值范围
     // 例如，你可以指定参数 `--aa` 的范围为 `[1, 100]`。如果实际传递的参数超出了这个范围，将会报错
-    // 数据的底层存储方式为 `const char *`，校验时转换成所需的类型（即字符串转数字）
+    // 边界在设置时就按 `type` 转换为数值（不合法的边界直接报错），校验时只需比较
     // 参看单元测试用例 `test_range_required_long_name_arg`
     // 默认 `include_left` 和 `include_right` 都等于 `true`，即包含左区间和右区间：`1 <= aa <=100`
     std::shared_ptr<Arg> range(NumType type, const char *left, const char *right, bool include_left = true,
                                bool include_right = true);
 
+    // 设置参数的取值范围，边界直接以数值给出，不需要任何字符串转换
+    // `T` 为有符号整数时按 `NumType::INT` 校验，为无符号整数时按 `NumType::UINT` 校验，为浮点数时按
+    // `NumType::DOUBlE` 校验。例如：`range(1, 100)`、`range(0.0, 1.0, true, false)`
+    template <typename T,
+              typename std::enable_if<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, int>::type = 0>
+    std::shared_ptr<Arg> range(T left, T right, bool include_left = true, bool include_right = true)
+    {
+        set_range(left, right, include_left, include_right);
+        return shared_from_this();
+    }
+
     // 参数的值只能从给定的值中选取。
     // 例如，你可以指定参数 `--aa` 的值只能从 `["1", "2", "3"]` 中选取，如果用户传递了其它值则报错
     // 数据的底层存储方式为 `const char *`，取出时转换成所需的类型（即字符串转数字）
     // 参看单元测试用例 `test_choices_required_long_name_arg`
     std::shared_ptr<Arg> choices(std::vector<const char *> &&choices);
 
+    // 参数的值只能从给定的值中选取，并且每个可选值都对应一个整数 ID
+    // 解析时就把值映射为 ID，之后通过 `get_choice_id` 或 `get_one_value<枚举类型>` 取出，不再需要比较字符串
+    // 例如：`choices({{"fast", 0}, {"safe", 1}})`
+    // `allow_list == true` 时，值可以是逗号分隔的多个可选值（例如 `fast,safe`），通过 `get_choice_mask` 取出
+    // 所有选中的可选值的位掩码（第 ID 位为 1），此时 ID 必须在 [0, 64) 范围内
+    // 参看单元测试用例 `test_choice_ids`
+    std::shared_ptr<Arg> choices(std::initializer_list<std::pair<const char *, int64_t>> choices,
+                                 bool allow_list = false);
+
+    // 同上，ID 为任意整数类型或枚举类型，可选值保存在 `vector` 中（例如运行时生成的可选值）
+    // 枚举类型需要显式指定，例如：`choices<Mode>({{"fast", Mode::FAST}, {"safe", Mode::SAFE}})`
+    // 注意：这里使用模板而不是 `std::vector<std::pair<const char *, int64_t>>`，否则 `choices({"a", "b"})`
+    // 会因为 `vector` 的迭代器构造函数而产生二义性
+    template <typename T, typename std::enable_if<std::is_integral_v<T> || std::is_enum_v<T>, int>::type = 0>
+    std::shared_ptr<Arg> choices(std::vector<std::pair<const char *, T>> &&choices, bool allow_list = false)
+    {
+        set_choices(std::move(choices), allow_list);
+        return shared_from_this();
+    }
+
    private:
+    friend class ParseResult;
+    friend class ArgRef;
+    friend class SchemaArena;
+    friend struct ParseError;
+    friend class PersistentParseCache;
+
+    // 以下 `set_xxx` 是上边同名设置函数的实现，不返回 `shared_ptr`，供 `ArgRef` 设置分配在 `SchemaArena` 中的参数
+    void set_long_name(const char *name);
+    void set_short_name(char name);
+    void set_conflicts_with_all();
+    void set_default_value(const char *value);
+    void set_default_values(std::vector<const char *> &&values);
+    void set_range(NumType type, const char *left, const char *right, bool include_left, bool include_right);
+    void set_choices(std::vector<const char *> &&choices);
+    void set_choices(std::initializer_list<std::pair<const char *, int64_t>> choices, bool allow_list);
+
+    template <typename T>
+    void set_range(T left, T right, bool include_left, bool include_right)
+    {
+        internel::RangeBound left_bound{}, right_bound{};
+        NumType type;
+        if constexpr (std::is_floating_point_v<T>) {
+            type = NumType::DOUBlE;
+            left_bound.double_value = left;
+            right_bound.double_value = right;
+        } else if constexpr (std::is_signed_v<T>) {
+            type = NumType::INT;
+            left_bound.int_value = left;
+            right_bound.int_value = right;
+        } else {
+            type = NumType::UINT;
+            left_bound.uint_value = left;
+            right_bound.uint_value = right;
+        }
+        set_range(type, left_bound, right_bound, nullptr, nullptr, include_left, include_right);
+    }
+
+    template <typename T>
+    void set_choices(std::vector<std::pair<const char *, T>> &&choices, bool allow_list)
+    {
+        std::vector<std::pair<const char *, int64_t>> id_choices;
+        id_choices.reserve(choices.size());
+        for (const auto &choice : choices) {
+            id_choices.emplace_back(choice.first, static_cast<int64_t>(choice.second));
+        }
+        set_choices(std::move(id_choices), true, allow_list);
+    }
+
     static std::shared_ptr<Arg> new_help_arg();
-    const char *get_long();
-    char get_short();
-    const std::vector<const char *> &get_values();
-    int get_argid();
-    int get_position_id();
-    ArgType get_arg_type();
-    std::string get_choice_description();
-    std::string get_boundary_description();
+    const char *get_long() const;
+    char get_short() const;
+    const internel::ParsedValues &get_default_values() const;
+    int get_argid() const;
+    size_t get_index() const;
+    int get_position_id() const;
+    ArgType get_arg_type() const;
+    const std::string &get_choice_description() const;
+    std::string get_boundary_description() const;
 
     void set_command(Command *command);
-    void set_value(const char *val);
-    void set_hit();
     void set_argid(int opt_id);
+    void set_index(size_t index);
     void set_position_id(int position_id);
 
-    bool is_hit();
-    bool is_conflict_with_all();
-
-    void check_range();
-    void check_choice();
-
-    void reset_status_info();
+    bool is_conflict_with_all() const;
+
+    // 设置取值范围，`left_text` 和 `right_text` 为空时根据边界的数值生成
+    void set_range(NumType type, internel::RangeBound left, internel::RangeBound right, const char *left_text,
+                   const char *right_text, bool include_left, bool include_right);
+
+    // 参数所属的命令已经编译（冻结）后，不能再修改参数
+    void check_not_compiled() const;
+
+    // 对用户传递的值进行预设规则的校验，校验失败时报错
+    // 对于带 ID 的可选值，校验的同时把 ID（或位掩码）记录到 `value` 中
+    void check_value(internel::ParsedValue &value) const;
+    // 同上，但不报错，而是返回错误类型，解析时使用
+    ParseErrorCode validate_value(internel::ParsedValue &value) const;
+    ParseErrorCode validate_range(const internel::ParsedValue &value) const;
+    ParseErrorCode validate_choice(internel::ParsedValue &value) const;
+    // 生成 `validate_value` 返回的错误对应的错误信息
+    std::string describe_value_error(ParseErrorCode code, std::string_view value) const;
+    // 查找可选值，返回其在 `ValueRule::choices` 中的下标，找不到时返回 -1
+    int32_t find_choice(std::string_view value) const;
+    // 设置可选值，`has_ids == false` 时忽略 `choices` 中的 ID
+    void set_choices(std::vector<std::pair<const char *, int64_t>> &&choices, bool has_ids, bool allow_list);
 
     template <typename T>
-    bool check_range(T value, T left, T right)
+    bool check_range(T value, T left, T right) const
     {
-        if (include_left_) {
+        if (rule_->include_left) {
             if (value < left) {
                 return false;
             }
@@ -258,7 +947,7 @@ class Arg : public std::enable_shared_from_this<Arg> {
                 return false;
             }
         }
-        if (include_right_) {
+        if (rule_->include_right) {
             if (value > right) {
                 return false;
             }
@@ -271,74 +960,407 @@ class Arg : public std::enable_shared_from_this<Arg> {
     }
 
    private:
+    // 取值范围和可选值，只在校验值和输出帮助、错误信息时使用，调用 `range` 或 `choices` 时才分配
+    // 与解析时频繁访问的字段分开存放，使没有设置取值范围的参数保持紧凑
+    struct ValueRule {
+        // 通过 `range` 设置的取值范围，边界的数值在设置时就已转换好，文本只用于输出帮助信息和错误信息
+        internel::RangeBound left{};
+        internel::RangeBound right{};
+        std::string left_text;
+        std::string right_text;
+        bool include_left = true;
+        bool include_right = true;
+        NumType num_type = NumType::INT;
+        // 通过 `choices` 设置的可选值，按字典序排序并去重后连续存放，`choice_lengths` 是对应的长度，比较时先比较长度
+        std::vector<const char *> choices;
+        std::vector<uint32_t> choice_lengths;
+        // 可选值对应的 ID，与 `choices` 一一对应，只有 `has_choice_ids == true` 时有效
+        std::vector<int64_t> choice_ids;
+        bool has_choice_ids = false;
+        // 是否允许逗号分隔的多个可选值
+        bool allow_choice_list = false;
+        // 可选值超过 `SMALL_CHOICE_COUNT` 个时使用完美哈希表查找，否则直接线性比较
+        internel::PerfectHashTable choice_table;
+        // 预先生成的可选值描述，例如 `[a, b, c]`，用于输出错误信息
+        std::string choice_description;
+    };
+    static constexpr size_t SMALL_CHOICE_COUNT = 8;
+
+    // `flags_` 中的标志位
+    enum : uint8_t {
+        HAS_DEFAULT_VALUE = 1,  // 是否通过 `default_value` 或 `default_values` 设置了默认值
+        IS_RANGE = 2,           // 是否使用 `range` 设置了值的取值范围
+        IS_CHOICE = 4,          // 是否使用 `choices` 设置了值的取值范围，与 `IS_RANGE` 互斥
+        CONFLICT_WITH_ALL = 8,  // 是否跟所有其它参数互斥
+    };
+
+    bool has_flag(uint8_t flag) const { return flags_ & flag; }
+    void set_flag(uint8_t flag) { flags_ |= flag; }
+    ValueRule &mutable_rule();
+
+    // 解析和校验时访问的字段集中存放在对象的开头
     const char *long_name_ = nullptr;  // 参数的长名字
-    char short_name_ = ' ';            // 参数的短名字
-    int arg_id_ = INT32_MIN;           // 参数的唯一标识 ID
-    int position_id_ = -1;  // 如果是位置参数，它用于标识位置索引（有效的索引是从 0 开始，依次递增）
+    Command *command_ = nullptr;       // 标识此参数属于哪一个命令
+    uint32_t index_ = 0;               // 参数在所属命令中的下标，用于索引 `ParseResult` 中对应的解析状态
+    int32_t arg_id_ = INT32_MIN;       // 参数的唯一标识 ID
+    int32_t position_id_ = -1;  // 如果是位置参数，它用于标识位置索引（有效的索引是从 0 开始，依次递增）
     ArgType arg_type_ = ArgType::REQUIRED;  // 参数类型
+    char short_name_ = ' ';                 // 参数的短名字
+    uint8_t flags_ = 0;
 
-    // 标识该参数是否被用户传递，如果用户传递了这个参数，则命中，否则未命中
-    // 只要是针对可选参数和标志参数
-    // 例如：可选参数用户可以传递，也可以不传递，传递时就为 `true`，否则就为 `false`
-    // 诸如 `check_related_group` 等函数要使用此值
-    bool is_hit_ = false;
-
-    // 参数的值。参数可以有多个值，这些值会统一存储在一个字符串中，然后在取出时再转换为实际类型
-    std::vector<const char *> values_;
     // 参数的默认值，通过 `default_value` 或 `default_values` 设置
-    std::vector<const char *> default_values_;
-    bool has_default_value_ = false;
-    // 默认值是否被清空
-    // 如果用户指定了默认值，则 `values_` 的初始值为默认值，
-    // 此时，如果用户又传递了此参数，则使用用户传递的值覆盖此值，同时该变量置为 `false`
-    bool is_default_value_cleared_ = false;
-
-    // 通过 `range` 或 `choices` 设置的值的取值范围，二者为互斥关系，不能同时存在
-    const char *left_ = nullptr;
-    const char *right_ = nullptr;
-    bool include_left_ = true;
-    bool include_right_ = true;
-    NumType num_type_ = NumType::INT;
-    bool is_range_ = false;  // 用户是否使用 `range` 设置了值的取值范围
-    std::set<const char *, internel::CStrCmp> choices_;
-    bool is_choice_ = false;  // 用户是否使用 `choices` 设置了值的取值范围
-
-    // 标识此参数是否跟所有其它参数互斥
-    bool is_conflict_with_all_ = false;
-
-    // 标识此参数属于哪一个命令
-    Command *command_ = nullptr;
+    // 用户没有传递此参数时，`ParseResult` 直接返回这里的值，用户传递了则用传递的值覆盖
+    // 标志参数的默认值固定为 `"0"`，传递后为 `"1"`
+    // 设置默认值时就预先转换好数值，取值时不需要再转换。绝大多数参数最多只有一个默认值，内联存放在对象中
+    internel::ParsedValues default_values_;
+
+    std::unique_ptr<ValueRule> rule_;
 };
 
-// 标识一个命令（Command 是 Arg 的集合，父子 Command 通过 map 链接）
-class Command : public std::enable_shared_from_this<Command> {
+// 预先计算好哈希值的参数长名字，通过字面量 `"batch_size"_arg` 构造
+// 在常量表达式中使用时（例如 `static constexpr ArgKey key = "batch_size"_arg;`）哈希值在编译期计算，
+// 开启优化时编译器也会直接把字面量的哈希值折叠为常量。取值时只需要探测一次哈希槽位并比较长度和名字，
+// 不需要再计算哈希值。
+// 参看单元测试用例 `test_arg_key`
+class ArgKey {
+   public:
+    constexpr ArgKey(const char *name, size_t length)
+        : name_(name), length_(length), hash_(internel::hash_name(std::string_view(name, length)))
+    {
+    }
+
+    constexpr const char *name() const { return name_; }
+    constexpr std::string_view view() const { return std::string_view(name_, length_); }
+    // 以种子 0 计算的哈希值，即 `internel::hash_name(view())`
+    constexpr uint64_t hash() const { return hash_; }
+
    private:
-    struct Private {
-        explicit Private() = default;
-    };
+    const char *name_;
+    size_t length_;
+    uint64_t hash_;
+};
 
+inline namespace literals {
+// 例如：`result.get_one_value<int>("batch_size"_arg)`，名字不能加前缀的 `--`
+constexpr ArgKey operator""_arg(const char *name, size_t length) { return ArgKey(name, length); }
+}  // namespace literals
+
+// 带类型的参数句柄，通过 `Command::add_arg` 或 `Command::get_arg_handle` 获取
+// 句柄直接指向参数，通过句柄取值时按参数的下标直接索引解析结果，不需要按名字查找参数
+// 适用于在热点路径上反复读取同一批参数的场景，例如每个请求都要读取几十个参数的工作线程
+// 参看单元测试用例 `test_arg_handle`
+ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+class ArgHandle {
    public:
-    Command(Private){};
-    Command(const Command &) = delete;
-    Command(Command &&) = delete;
-    Command &operator=(const Command &) = delete;
-    Command &operator=(Command &&) = delete;
+    ArgHandle() = default;
 
-    // 只能使用此工厂函数构造一个命令
-    static std::shared_ptr<Command> new_command(const char *name);
+    // 是否指向了一个参数，默认构造的句柄无效
+    bool valid() const { return arg_ != nullptr; }
 
-    // 设置命令的使用说明
-    // 一般的参数解析框架都会自动生成帮助文档，优点很明显，不用用户自己写。缺点是框架自动生成，想要添加自定义内容很难。
-    // 作者衡量后，决定自己写帮助文档，不用框架生成，更灵活。
-    //    const char* usage_help =
-    //    "NAME\n"
-    //    "    iotime - Test the internal bandwidth of the file system\n"
-    //    "SYNOPSIS\n"
-    //    "    iotime [OPTION]\n"
-    //    "OPTION\n"
-    //    "    -f, --file\n"
-    //    "        The file to read / write\n"
-    //    "    -a, --action\n"
+   private:
+    friend class Command;
+    friend class CommandRef;
+    friend class ParseResult;
+
+    explicit ArgHandle(const Arg *arg) : arg_(arg) {}
+
+    // 参数由所属命令持有，生命周期与命令相同
+    const Arg *arg_ = nullptr;
+};
+
+// 一次参数解析的结果
+// 命令（`Command`、`Arg`）在参数解析期间是只读的，所有解析过程中产生的数据（参数的值、是否被传递、位置参数、
+// 实际的子命令）都保存在这里。每次调用 `Command::parse` 都会返回一个独立的 `ParseResult`，
+// 因此多个线程可以共享同一个命令，同时进行参数解析而不需要加锁。
+// 参看单元测试用例 `test_concurrent_parse`
+class ParseResult {
+   public:
+    ParseResult() = default;
+    // 解析过程中的所有存储（参数的值、位置参数、子命令的解析结果等）都从 `resource` 分配，参看 `Command::parse`
+    explicit ParseResult(std::pmr::memory_resource *resource);
+    ParseResult(const ParseResult &) = delete;
+    ParseResult(ParseResult &&) = default;
+    ParseResult &operator=(const ParseResult &) = delete;
+    ParseResult &operator=(ParseResult &&) = default;
+
+    // 测试用户是否传递了参数，参看 `Command::has_arg`
+    bool has_arg(const char *long_name) const;
+    bool has_arg(char short_name) const;
+
+    // 获取实际的子命令的解析结果
+    const ParseResult &get_subcommand() const;
+    // 本结果所属命令的名字
+    std::string command_name() const;
+    std::string_view command_name_sv() const;
+
+    // 根据参数的长名字获取参数的值，参看 `Command::get_one_value`
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(const char *long_name) const
+    {
+        const internel::ParsedValues &values = get_values(long_name);
+        if (values.empty()) {
+            std::stringstream error_msg;
+            error_msg << "Option --" << long_name << " does not have a value.";
+            internel::exit_or_throw(error_msg);
+        }
+        return values[0].get<T>();
+    }
+
+    // 根据参数的短名字获取参数的值
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(char short_name) const
+    {
+        const internel::ParsedValues &values = get_values(short_name);
+        if (values.empty()) {
+            std::stringstream error_msg;
+            error_msg << "Option -" << short_name << " does not have a value.";
+            internel::exit_or_throw(error_msg);
+        }
+        return values[0].get<T>();
+    }
+
+    // 根据参数的长名字获取参数的多个值，参看 `Command::get_many_values`
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(const char *long_name) const
+    {
+        return to_values<T>(get_values(long_name));
+    }
+
+    // 根据参数的短名字获取参数的多个值
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(char short_name) const
+    {
+        return to_values<T>(get_values(short_name));
+    }
+
+    // 通过预先计算好哈希值的名字测试用户是否传递了参数、获取参数的值，参看 `ArgKey`
+    // 未定义 `NDEBUG` 时（调试模式），`has_arg` 在名字不存在时报错，避免拼错的名字静默地返回 `false`
+    bool has_arg(const ArgKey &key) const
+    {
+        const Arg *arg = find_arg(key);
+#ifndef NDEBUG
+        if (arg == nullptr) {
+            get_key_arg(key);
+        }
+#endif
+        return arg != nullptr && is_hit(*arg);
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(const ArgKey &key) const
+    {
+        return get_first_value(get_key_arg(key)).get<T>();
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(const ArgKey &key) const
+    {
+        return to_values<T>(get_values(get_key_arg(key)));
+    }
+
+    // 通过参数句柄测试用户是否传递了参数、获取参数的值，参看 `Command::add_arg`
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    bool has_arg(const ArgHandle<T> &handle) const
+    {
+        return is_hit(get_handle_arg(handle.arg_));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(const ArgHandle<T> &handle) const
+    {
+        const internel::ParsedValue &value = get_first_value(get_handle_arg(handle.arg_));
+        return value.get<T>();
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(const ArgHandle<T> &handle) const
+    {
+        return to_values<T>(get_values(get_handle_arg(handle.arg_)));
+    }
+
+    // 同上，但返回的数组从 `resource` 分配
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::pmr::vector<T> get_many_values(const char *long_name, std::pmr::memory_resource *resource) const
+    {
+        return to_values<T>(get_values(long_name), resource);
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::pmr::vector<T> get_many_values(char short_name, std::pmr::memory_resource *resource) const
+    {
+        return to_values<T>(get_values(short_name), resource);
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::pmr::vector<T> get_many_values(const ArgKey &key, std::pmr::memory_resource *resource) const
+    {
+        return to_values<T>(get_values(get_key_arg(key)), resource);
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::pmr::vector<T> get_many_values(const ArgHandle<T> &handle, std::pmr::memory_resource *resource) const
+    {
+        return to_values<T>(get_values(get_handle_arg(handle.arg_)), resource);
+    }
+
+    // 获取带 ID 的可选值参数的值对应的 ID，参看 `Command::get_choice_id`
+    int64_t get_choice_id(const char *long_name) const;
+    int64_t get_choice_id(char short_name) const;
+    // 获取带 ID 的可选值参数的所有值对应的位掩码，参看 `Command::get_choice_mask`
+    uint64_t get_choice_mask(const char *long_name) const;
+    uint64_t get_choice_mask(char short_name) const;
+
+    // 获取位置参数的值，`position` 指定位置，从 0 开始
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_position_value(size_t position) const
+    {
+        if (position >= position_values_.size()) {
+            std::stringstream error_msg;
+            error_msg << "No corresponding position argument.";
+            internel::exit_or_throw(error_msg);
+        }
+        return internel::to_value<T>(position_values_.at(position));
+    }
+
+    // 获取所有位置参数的值
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_all_position_values() const
+    {
+        std::vector<T> values;
+        values.resize(position_values_.size());
+        std::transform(position_values_.cbegin(), position_values_.cend(), values.begin(),
+                       [](const char *value) { return internel::to_value<T>(value); });
+        return values;
+    }
+
+   private:
+    friend class Command;
+    friend class PersistentParseCache;
+
+    // 单个参数的解析状态
+    struct ArgState {
+        explicit ArgState(std::pmr::memory_resource *resource) : values(resource) {}
+
+        // 写入 `values` 时的解析代数，与 `ParseResult::generation_` 不相等时表示 `values` 是之前某次解析遗留的，
+        // 此时视为用户没有传递，直接使用参数的默认值，而不需要在每次解析前清空所有参数的状态
+        uint64_t generation = 0;
+        // 用户传递的值。参数可以有多个值，每个值在解析时已经预先转换为数值
+        // 为空时表示用户没有传递，此时使用参数的默认值
+        internel::ParsedValues values;
+    };
+
+    // 开始一次新的解析。复用同一个命令之前的解析结果时，只需要增加解析代数并清除上次命中的参数，
+    // 开销只与上次实际传递的参数个数有关，与命令中参数的总数无关，并且复用之前分配的内存
+    void reset(const Command &command);
+
+    // 获取参数的值，用户没有传递时返回默认值
+    const internel::ParsedValues &get_values(const Arg &arg) const;
+    const internel::ParsedValues &get_values(const char *long_name) const;
+    const internel::ParsedValues &get_values(char short_name) const;
+
+    int64_t get_choice_id(const Arg &arg) const;
+    uint64_t get_choice_mask(const Arg &arg) const;
+
+    // 根据预先计算好哈希值的名字查找参数，`find_arg` 找不到时返回空，`get_key_arg` 找不到时报错
+    const Arg *find_arg(const ArgKey &key) const;
+    const Arg &get_key_arg(const ArgKey &key) const;
+    // 校验句柄指向的参数属于本结果对应的命令，否则报错
+    const Arg &get_handle_arg(const Arg *arg) const;
+    // 获取参数的第一个值，参数没有值时报错
+    const internel::ParsedValue &get_first_value(const Arg &arg) const;
+
+    bool is_hit(const Arg &arg) const;
+    void set_hit(const Arg &arg);
+    // 解析并校验参数的值，校验失败时返回错误的类型，不添加值
+    ParseErrorCode add_value(const Arg &arg, const char *value);
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    static std::vector<T> to_values(const internel::ParsedValues &parsed_values)
+    {
+        std::vector<T> values;
+        values.resize(parsed_values.size());
+        std::transform(parsed_values.cbegin(), parsed_values.cend(), values.begin(),
+                       [](const internel::ParsedValue &value) { return value.get<T>(); });
+        return values;
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    static std::pmr::vector<T> to_values(const internel::ParsedValues &parsed_values,
+                                         std::pmr::memory_resource *resource)
+    {
+        std::pmr::vector<T> values(resource);
+        values.resize(parsed_values.size());
+        std::transform(parsed_values.cbegin(), parsed_values.cend(), values.begin(),
+                       [](const internel::ParsedValue &value) { return value.get<T>(); });
+        return values;
+    }
+
+    std::pmr::memory_resource *resource() const { return arg_states_.get_allocator().resource(); }
+
+    // 本结果所属的命令
+    const Command *command_ = nullptr;
+    // 所有参数的解析状态，下标为 `Arg::index_`
+    std::pmr::vector<ArgState> arg_states_;
+    // 标识参数是否被用户传递的位集合，位下标为 `Arg::index_`，如果用户传递了这个参数，则命中，否则未命中
+    internel::BitSet hit_bits_;
+    // 本次解析中命中的参数下标，用于在下次解析前只清除这些位
+    std::pmr::vector<uint32_t> hit_indexes_;
+    // 解析代数，每次解析加一
+    uint64_t generation_ = 0;
+    // 记录所有位置参数值的集合
+    std::pmr::vector<const char *> position_values_;
+    // 实际的子命令的解析结果（最多一个元素），复用时保留之前分配的对象，`has_subcommand_` 标识本次解析是否有子命令
+    std::pmr::vector<ParseResult> subcommand_result_;
+    bool has_subcommand_ = false;
+};
+
+// 解析结果缓存的统计信息，参看 `Command::enable_parse_cache`
+struct ParseCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // 当前缓存的解析结果个数以及最大个数
+    size_t size = 0;
+    size_t capacity = 0;
+};
+
+namespace internel {
+// 解析结果缓存，定义在 `argparse.cpp` 中
+class ParseCache;
+}  // namespace internel
+
+// 标识一个命令（Command 是 Arg 的集合，父子 Command 通过 map 链接）
+class Command : public std::enable_shared_from_this<Command> {
+   private:
+    struct Private {
+        explicit Private() = default;
+    };
+
+   public:
+    friend class ParseResult;
+    friend class PersistentParseCache;
+
+    Command(Private);
+    ~Command();
+    Command(const Command &) = delete;
+    Command(Command &&) = delete;
+    Command &operator=(const Command &) = delete;
+    Command &operator=(Command &&) = delete;
+
+    // 只能使用此工厂函数构造一个命令
+    static std::shared_ptr<Command> new_command(const char *name);
+
+    // 设置命令的使用说明
+    // 一般的参数解析框架都会自动生成帮助文档，优点很明显，不用用户自己写。缺点是框架自动生成，想要添加自定义内容很难。
+    // 作者衡量后，决定自己写帮助文档，不用框架生成，更灵活。
+    //    const char* usage_help =
+    //    "NAME\n"
+    //    "    iotime - Test the internal bandwidth of the file system\n"
+    //    "SYNOPSIS\n"
+    //    "    iotime [OPTION]\n"
+    //    "OPTION\n"
+    //    "    -f, --file\n"
+    //    "        The file to read / write\n"
+    //    "    -a, --action\n"
     //    "        0: for write test\n"
     //    "        1: for read test\n"
     //    "    -t, --total\n"
@@ -358,6 +1380,32 @@ class Command : public std::enable_shared_from_this<Command> {
     // 添加一个新参数到命令中
     std::shared_ptr<Command> arg(std::shared_ptr<Arg> arg);
 
+    // 同上，但返回指向这个参数的带类型句柄，之后通过句柄取值，不需要再按名字查找参数
+    // 例如：
+    //     ArgHandle<int> port = cmd->add_arg<int>(Arg::new_arg(ArgType::OPTIONAL)->long_name("port"));
+    //     ParseResult result = cmd->parse(argc, argv);
+    //     int value = result.get_one_value(port);
+    // 参看单元测试用例 `test_arg_handle`
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    ArgHandle<T> add_arg(std::shared_ptr<Arg> arg)
+    {
+        this->arg(arg);
+        return ArgHandle<T>(arg.get());
+    }
+
+    // 获取已添加的参数的带类型句柄，找不到参数时报错
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    ArgHandle<T> get_arg_handle(const char *long_name) const
+    {
+        return ArgHandle<T>(get_registered_arg(long_name));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    ArgHandle<T> get_arg_handle(char short_name) const
+    {
+        return ArgHandle<T>(get_registered_arg(short_name));
+    }
+
     // 确保多个可选参数或标志参数必须同时传递，或同时不传递
     // 参看单元测试用例 `test_long_name_related_group`
     std::shared_ptr<Command> related_group(std::vector<const char *> &&related_group);
@@ -374,11 +1422,92 @@ class Command : public std::enable_shared_from_this<Command> {
     // 参看单元测试用例 `test_subcommand`
     // 添加一个子命令
     std::shared_ptr<Command> subcommand(std::shared_ptr<Command> subcommand);
+
+    // 把命令（包括所有子命令）序列化为二进制描述，运行时通过 `SchemaBlob` 直接在描述上解析参数
+    // 不支持取值范围和可选值，设置了取值范围或可选值的参数会报错
+    // 参看 `SchemaBlob` 以及 `tools/argparse_schema_gen.cpp`
+    std::string serialize_schema() const;
+
+    // 编译（冻结）命令：一次性构建解析时使用的查找表，并递归地编译所有子命令
+    // 编译之后命令不能再被修改（添加参数、子命令、参数组，或修改已添加的参数都会报错），
+    // 之后的每次解析都只读地使用这些查找表，不会再有任何注册或表的增长。
+    // 第一次解析时会自动编译，一般不需要手动调用；也可以在启动阶段手动调用，把编译的开销从第一次解析中移出。
+    // 参看单元测试用例 `test_compile`
+    std::shared_ptr<Command> compile();
+    bool is_compiled() const;
+    // 命令描述的指纹：根据命令及其所有子命令、参数、参数组的描述计算的哈希值，与帮助信息无关
+    // 描述相同的命令在不同的进程中指纹相同，描述改变时指纹随之改变，参看 `PersistentParseCache`
+    // 未编译时先编译
+    uint64_t schema_fingerprint() const;
     // 获取当前实际的子命令
     const std::shared_ptr<Command> get_subcommand();
     // 此命令的名字
-    std::string command_name();
-    std::string_view command_name_sv();
+    std::string command_name() const;
+    std::string_view command_name_sv() const;
+
+    // 运行参数解析，并返回本次解析的结果
+    // 参数解析期间会进行各种预设条件的校验，如果不满足则出错
+    // 解析期间不会修改命令本身，因此多个线程可以共享同一个命令，同时调用此函数
+    // 参看单元测试用例 `test_concurrent_parse`
+    ParseResult parse(int argc, const char *const *argv) const;
+    ParseResult parse(const std::vector<const char *> &args) const;
+
+    // 同上，但解析结果写入 `result` 中，复用 `result` 之前分配的内存
+    // 在循环中反复解析时使用，每次解析前的重置开销只与上次实际传递的参数个数有关，与命令中参数的总数无关
+    // 参看单元测试用例 `test_reuse_parse_result`
+    void parse(int argc, const char *const *argv, ParseResult &result) const;
+    void parse(const std::vector<const char *> &args, ParseResult &result) const;
+
+    // 同上，但解析结果中的所有存储（参数的值、位置参数、子命令的解析结果等）都从 `resource` 分配，不使用全局的堆
+    // 例如在处理请求时使用栈上缓冲区的 `monotonic_buffer_resource`，请求结束时一次性丢弃整个解析结果：
+    //     std::array<std::byte, 4096> buffer;
+    //     std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size());
+    //     ParseResult result = cmd->parse(argc, argv, &resource);
+    // `resource` 的生命周期需要覆盖 `result` 的生命周期。也可以通过 `ParseResult(resource)` 构造解析结果后，
+    // 使用上边复用解析结果的 `parse` 反复解析。解析出错时的错误信息需要在解析结束后（例如异常被捕获后）继续使用，
+    // 因此仍然从全局的堆分配
+    // `parse_args` 的解析结果保存在命令中，生命周期通常比 `resource` 长，因此不提供对应的版本
+    // 参看单元测试用例 `test_parse_memory_resource`
+    ParseResult parse(int argc, const char *const *argv, std::pmr::memory_resource *resource) const;
+    ParseResult parse(const std::vector<const char *> &args, std::pmr::memory_resource *resource) const;
+
+    // 同上，但出错时不退出也不抛出异常，而是返回错误的紧凑记录（参看 `ParseError`），解析成功时返回的记录为 `OK`
+    // 传递了 `--help` 时返回 `HELP`，不输出帮助信息。由调用者决定如何处理错误：只检查错误的类型和位置，
+    // 或者调用 `ParseError::message()` 生成与 `parse` 相同的错误信息。适用于需要拒绝大量非法输入的场景，
+    // 例如服务端校验请求中的参数，拒绝时没有异常展开和格式化错误信息的开销
+    // 此函数不抛出任何异常，内存分配失败时程序会终止
+    // 参看单元测试用例 `test_try_parse`
+    ParseError try_parse(int argc, const char *const *argv, ParseResult &result) const noexcept;
+    ParseError try_parse(const std::vector<const char *> &args, ParseResult &result) const noexcept;
+
+    // 同上，但遇到错误时不停止解析，而是继续进行所有的校验，把所有错误（按出现的顺序）记录到 `errors` 中，
+    // 用户一次就能看到输入中的全部问题，不需要每改正一个错误就重新提交、重新解析一次
+    // `errors` 的容量是预先分配好的，错误超出容量时停止解析。传递了 `--help` 时停止解析，最后一个错误为 `HELP`
+    // 有错误时解析结果中的数据是不完整的，不应该使用。没有错误时返回 `true`
+    // 参看单元测试用例 `test_try_parse_all`
+    bool try_parse_all(int argc, const char *const *argv, ParseResult &result, ParseErrorList &errors) const noexcept;
+    bool try_parse_all(const std::vector<const char *> &args, ParseResult &result,
+                       ParseErrorList &errors) const noexcept;
+
+    // 开启解析结果的缓存，最多缓存 `capacity` 个不同的参数列表的解析结果，超出时淘汰最久未使用的
+    // 之后通过 `cached_parse` 解析内容相同的参数列表（不要求是同一个 `argv`）时，直接返回之前的解析结果，
+    // 跳过词法分析、值的转换以及所有的校验。适用于反复解析少量固定命令行的场景，例如调度器反复解析同一批任务
+    // 命令编译之后不能再被修改，因此缓存的解析结果一直有效，不需要失效机制
+    // 需要在多个线程使用命令之前调用，再次调用时清空缓存，`capacity == 0` 时关闭缓存
+    // 参看单元测试用例 `test_parse_cache`
+    void enable_parse_cache(size_t capacity);
+
+    // 带缓存的解析，缓存命中时返回之前的解析结果，未开启缓存时每次都重新解析
+    // 解析结果是只读的，由缓存和调用者共同持有，被缓存淘汰后仍然有效。解析结果中的值指向缓存复制的参数列表，
+    // 不指向 `argv`。出错时与 `parse` 相同，出错的参数列表不会被缓存。多个线程可以同时调用
+    std::shared_ptr<const ParseResult> cached_parse(int argc, const char *const *argv) const;
+    std::shared_ptr<const ParseResult> cached_parse(const std::vector<const char *> &args) const;
+    ParseCacheStats parse_cache_stats() const;
+
+    // 运行参数解析，解析结果保存在命令中，通过下边的 `has_arg`、`get_one_value` 等函数获取
+    // 这是对 `parse` 的简单封装，使用方便，但不是线程安全的
+    void parse_args(int argc, char **argv);
+    void parse_args(std::vector<const char *> &&args);
 
     // 测试用户是否传递了参数，一般用于判断用户是否传递了标志参数，进而控制代码流程
     // 例如：`xx.bin --flag`，`--flag` 只是一个标志，没有对应的值
@@ -386,11 +1515,6 @@ class Command : public std::enable_shared_from_this<Command> {
     bool has_arg(const char *long_name);
     bool has_arg(char short_name);
 
-    // 运行参数解析
-    // 参数解析期间会进行各种预设条件的校验，如果不满足则出错
-    void parse_args(int argc, char **argv);
-    void parse_args(std::vector<const char *> &&args);
-
     // 根据参数的长名字获取参数的值
     // 由于布尔值的语义相对模糊，因此不支持将字符串转换为布尔值。
     // 例如：对于字符串而言，字符串 `true` 应该被判定为布尔值吗？或者，字符串 `xxx`
@@ -399,32 +1523,14 @@ class Command : public std::enable_shared_from_this<Command> {
     ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
     T get_one_value(const char *long_name)
     {
-        if (longname_2_arg_.count(long_name) == 0) {
-            internel::error_msg << "Can not find --" << long_name << " option.";
-            internel::exit_or_throw(internel::error_msg);
-        }
-        const std::shared_ptr<Arg> &arg = longname_2_arg_.at(long_name);
-        if (arg->get_values().empty()) {
-            internel::error_msg << "Option --" << long_name << " does not have a value.";
-            internel::exit_or_throw(internel::error_msg);
-        }
-        return internel::to_value<T>(arg->get_values().at(0));
+        return get_current_result().get_one_value<T>(long_name);
     }
 
     // 根据参数的短名字获取参数的值
     ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
     T get_one_value(char short_name)
     {
-        if (shortname_2_arg_.count(short_name) == 0) {
-            internel::error_msg << "Can not find -" << short_name << " option.";
-            internel::exit_or_throw(internel::error_msg);
-        }
-        const std::shared_ptr<Arg> &arg = shortname_2_arg_.at(short_name);
-        if (arg->get_values().empty()) {
-            internel::error_msg << "Option -" << short_name << " does not have a value.";
-            internel::exit_or_throw(internel::error_msg);
-        }
-        return internel::to_value<T>(arg->get_values().at(0));
+        return get_current_result().get_one_value<T>(short_name);
     }
 
     // 根据参数的长名字获取参数的多个值（一个 `vector` 类型的数组）
@@ -437,16 +1543,7 @@ class Command : public std::enable_shared_from_this<Command> {
     ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
     std::vector<T> get_many_values(const char *long_name)
     {
-        if (longname_2_arg_.count(long_name) == 0) {
-            internel::error_msg << "Can not find --" << long_name << " option.";
-            internel::exit_or_throw(internel::error_msg);
-        }
-        const std::shared_ptr<Arg> &arg = longname_2_arg_.at(long_name);
-        std::vector<T> values;
-        values.resize(arg->get_values().size());
-        std::transform(arg->get_values().cbegin(), arg->get_values().cend(), values.begin(),
-                       [](const char *value) { return internel::to_value<T>(value); });
-        return values;
+        return get_current_result().get_many_values<T>(long_name);
     }
 
     // 根据参数的短名字获取参数的多个值（一个 `vector` 类型的数组）
@@ -454,28 +1551,60 @@ class Command : public std::enable_shared_from_this<Command> {
     ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
     std::vector<T> get_many_values(char short_name)
     {
-        if (shortname_2_arg_.count(short_name) == 0) {
-            internel::error_msg << "Can not find -" << short_name << " option.";
-            internel::exit_or_throw(internel::error_msg);
-        }
-        const std::shared_ptr<Arg> &arg = shortname_2_arg_.at(short_name);
-        std::vector<T> values;
-        values.resize(arg->get_values().size());
-        std::transform(arg->get_values().cbegin(), arg->get_values().cend(), values.begin(),
-                       [](const char *value) { return internel::to_value<T>(value); });
-        return values;
+        return get_current_result().get_many_values<T>(short_name);
+    }
+
+    // 通过预先计算好哈希值的名字测试用户是否传递了参数、获取参数的值，参看 `ArgKey`
+    // 参看单元测试用例 `test_arg_key`
+    bool has_arg(const ArgKey &key) { return current_result_ != nullptr && current_result_->has_arg(key); }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(const ArgKey &key)
+    {
+        return get_current_result().get_one_value<T>(key);
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(const ArgKey &key)
+    {
+        return get_current_result().get_many_values<T>(key);
+    }
+
+    // 通过参数句柄测试用户是否传递了参数、获取参数的值，参看 `add_arg`
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    bool has_arg(const ArgHandle<T> &handle)
+    {
+        return current_result_ != nullptr && current_result_->has_arg(handle);
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(const ArgHandle<T> &handle)
+    {
+        return get_current_result().get_one_value(handle);
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(const ArgHandle<T> &handle)
+    {
+        return get_current_result().get_many_values(handle);
     }
 
+    // 获取带 ID 的可选值参数（参看 `Arg::choices`）的值对应的 ID，参数有多个值时返回第一个值的 ID
+    // 参看单元测试用例 `test_choice_ids`
+    int64_t get_choice_id(const char *long_name);
+    int64_t get_choice_id(char short_name);
+
+    // 获取带 ID 的可选值参数所有值的位掩码，即所有选中的可选值的 `1 << ID` 按位或的结果
+    // 参数的值可以是逗号分隔的多个可选值，也可以多次传递参数
+    uint64_t get_choice_mask(const char *long_name);
+    uint64_t get_choice_mask(char short_name);
+
     // 获取位置参数的值，`position` 指定位置，从 0 开始
     // 参看单元测试用例 `test_position_arg`
     ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
     T get_one_position_value(size_t position)
     {
-        if (position >= position_values_.size()) {
-            internel::error_msg << "No corresponding position argument.";
-            internel::exit_or_throw(internel::error_msg);
-        }
-        return internel::to_value<T>(position_values_.at(position));
+        return get_current_result().get_one_position_value<T>(position);
     }
 
     // 获取所有位置参数的值，仅限期望的位置参数属于同一类型，例如可以传递多个位置参数的文件路径
@@ -483,59 +1612,129 @@ class Command : public std::enable_shared_from_this<Command> {
     ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
     std::vector<T> get_all_position_values()
     {
-        std::vector<T> values;
-        values.resize(position_values_.size());
-        std::transform(position_values_.begin(), position_values_.end(), values.begin(),
-                       [](const char *value) { return internel::to_value<T>(value); });
-        return values;
+        return get_current_result().get_all_position_values<T>();
     }
 
    private:
-    void update_c_long_args(std::shared_ptr<Arg> opt);
-    void update_c_short_args(std::shared_ptr<Arg> opt);
-
-    void do_parse_args(int argc, char **argv);
-    void do_parse_args_internel(int argc, char **argv);
-
-    void check_required_args();
-    void check_conflict_with_all_args();
-    void check_related_groups();
-    void check_conflict_groups();
-    void check_one_required_group();
-
-    std::string get_description(std::vector<const char *> &group);
+    friend class Arg;
+    friend class CommandRef;
+    friend class SchemaArena;
+    friend struct ParseError;
+
+    // 以下是上边同名设置函数的实现，不返回 `shared_ptr`，供 `CommandRef` 设置分配在 `SchemaArena` 中的命令
+    void set_usage(const char *usage);
+    void set_usage(const char *usage[], size_t size);
+    void add_arg_internel(std::shared_ptr<Arg> arg);
+    void add_subcommand_internel(std::shared_ptr<Command> subcommand);
+
+    // `parse_args` 保存的最近一次解析结果，未调用过 `parse_args` 时报错
+    const ParseResult &get_current_result() const;
+
+    // 保证命令已经编译，解析前调用。多个线程同时调用时只会编译一次
+    void ensure_compiled() const;
+    void do_compile();
+    // 计算命令描述的指纹，子命令需要已经编译
+    uint64_t compute_schema_fingerprint() const;
+    // 命令已经编译（冻结）后，不能再修改命令
+    void check_not_compiled() const;
+
+    // 根据名字查找参数，找不到时返回空
+    // 使用编译时构建的完美哈希表和短名字直接索引表，都是 O(1) 的查找
+    const Arg *find_arg(std::string_view long_name) const;
+    const Arg *find_arg(const char *long_name) const;
+    const Arg *find_arg(char short_name) const;
+    // 使用预先计算好的哈希值查找，只有完美哈希表更换了哈希种子时（极少见）才需要重新计算哈希值
+    const Arg *find_arg(const ArgKey &key) const;
+    // 根据名字查找已添加的参数，不要求命令已经编译，找不到时报错
+    const Arg *get_registered_arg(const char *long_name) const;
+    const Arg *get_registered_arg(char short_name) const;
+
+    // 出错时退出或抛出异常
+    void do_parse_args(int argc, const char *const *argv, ParseResult &result) const;
+    // 以下解析函数出错时把错误记录到 `errors` 中，不格式化错误信息，返回 `false` 表示停止解析
+    bool try_parse_args(int argc, const char *const *argv, ParseResult &result, internel::ErrorSink &errors) const;
+    bool try_parse_args_internel(int argc, const char *const *argv, ParseResult &result,
+                                 internel::ErrorSink &errors) const;
+    // 所有词法单元处理完之后的检查：必选参数是否都已传递，以及把位置参数的值赋给在命令中设置的位置参数
+    bool finish_parse_args(int argc, const char *const *argv, ParseResult &result,
+                           internel::ErrorSink &errors) const;
+
+    // 从 `argv` 中取出下一个词法单元，没有更多词法单元或停止解析时返回 `false`
+    // 出错的词法单元的类型为 `Token::Kind::INVALID`
+    bool next_token(internel::TokenizerContext &ctx, internel::Token &token, internel::ErrorSink &errors) const;
+    bool next_short_token(internel::TokenizerContext &ctx, internel::Token &token,
+                          internel::ErrorSink &errors) const;
+    // 根据长名字查找参数，支持无歧义的前缀缩写（例如 `--ver` 可匹配 `--version`），找不到或有歧义时返回空
+    const Arg *find_long_arg(std::string_view name) const;
+
+    bool check_required_args(const ParseResult &result, internel::ErrorSink &errors) const;
+    bool check_conflict_with_all_args(const ParseResult &result, internel::ErrorSink &errors) const;
+    bool check_related_groups(const ParseResult &result, internel::ErrorSink &errors) const;
+    bool check_conflict_groups(const ParseResult &result, internel::ErrorSink &errors) const;
+    bool check_one_required_group(const ParseResult &result, internel::ErrorSink &errors) const;
+    // 依次进行上面与所有参数互斥、参数组的检查
+    bool check_arg_groups(const ParseResult &result, internel::ErrorSink &errors) const;
+
+    // 记录一个错误，返回是否继续解析
+    bool report_error(internel::ErrorSink &errors, ParseErrorCode code, const Arg *arg = nullptr,
+                      std::string_view text = {}, int32_t argv_index = -1, uint32_t group_index = 0) const;
+    // 按照错误记录输出帮助信息或错误信息，然后退出或抛出异常
+    static void raise_error(const ParseError &error);
+    // 根据参数的 ID 查找参数，找不到时返回空
+    const Arg *get_arg_by_id(int32_t arg_id) const;
+    // 生成与错误记录对应的错误信息
+    std::string format_error(const ParseError &error) const;
+
+    // 参数组：声明时把名字解析为参数下标（名字不存在时直接报错），编译时生成掩码
+    struct ArgGroup {
+        std::vector<const char *> names;
+        std::vector<uint32_t> indexes;
+        internel::GroupMask mask;
+    };
+    ArgGroup make_group(std::vector<const char *> &&names) const;
+    void add_group_internel(std::vector<ArgGroup> &groups, std::vector<const char *> &&names);
 
-    void add_help_arg();
-    void print_usage_help();
+    std::string get_description(const std::vector<const char *> &group) const;
 
-    void reset_arg_status();
+    void add_help_arg(std::shared_ptr<Arg> arg);
+    void print_usage_help() const;
 
-    // 用于标识参数的唯一 ID，这由 `getopt_long` 的特性决定。`getopt_long_only` 函数在匹配短参数时会返回一个正值。
-    // 这里将其用作长参数的唯一标识符，为了将其与短参数区分开来，这里使用负值。
-    // `getopt_long_only` 函数返回 `-1` 表示出错，所以这里从 `-2` 开始。
+    // 用于标识参数的唯一 ID，从 `-2` 开始依次递减
     int current_argid_ = -2;
 
     // 记录当前最新分配的位置参数的索引
     int current_position_id_ = 0;
 
-    // 记录长参数名称、短参数名称、参数 ID 与 `Arg` 的映射关系
-    std::map<const char *, std::shared_ptr<Arg>, internel::CStrCmp> longname_2_arg_;
-    std::map<char, std::shared_ptr<Arg>> shortname_2_arg_;
-    std::map<int, std::shared_ptr<Arg>> argid_2_arg_;
+    // 记录此命令的所有参数（包括位置参数），下标即 `Arg::index_`
+    std::vector<std::shared_ptr<Arg>> args_;
+    // 自动添加的 `--help` 参数
+    const Arg *help_arg_ = nullptr;
+
+    // 记录长参数名称、短参数名称与 `Arg` 的映射关系，用于添加参数时检查重复的名字
+    // 参数由 `args_` 持有，这里只保存裸指针，避免每次添加参数时的引用计数
+    std::map<const char *, Arg *, internel::CStrCmp> longname_2_arg_;
+    std::map<char, Arg *> shortname_2_arg_;
+
+    // 编译时构建的查找表，解析时使用
+    // 长名字 -> 参数下标的完美哈希表，用于精确匹配
+    internel::PerfectHashTable longname_table_;
+    // 长名字 -> 参数下标的压缩前缀树，精确匹配失败时用于前缀缩写匹配
+    internel::RadixTrie longname_trie_;
+    // 短名字 -> 参数下标的直接索引表，以短名字的字符值为下标，-1 表示没有对应的参数
+    std::array<int32_t, 256> shortname_table_;
 
     // 记录所有已设置与其它所有参数冲突的参数的集合
-    std::vector<std::shared_ptr<Arg>> conflict_with_all_args_;
+    std::vector<const Arg *> conflict_with_all_args_;
+    // 记录所有必选参数的集合，编译时生成
+    std::vector<const Arg *> required_args_;
+    // 编译时生成的必选参数、与所有参数互斥的参数的掩码，解析时与命中的位集合进行按位运算
+    internel::GroupMask required_mask_;
+    internel::GroupMask conflict_with_all_mask_;
     // 记录参数关联组、互斥组、至少选其一组
-    std::vector<std::vector<const char *>> related_groups_, conflict_groups_, one_required_groups_;
+    std::vector<ArgGroup> related_groups_, conflict_groups_, one_required_groups_;
 
     // 记录所有位置参数的集合
-    std::vector<std::shared_ptr<Arg>> position_args_;
-    // 记录所有位置参数值的集合
-    std::vector<const char *> position_values_;
-
-    // 用于底层 `getopt_long_only` 解析时使用的数据
-    std::string c_short_opts_;
-    std::vector<option> c_long_opts_;
+    std::vector<const Arg *> position_args_;
 
     // 此命令的名字
     const char *command_name_ = nullptr;
@@ -547,7 +1746,1040 @@ class Command : public std::enable_shared_from_this<Command> {
 
     // 此命令的子命令
     std::map<const char *, std::shared_ptr<Command>, internel::CStrCmp> subcommandname_2_subcommand_;
-    char *current_subcommand_name_ = nullptr;
+
+    // 命令是否已经编译（冻结），参看 `compile`
+    bool is_compiled_ = false;
+    mutable std::once_flag compile_flag_;
+    // 编译时计算的命令描述的指纹
+    uint64_t schema_fingerprint_ = 0;
+
+    // 解析结果的缓存，参看 `enable_parse_cache`
+    std::unique_ptr<internel::ParseCache> parse_cache_;
+
+    // 以下仅供 `parse_args` 及配套的 `get_one_value` 等函数使用
+    // `last_result_` 是根命令保存的最近一次解析结果，`current_result_` 指向其中属于本命令的部分
+    ParseResult last_result_;
+    const ParseResult *current_result_ = nullptr;
+    const char *current_subcommand_name_ = nullptr;
+};
+
+namespace internel {
+
+// 对象池：对象按块分配（每块 `BLOCK_SIZE` 个），创建对象时只在块用完时分配一次内存，
+// 对象的地址在对象池的整个生命周期内不变，对象池析构时按创建的逆序析构所有对象
+template <typename T, size_t BLOCK_SIZE = 32>
+class ObjectPool {
+   public:
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    ~ObjectPool()
+    {
+        while (size_ > 0) {
+            size_--;
+            at(size_)->~T();
+        }
+    }
+
+    template <typename... Args>
+    T *create(Args &&...args)
+    {
+        if (size_ == blocks_.size() * BLOCK_SIZE) {
+            blocks_.emplace_back(new Slot[BLOCK_SIZE]);
+        }
+        T *object = new (&blocks_[size_ / BLOCK_SIZE][size_ % BLOCK_SIZE]) T(std::forward<Args>(args)...);
+        size_++;
+        return object;
+    }
+
+    size_t size() const { return size_; }
+
+   private:
+    struct alignas(T) Slot {
+        unsigned char data[sizeof(T)];
+    };
+
+    T *at(size_t index)
+    {
+        return std::launder(reinterpret_cast<T *>(&blocks_[index / BLOCK_SIZE][index % BLOCK_SIZE]));
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> blocks_;
+    size_t size_ = 0;
+};
+
+// 返回不持有对象的 `shared_ptr`（没有控制块），拷贝和析构时都不会修改引用计数
+// 对象的生命周期由别处（例如 `SchemaArena`）保证
+template <typename T>
+std::shared_ptr<T> borrow(T &object)
+{
+    return std::shared_ptr<T>(std::shared_ptr<T>(), &object);
+}
+
+}  // namespace internel
+
+class SchemaArena;
+
+// 分配在 `SchemaArena` 中的参数的引用，提供与 `Arg` 相同的设置函数，设置后返回自身以便链式调用
+// 只保存一个裸指针，拷贝时没有任何开销，参数的生命周期与所属的 `SchemaArena` 相同
+class ArgRef {
+   public:
+    ArgRef long_name(const char *name)
+    {
+        arg_->set_long_name(name);
+        return *this;
+    }
+
+    ArgRef short_name(char name)
+    {
+        arg_->set_short_name(name);
+        return *this;
+    }
+
+    ArgRef conflicts_with_all()
+    {
+        arg_->set_conflicts_with_all();
+        return *this;
+    }
+
+    ArgRef default_value(const char *value)
+    {
+        arg_->set_default_value(value);
+        return *this;
+    }
+
+    ArgRef default_values(std::vector<const char *> &&values)
+    {
+        arg_->set_default_values(std::move(values));
+        return *this;
+    }
+
+    ArgRef range(NumType type, const char *left, const char *right, bool include_left = true,
+                 bool include_right = true)
+    {
+        arg_->set_range(type, left, right, include_left, include_right);
+        return *this;
+    }
+
+    template <typename T,
+              typename std::enable_if<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, int>::type = 0>
+    ArgRef range(T left, T right, bool include_left = true, bool include_right = true)
+    {
+        arg_->set_range(left, right, include_left, include_right);
+        return *this;
+    }
+
+    ArgRef choices(std::vector<const char *> &&choices)
+    {
+        arg_->set_choices(std::move(choices));
+        return *this;
+    }
+
+    ArgRef choices(std::initializer_list<std::pair<const char *, int64_t>> choices, bool allow_list = false)
+    {
+        arg_->set_choices(choices, allow_list);
+        return *this;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral_v<T> || std::is_enum_v<T>, int>::type = 0>
+    ArgRef choices(std::vector<std::pair<const char *, T>> &&choices, bool allow_list = false)
+    {
+        arg_->set_choices(std::move(choices), allow_list);
+        return *this;
+    }
+
+    const Arg &get() const { return *arg_; }
+
+   private:
+    friend class SchemaArena;
+    friend class CommandRef;
+
+    explicit ArgRef(Arg *arg) : arg_(arg) {}
+
+    Arg *arg_;
+};
+
+// 分配在 `SchemaArena` 中的命令的引用，提供与 `Command` 相同的设置函数，设置后返回自身以便链式调用
+// 解析和取值通过 `get()` 返回的 `Command` 进行。注意不能对其调用 `Command` 中返回 `shared_ptr` 的设置函数，
+// 这些函数依赖 `shared_from_this`，而分配在 `SchemaArena` 中的命令不由 `shared_ptr` 持有
+class CommandRef {
+   public:
+    CommandRef usage(const char *usage)
+    {
+        command_->set_usage(usage);
+        return *this;
+    }
+
+    CommandRef usage(const char *usage[], size_t size)
+    {
+        command_->set_usage(usage, size);
+        return *this;
+    }
+
+    CommandRef arg(ArgRef arg)
+    {
+        command_->add_arg_internel(internel::borrow(*arg.arg_));
+        return *this;
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    ArgHandle<T> add_arg(ArgRef arg)
+    {
+        this->arg(arg);
+        return ArgHandle<T>(arg.arg_);
+    }
+
+    CommandRef related_group(std::vector<const char *> &&related_group)
+    {
+        command_->add_group_internel(command_->related_groups_, std::move(related_group));
+        return *this;
+    }
+
+    CommandRef conflict_group(std::vector<const char *> &&conflict_group)
+    {
+        command_->add_group_internel(command_->conflict_groups_, std::move(conflict_group));
+        return *this;
+    }
+
+    CommandRef one_required_group(std::vector<const char *> &&one_required_group)
+    {
+        command_->add_group_internel(command_->one_required_groups_, std::move(one_required_group));
+        return *this;
+    }
+
+    CommandRef subcommand(CommandRef subcommand)
+    {
+        command_->add_subcommand_internel(internel::borrow(*subcommand.command_));
+        return *this;
+    }
+
+    CommandRef compile()
+    {
+        command_->ensure_compiled();
+        return *this;
+    }
+
+    Command &get() const { return *command_; }
+
+   private:
+    friend class SchemaArena;
+
+    explicit CommandRef(Command *command) : command_(command) {}
+
+    Command *command_;
+};
+
+// 命令描述的内存池：一个根命令及其所有子命令、参数都分配在同一个 `SchemaArena` 中，由它统一持有
+// 与 `Command::new_command`、`Arg::new_arg` 相比，构造时不需要为每个对象单独分配内存和 `shared_ptr` 的控制块，
+// 命令之间、命令与参数之间的链接也不需要修改原子的引用计数。`SchemaArena` 析构时释放其中的所有命令和参数，
+// 因此它的生命周期需要覆盖所有命令的使用（包括解析结果的使用）
+// 例如：
+//     SchemaArena arena;
+//     CommandRef cmd = arena.new_command("my_command")
+//                          .arg(arena.new_arg(ArgType::OPTIONAL).long_name("batch_size").default_value("32"));
+//     ParseResult result = cmd.get().parse(argc, argv);
+// 参看单元测试用例 `test_schema_arena`
+class SchemaArena {
+   public:
+    SchemaArena() = default;
+    SchemaArena(const SchemaArena &) = delete;
+    SchemaArena &operator=(const SchemaArena &) = delete;
+
+    CommandRef new_command(const char *name);
+    ArgRef new_arg(ArgType type);
+
+   private:
+    // 成员按声明的逆序析构，命令先于参数析构
+    internel::ObjectPool<Arg> args_;
+    internel::ObjectPool<Command> commands_;
+};
+
+namespace internel {
+// 批量解析使用的工作窃取线程池，定义在 `argparse.cpp` 中
+class WorkStealingPool;
+}  // namespace internel
+
+// 批量解析器：在内部的线程池上并行地用同一个命令解析大量参数列表，每个参数列表对应一个解析结果
+// 每个参数列表的解析结果和错误记录与单独调用 `Command::try_parse` 完全相同（`Command::parse`
+// 出错时抛出的错误信息可以通过 `error(i).message()` 得到）。解析结果在多次 `parse` 之间复用，
+// 反复批量解析时不再分配内存
+// 例如：
+//     BatchParser parser(*cmd);
+//     parser.parse(argvs.data(), argvs.size());
+//     for (size_t i = 0; i < parser.size(); i++) {
+//         if (!parser.error(i).ok()) {
+//             std::cerr << parser.error(i).message() << std::endl;
+//         }
+//     }
+// 命令的生命周期需要覆盖解析器的生命周期，参数列表需要在使用解析结果期间保持有效
+// 参看单元测试用例 `test_batch_parser`
+class BatchParser {
+   public:
+    // `thread_count == 0` 时线程数为 CPU 的核数。调用 `parse` 的线程也参与解析，因此只会创建 `thread_count - 1`
+    // 个后台线程
+    explicit BatchParser(const Command &command, size_t thread_count = 0);
+    ~BatchParser();
+    BatchParser(const BatchParser &) = delete;
+    BatchParser &operator=(const BatchParser &) = delete;
+
+    // 并行解析 `argvs[0]` 到 `argvs[count - 1]`，全部解析完成后返回，返回解析成功的个数
+    // 不能在多个线程中同时调用同一个解析器的 `parse`
+    size_t parse(const std::vector<const char *> *argvs, size_t count);
+    size_t parse(const std::vector<std::vector<const char *>> &argvs);
+
+    // 最近一次 `parse` 的参数列表的个数，以及第 `index` 个参数列表的解析结果和错误记录
+    size_t size() const { return size_; }
+    const ParseResult &result(size_t index) const { return results_[index]; }
+    const ParseError &error(size_t index) const { return errors_[index]; }
+
+    size_t thread_count() const;
+
+   private:
+    const Command &command_;
+    std::unique_ptr<internel::WorkStealingPool> pool_;
+    // 只增不减，多出来的解析结果留给下一次更大的批量解析使用
+    std::vector<ParseResult> results_;
+    std::vector<ParseError> errors_;
+    size_t size_ = 0;
+};
+
+// 持久化的解析结果缓存：通过 `mmap` 共享的缓存文件，在多次进程调用之间复用校验过的解析结果
+// 脚本以相同的参数反复启动同一个程序时，第一次解析后把结果写入缓存文件，之后的进程直接从缓存文件中加载，
+// 跳过词法分析、值的转换以及所有的校验（取值范围、可选值、参数组等）。缓存文件应放在当前用户私有的目录下，例如：
+//     std::string path = std::string(getenv("XDG_RUNTIME_DIR")) + "/my_tool.argcache";
+//     PersistentParseCache cache(path.c_str());
+//     ParseResult result = cache.parse(*cmd, argc, argv);
+// 缓存以命令描述的指纹（参看 `Command::schema_fingerprint`）和参数列表的内容为键，命令的描述改变后，
+// 旧的缓存自然不再命中，并在之后被覆盖，不需要手动清理
+// 缓存文件由固定大小的槽位组成，每个参数列表按哈希值对应一个槽位，后写入的覆盖先写入的。槽位中保存的是可重定位的
+// 格式：值以其在 `argv` 中的下标和偏移记录，不包含任何指针，加载后解析结果中的值指向本次调用的 `argv`，
+// 与 `Command::parse` 的结果完全相同。槽位大小为 4KB，参数列表及其解析结果放不进一个槽位时不缓存，每次都照常解析
+// 加载时不再校验，因此缓存的内容必须可信：
+// - 缓存文件和密钥文件（缓存文件名加上 `.key`）都以 `0600` 创建，打开时不跟随符号链接，
+//   不属于当前用户或者其它用户可写的文件不会被使用；
+// - 每个槽位带有用密钥文件中的随机密钥计算的认证码（SipHash-2-4），没有密钥就无法伪造出能命中的槽位，
+//   多个进程同时写入同一个槽位导致数据不完整时也只会不命中。
+// 缓存文件是可选的：打开失败（例如没有权限、文件格式或属主不对）时不报错，解析时不使用缓存
+// 参看单元测试用例 `test_persistent_parse_cache`
+class PersistentParseCache {
+   public:
+    // 打开缓存文件，文件不存在时创建，包含 `slot_count` 个槽位；文件已存在时使用文件中的槽位个数
+    explicit PersistentParseCache(const char *path, uint32_t slot_count = 1024);
+    ~PersistentParseCache();
+    PersistentParseCache(const PersistentParseCache &) = delete;
+    PersistentParseCache &operator=(const PersistentParseCache &) = delete;
+
+    bool is_open() const { return slots_ != nullptr; }
+
+    // 运行参数解析，缓存命中时直接加载之前的解析结果，否则照常解析，解析成功时写入缓存
+    // 出错时与 `Command::parse` 相同，出错的参数列表不会写入缓存
+    ParseResult parse(const Command &command, int argc, const char *const *argv);
+    ParseResult parse(const Command &command, const std::vector<const char *> &args);
+    void parse(const Command &command, int argc, const char *const *argv, ParseResult &result);
+
+    // 命中和未命中的次数，`size` 为已经使用的槽位个数，`capacity` 为槽位的总数
+    ParseCacheStats stats() const;
+
+   private:
+    // 把解析结果编码为可重定位的格式追加到 `out`，超出槽位大小或者值不在 `argv` 中时返回 `false`
+    // `begin` 为当前命令（子命令）的名字在 `argv` 中的下标
+    static bool encode(const ParseResult &result, int argc, const char *const *argv, int begin, std::string &out);
+    // 从编码中恢复解析结果，编码不合法时返回 `false`
+    static bool decode(const Command &command, int argc, const char *const *argv, int begin, const char *&data,
+                       const char *end, ParseResult &result);
+    static bool load(const Command &command, int argc, const char *const *argv, const char *data, size_t size,
+                     ParseResult &result);
+
+    // 槽位的起始地址
+    uint8_t *slot(uint64_t key) const;
+
+    void *mapped_ = nullptr;
+    size_t mapped_size_ = 0;
+    uint8_t *slots_ = nullptr;
+    uint32_t slot_count_ = 0;
+    // 计算槽位认证码的密钥
+    uint64_t mac_key_[2] = {0, 0};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+namespace internel {
+
+// `StaticCommand` 和 `SchemaBlob` 共用的简化词法分析，语法与 `Command` 相同（`--name=value`、`--name value`、
+// `-n value`、`-nvalue`、`-abc`、`--`），但不支持长名字的前缀匹配和单个 `-` 开头的长名字
+// `schema` 需要提供 `command_name()`、`find_long(name)`、`find_short(c)`（找不到时返回 -1）、`is_flag(index)`、
+// `long_name(index)`、`print_usage()`，`result` 需要提供 `add_value(index, value)`、`add_position_value(value)`
+// 传递了 `--help` 或 `-h` 时输出帮助信息后退出（或抛出异常）
+template <typename Schema, typename Result>
+void parse_simple_args(const Schema &schema, int argc, const char *const *argv, Result &result)
+{
+    bool only_positions = false;
+    for (int idx = 1; idx < argc; idx++) {
+        const char *current = argv[idx];
+        std::string_view text(current);
+        // 单独的 `-` 以及不以 `-` 开头的都是位置参数，`--` 之后的全部是位置参数
+        if (only_positions || text.size() < 2 || text[0] != '-') {
+            result.add_position_value(current);
+            continue;
+        }
+        if (text == "--") {
+            only_positions = true;
+            continue;
+        }
+        if (text == "--help") {
+            schema.print_usage();
+            std::stringstream error_msg;
+            exit_or_throw(error_msg);
+        }
+
+        if (text[1] == '-') {
+            std::string_view body = text.substr(2);
+            size_t equal_pos = body.find('=');
+            int32_t index = schema.find_long(body.substr(0, equal_pos));
+            if (index < 0) {
+                std::stringstream error_msg;
+                error_msg << schema.command_name() << ": Unrecognized option '" << text << "'.";
+                exit_or_throw(error_msg);
+            }
+            const char *value = nullptr;
+            if (schema.is_flag(index)) {
+                if (equal_pos != std::string_view::npos) {
+                    std::stringstream error_msg;
+                    error_msg << schema.command_name() << ": Option '--" << schema.long_name(index)
+                              << "' doesn't allow an argument.";
+                    exit_or_throw(error_msg);
+                }
+                value = "1";
+            } else if (equal_pos != std::string_view::npos) {
+                value = current + 2 + equal_pos + 1;
+            } else if (idx + 1 < argc) {
+                value = argv[++idx];
+            } else {
+                std::stringstream error_msg;
+                error_msg << schema.command_name() << ": Option '--" << schema.long_name(index)
+                          << "' requires an argument.";
+                exit_or_throw(error_msg);
+            }
+            result.add_value(static_cast<size_t>(index), value);
+            continue;
+        }
+
+        // 短参数簇，例如 `-abc` 等价于 `-a -b -c`，非标志参数的值可以紧跟在后边（`-r1`），也可以是下一个参数
+        // 与 `Command` 相同，簇中的 `h`（例如 `-vh`）也表示帮助参数
+        for (const char *cluster = current + 1; *cluster != '\0'; cluster++) {
+            if (*cluster == 'h') {
+                schema.print_usage();
+                std::stringstream error_msg;
+                exit_or_throw(error_msg);
+            }
+            int32_t index = schema.find_short(*cluster);
+            if (index < 0) {
+                std::stringstream error_msg;
+                error_msg << schema.command_name() << ": Invalid option -- '" << *cluster << "'.";
+                exit_or_throw(error_msg);
+            }
+            if (schema.is_flag(index)) {
+                result.add_value(static_cast<size_t>(index), "1");
+                continue;
+            }
+            if (cluster[1] != '\0') {
+                result.add_value(static_cast<size_t>(index), cluster + 1);
+            } else if (idx + 1 < argc) {
+                result.add_value(static_cast<size_t>(index), argv[++idx]);
+            } else {
+                std::stringstream error_msg;
+                error_msg << schema.command_name() << ": Option requires an argument -- '" << *cluster << "'.";
+                exit_or_throw(error_msg);
+            }
+            break;
+        }
+    }
+}
+
+}  // namespace internel
+
+// 静态命令中的一个参数的描述，参看 `StaticCommand`
+// 例如：`StaticArg{ArgType::OPTIONAL, "batch_size", 'b', "32"}`，不需要的长名字或默认值传 `nullptr`，
+// 不需要的短名字传 `' '`，位置参数只需要指定类型：`StaticArg{ArgType::POSITION}`
+struct StaticArg {
+    ArgType type = ArgType::OPTIONAL;
+    const char *long_name = nullptr;
+    char short_name = ' ';
+    // 只有可选参数可以设置默认值
+    const char *default_value = nullptr;
+};
+
+template <size_t N, size_t MaxValues>
+class StaticParseResult;
+
+// 静态命令：在编译期描述全部参数的另一种前端，适用于对启动速度非常敏感的小工具
+// 与 `Command` 不同，静态命令不使用任何堆内存：所有参数的描述、按名字查找参数的哈希表都在编译期生成，
+// 保存在只读数据段中；解析结果 `StaticParseResult` 是固定大小的对象，可以定义为静态变量。
+// 参数名字的校验（例如不能使用 `help` 和 `h`、名字不能重复）在编译期完成，不合法时编译失败。
+// 为了保持简单，静态命令不支持子命令、参数组、取值范围、可选值，也不支持长名字的前缀匹配和单个 `-` 开头的
+// 长名字，需要这些功能时请使用 `Command`。
+// 使用方法：
+//     static constexpr auto cmd = make_static_command("my_command", {
+//         StaticArg{ArgType::OPTIONAL, "batch_size", 'b', "32"},
+//         StaticArg{ArgType::FLAG, "verbose", 'v'},
+//         StaticArg{ArgType::POSITION}});
+//     static StaticParseResult<cmd.size()> result;
+//     cmd.parse(argc, argv, result);
+//     int batch_size = result.get_one_value<int>("batch_size"_arg);
+// 参看单元测试用例 `test_static_command`
+template <size_t N>
+class StaticCommand {
+   public:
+    constexpr StaticCommand(const char *name, const StaticArg (&args)[N], const char *usage)
+        : name_(name), usage_(usage)
+    {
+        for (size_t i = 0; i < short_table_.size(); i++) {
+            short_table_[i] = -1;
+        }
+        for (size_t i = 0; i < long_slots_.size(); i++) {
+            long_slots_[i] = -1;
+        }
+        for (size_t i = 0; i < N; i++) {
+            args_[i] = args[i];
+            check_arg(args[i]);
+            if (args[i].type == ArgType::POSITION) {
+                position_count_++;
+                continue;
+            }
+            if (args[i].long_name != nullptr) {
+                add_long_name(args[i].long_name, static_cast<int32_t>(i));
+            }
+            if (args[i].short_name != ' ') {
+                int32_t &slot = short_table_[static_cast<unsigned char>(args[i].short_name)];
+                if (slot >= 0) {
+                    internel::static_schema_error("Duplicate short option.");
+                }
+                slot = static_cast<int32_t>(i);
+            }
+        }
+    }
+
+    static constexpr size_t size() { return N; }
+    constexpr const char *command_name() const { return name_; }
+
+    // 运行参数解析，解析结果写入 `result` 中，参数的语法与 `Command` 相同（`--name=value`、`--name value`、
+    // `-n value`、`-nvalue`、`-abc`、`--`），解析失败时通过 `exit_or_throw` 报错
+    // 传递了 `--help` 或 `-h` 时输出帮助信息后退出（或抛出异常）
+    template <size_t MaxValues>
+    void parse(int argc, const char *const *argv, StaticParseResult<N, MaxValues> &result) const;
+    template <size_t MaxValues>
+    void parse(const std::vector<const char *> &args, StaticParseResult<N, MaxValues> &result) const
+    {
+        parse(static_cast<int>(args.size()), args.data(), result);
+    }
+
+   private:
+    template <size_t, size_t>
+    friend class StaticParseResult;
+    template <typename Schema, typename Result>
+    friend void internel::parse_simple_args(const Schema &schema, int argc, const char *const *argv, Result &result);
+
+    // 哈希表的槽位数取不小于参数个数两倍的 2 的幂，使用线性探测解决冲突
+    static constexpr size_t slot_count()
+    {
+        size_t count = 2;
+        while (count < N * 2) {
+            count <<= 1;
+        }
+        return count;
+    }
+
+    static constexpr void check_arg(const StaticArg &arg)
+    {
+        if (arg.type == ArgType::POSITION) {
+            if (arg.long_name != nullptr || arg.short_name != ' ') {
+                internel::static_schema_error("Position argument can not set long name or short name.");
+            }
+        } else if (arg.long_name == nullptr && arg.short_name == ' ') {
+            internel::static_schema_error("The argument should have a long name or a short name.");
+        }
+        if (arg.default_value != nullptr && arg.type != ArgType::OPTIONAL) {
+            internel::static_schema_error("Only optional argument can set default value.");
+        }
+        if (arg.short_name == 'h') {
+            internel::static_schema_error("The option of --help and -h have been automatically added.");
+        }
+        if (arg.short_name == '-') {
+            internel::static_schema_error("The short option can not be -.");
+        }
+        if (arg.long_name == nullptr) {
+            return;
+        }
+        std::string_view name(arg.long_name);
+        if (name.substr(0, 4) == "help") {
+            internel::static_schema_error("The option of --help and -h have been automatically added.");
+        }
+        if (name.size() < 2) {
+            internel::static_schema_error("The length of long option must be greater than 2.");
+        }
+        if (name[0] == '-') {
+            internel::static_schema_error("The name cannot start with -- or - .");
+        }
+        for (char c : name) {
+            if (c == ' ' || c == '=') {
+                internel::static_schema_error("The long option can not contain spaces or =.");
+            }
+        }
+    }
+
+    constexpr void add_long_name(const char *long_name, int32_t index)
+    {
+        std::string_view name(long_name);
+        for (size_t slot = slot_index(internel::hash_name(name));; slot = (slot + 1) & (long_slots_.size() - 1)) {
+            if (long_slots_[slot] < 0) {
+                long_slots_[slot] = index;
+                return;
+            }
+            if (std::string_view(args_[long_slots_[slot]].long_name) == name) {
+                internel::static_schema_error("Duplicate long option.");
+            }
+        }
+    }
+
+    static constexpr size_t slot_index(uint64_t hash) { return static_cast<size_t>(hash) & (slot_count() - 1); }
+
+    // 根据名字查找参数的下标，找不到时返回 -1
+    int32_t find_long(std::string_view name, uint64_t hash) const
+    {
+        for (size_t slot = slot_index(hash);; slot = (slot + 1) & (long_slots_.size() - 1)) {
+            int32_t index = long_slots_[slot];
+            if (index < 0 || std::string_view(args_[index].long_name) == name) {
+                return index;
+            }
+        }
+    }
+    int32_t find_long(std::string_view name) const { return find_long(name, internel::hash_name(name)); }
+    int32_t find_short(char name) const { return short_table_[static_cast<unsigned char>(name)]; }
+    bool is_flag(int32_t index) const { return args_[index].type == ArgType::FLAG; }
+    const char *long_name(int32_t index) const { return args_[index].long_name; }
+    void print_usage() const
+    {
+        if (usage_ != nullptr) {
+            std::cout << usage_ << std::endl;
+        }
+    }
+
+    // 参数名字的描述，用于输出错误信息，例如 `--batch_size` 或 `-b`
+    void describe_arg(std::stringstream &error_msg, size_t index) const
+    {
+        if (args_[index].long_name != nullptr) {
+            error_msg << "--" << args_[index].long_name;
+        } else {
+            error_msg << "-" << args_[index].short_name;
+        }
+    }
+
+    const char *name_;
+    const char *usage_;
+    std::array<StaticArg, N> args_{};
+    size_t position_count_ = 0;
+    std::array<int32_t, 256> short_table_{};
+    std::array<int32_t, slot_count()> long_slots_{};
+};
+
+// 构造静态命令，在常量表达式中使用时（`static constexpr auto cmd = make_static_command(...)`）参数名字不合法会
+// 导致编译失败，`usage` 是传递 `--help` 时输出的帮助信息
+template <size_t N>
+constexpr StaticCommand<N> make_static_command(const char *name, const StaticArg (&args)[N],
+                                               const char *usage = nullptr)
+{
+    return StaticCommand<N>(name, args, usage);
+}
+
+// 静态命令的解析结果，大小固定，不使用任何堆内存
+// `N` 是命令的参数个数，`MaxValues` 是一次解析最多可以保存的值的个数（选项的值和位置参数的值分别计算），
+// 超过时报错
+template <size_t N, size_t MaxValues = 64>
+class StaticParseResult {
+   public:
+    // 测试用户是否传递了参数
+    bool has_arg(const char *long_name) const { return is_hit(find_arg(long_name)); }
+    bool has_arg(char short_name) const { return is_hit(find_arg(short_name)); }
+    bool has_arg(const ArgKey &key) const { return is_hit(find_arg(key)); }
+
+    // 获取参数的值，用户没有传递时返回默认值，都没有时报错
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(const char *long_name) const
+    {
+        return internel::to_value<T>(get_first_value(get_arg(find_arg(long_name), long_name)));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(char short_name) const
+    {
+        return internel::to_value<T>(get_first_value(get_arg(find_arg(short_name), short_name)));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(const ArgKey &key) const
+    {
+        return internel::to_value<T>(get_first_value(get_arg(find_arg(key), key.name())));
+    }
+
+    // 获取参数的多个值
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(const char *long_name) const
+    {
+        return get_values<T>(get_arg(find_arg(long_name), long_name));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(char short_name) const
+    {
+        return get_values<T>(get_arg(find_arg(short_name), short_name));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(const ArgKey &key) const
+    {
+        return get_values<T>(get_arg(find_arg(key), key.name()));
+    }
+
+    // 获取位置参数的值，`position` 指定位置，从 0 开始
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_position_value(size_t position) const
+    {
+        if (position >= position_count_) {
+            std::stringstream error_msg;
+            error_msg << "No corresponding position argument.";
+            internel::exit_or_throw(error_msg);
+        }
+        return internel::to_value<T>(positions_[position]);
+    }
+
+    size_t position_count() const { return position_count_; }
+
+   private:
+    friend class StaticCommand<N>;
+    template <typename Schema, typename Result>
+    friend void internel::parse_simple_args(const Schema &schema, int argc, const char *const *argv, Result &result);
+
+    void reset(const StaticCommand<N> &command)
+    {
+        command_ = &command;
+        hit_.fill(false);
+        first_value_.fill(-1);
+        last_value_.fill(-1);
+        value_count_ = 0;
+        position_count_ = 0;
+    }
+
+    void add_value(size_t index, const char *value)
+    {
+        if (value_count_ == MaxValues) {
+            std::stringstream error_msg;
+            error_msg << command_->name_ << ": Too many option values, at most " << MaxValues << " are supported.";
+            internel::exit_or_throw(error_msg);
+        }
+        int32_t current = static_cast<int32_t>(value_count_++);
+        values_[current] = value;
+        next_value_[current] = -1;
+        if (last_value_[index] < 0) {
+            first_value_[index] = current;
+        } else {
+            next_value_[last_value_[index]] = current;
+        }
+        last_value_[index] = current;
+        hit_[index] = true;
+    }
+
+    void add_position_value(const char *value)
+    {
+        if (position_count_ == MaxValues) {
+            std::stringstream error_msg;
+            error_msg << command_->name_ << ": Too many position arguments, at most " << MaxValues
+                      << " are supported.";
+            internel::exit_or_throw(error_msg);
+        }
+        positions_[position_count_++] = value;
+    }
+
+    int32_t find_arg(const char *long_name) const { return command_ ? command_->find_long(long_name) : -1; }
+    int32_t find_arg(char short_name) const { return command_ ? command_->find_short(short_name) : -1; }
+    int32_t find_arg(const ArgKey &key) const { return command_ ? command_->find_long(key.view(), key.hash()) : -1; }
+
+    bool is_hit(int32_t index) const { return index >= 0 && hit_[index]; }
+
+    template <typename Name>
+    size_t get_arg(int32_t index, Name name) const
+    {
+        if (index < 0) {
+            std::stringstream error_msg;
+            error_msg << "Can not find " << (std::is_same_v<Name, char> ? "-" : "--") << name << " option.";
+            internel::exit_or_throw(error_msg);
+        }
+        return static_cast<size_t>(index);
+    }
+
+    const char *get_first_value(size_t index) const
+    {
+        if (hit_[index]) {
+            return values_[first_value_[index]];
+        }
+        const StaticArg &arg = command_->args_[index];
+        if (arg.type == ArgType::FLAG) {
+            return "0";
+        }
+        if (arg.default_value == nullptr) {
+            std::stringstream error_msg;
+            error_msg << "Option ";
+            command_->describe_arg(error_msg, index);
+            error_msg << " does not have a value.";
+            internel::exit_or_throw(error_msg);
+        }
+        return arg.default_value;
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_values(size_t index) const
+    {
+        std::vector<T> values;
+        if (!hit_[index]) {
+            const StaticArg &arg = command_->args_[index];
+            if (arg.type == ArgType::FLAG) {
+                values.push_back(internel::to_value<T>("0"));
+            } else if (arg.default_value != nullptr) {
+                values.push_back(internel::to_value<T>(arg.default_value));
+            }
+            return values;
+        }
+        for (int32_t i = first_value_[index]; i >= 0; i = next_value_[i]) {
+            values.push_back(internel::to_value<T>(values_[i]));
+        }
+        return values;
+    }
+
+    const StaticCommand<N> *command_ = nullptr;
+    std::array<bool, N> hit_{};
+    // 每个参数的值组成一个链表，`first_value_`、`last_value_` 是链表的头尾在 `values_` 中的下标
+    std::array<int32_t, N> first_value_{};
+    std::array<int32_t, N> last_value_{};
+    std::array<const char *, MaxValues> values_{};
+    std::array<int32_t, MaxValues> next_value_{};
+    size_t value_count_ = 0;
+    std::array<const char *, MaxValues> positions_{};
+    size_t position_count_ = 0;
+};
+
+template <size_t N>
+template <size_t MaxValues>
+void StaticCommand<N>::parse(int argc, const char *const *argv, StaticParseResult<N, MaxValues> &result) const
+{
+    result.reset(*this);
+    internel::parse_simple_args(*this, argc, argv, result);
+    for (size_t i = 0; i < N; i++) {
+        if (args_[i].type == ArgType::REQUIRED && !result.hit_[i]) {
+            std::stringstream error_msg;
+            error_msg << name_ << ": Missing required option: ";
+            describe_arg(error_msg, i);
+            error_msg << ".";
+            internel::exit_or_throw(error_msg);
+        }
+    }
+    if (result.position_count_ < position_count_) {
+        std::stringstream error_msg;
+        error_msg << name_ << ": Missing required position arguments.";
+        internel::exit_or_throw(error_msg);
+    }
+}
+
+namespace internel {
+struct BlobCommand;
+struct BlobArg;
+}  // namespace internel
+
+class SchemaBlob;
+
+// 基于二进制命令描述（`SchemaBlob`）的解析结果
+// 接口与 `ParseResult` 相同，但只支持按名字（或 `ArgKey`）取值；可以反复传给 `SchemaBlob::parse` 复用内存
+class BlobParseResult {
+   public:
+    BlobParseResult() = default;
+    BlobParseResult(const BlobParseResult &) = delete;
+    BlobParseResult(BlobParseResult &&) = default;
+    BlobParseResult &operator=(const BlobParseResult &) = delete;
+    BlobParseResult &operator=(BlobParseResult &&) = default;
+
+    // 测试用户是否传递了参数
+    bool has_arg(const char *long_name) const { return is_hit(find_arg(std::string_view(long_name))); }
+    bool has_arg(char short_name) const { return is_hit(find_arg(short_name)); }
+    bool has_arg(const ArgKey &key) const { return is_hit(find_arg(key)); }
+
+    // 获取参数的值，用户没有传递时返回默认值，都没有时报错
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(const char *long_name) const
+    {
+        return internel::to_value<T>(get_first_value(get_arg(find_arg(std::string_view(long_name)), long_name)));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(char short_name) const
+    {
+        return internel::to_value<T>(get_first_value(get_arg(find_arg(short_name), short_name)));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_value(const ArgKey &key) const
+    {
+        return internel::to_value<T>(get_first_value(get_arg(find_arg(key), key.name())));
+    }
+
+    // 获取参数的多个值
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(const char *long_name) const
+    {
+        return to_values<T>(get_values(get_arg(find_arg(std::string_view(long_name)), long_name)));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(char short_name) const
+    {
+        return to_values<T>(get_values(get_arg(find_arg(short_name), short_name)));
+    }
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    std::vector<T> get_many_values(const ArgKey &key) const
+    {
+        return to_values<T>(get_values(get_arg(find_arg(key), key.name())));
+    }
+
+    // 获取位置参数的值，`position` 指定位置，从 0 开始
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    T get_one_position_value(size_t position) const
+    {
+        if (position >= positions_.size()) {
+            std::stringstream error_msg;
+            error_msg << "No corresponding position argument.";
+            internel::exit_or_throw(error_msg);
+        }
+        return internel::to_value<T>(positions_[position]);
+    }
+
+    size_t position_count() const { return positions_.size(); }
+
+    // 获取实际的子命令的解析结果
+    const BlobParseResult &get_subcommand() const;
+    // 本结果所属命令的名字
+    std::string_view command_name_sv() const;
+
+   private:
+    friend class SchemaBlob;
+    template <typename Schema, typename Result>
+    friend void internel::parse_simple_args(const Schema &schema, int argc, const char *const *argv, Result &result);
+
+    void reset(const SchemaBlob &blob, const internel::BlobCommand &command);
+    void add_value(size_t index, const char *value);
+    void add_position_value(const char *value) { positions_.push_back(value); }
+
+    // 根据名字查找参数的下标，找不到时返回 -1
+    int32_t find_arg(std::string_view long_name) const;
+    int32_t find_arg(char short_name) const;
+    int32_t find_arg(const ArgKey &key) const;
+    bool is_hit(int32_t index) const
+    {
+        return index >= 0 && (hit_words_[static_cast<size_t>(index) >> 5] >> (index & 31) & 1) != 0;
+    }
+    // 参数不存在时报错
+    size_t get_arg(int32_t index, const char *long_name) const;
+    size_t get_arg(int32_t index, char short_name) const;
+
+    const char *get_first_value(size_t index) const;
+    std::vector<const char *> get_values(size_t index) const;
+
+    ARGPARSE_SUPPORTED_VALUE_TEMPLATE_CONSTRAINTS
+    static std::vector<T> to_values(const std::vector<const char *> &strs)
+    {
+        std::vector<T> values;
+        values.resize(strs.size());
+        std::transform(strs.cbegin(), strs.cend(), values.begin(),
+                       [](const char *value) { return internel::to_value<T>(value); });
+        return values;
+    }
+
+    const SchemaBlob *blob_ = nullptr;
+    const internel::BlobCommand *command_ = nullptr;
+    // 标识参数是否被用户传递的位集合，每个字 32 位，与二进制描述中的掩码一致
+    std::vector<uint32_t> hit_words_;
+    size_t hit_count_ = 0;
+    // 每个参数的值组成一个链表，`first_value_`、`last_value_` 是链表的头尾在 `values_` 中的下标
+    std::vector<int32_t> first_value_;
+    std::vector<int32_t> last_value_;
+    std::vector<const char *> values_;
+    std::vector<int32_t> next_value_;
+    std::vector<const char *> positions_;
+    std::unique_ptr<BlobParseResult> subcommand_result_;
+    bool has_subcommand_ = false;
+};
+
+// 二进制命令描述：由 `Command::serialize_schema` 在构建时生成（参看 `tools/argparse_schema_gen.cpp`），
+// 包含字符串表、参数记录、长名字哈希表、短名字表、子命令表以及必选参数和参数组的掩码。
+// 运行时直接在这块只读内存上解析参数，不需要构造任何 `Command`、`Arg`，也不需要插入任何 `map`，
+// 适用于参数非常多（例如数千个生成的参数、很深的子命令树）而每次启动都要付出构造开销的程序。
+// 描述可以通过 `load` 从文件 `mmap` 进来，也可以由生成器输出为数组链接到程序中，再通过 `from_memory` 使用。
+// 与 `StaticCommand` 一样，不支持取值范围、可选值、长名字的前缀匹配和单个 `-` 开头的长名字。
+// 二进制描述使用本机字节序，只能在与生成它的机器字节序相同的机器上使用，加载时校验头部、各段的边界以及
+// 每个命令和参数记录中的偏移和个数，不合法时报错。
+// 参看单元测试用例 `test_schema_blob`
+class SchemaBlob {
+   public:
+    SchemaBlob() = default;
+    SchemaBlob(const SchemaBlob &) = delete;
+    SchemaBlob(SchemaBlob &&other) noexcept;
+    SchemaBlob &operator=(const SchemaBlob &) = delete;
+    SchemaBlob &operator=(SchemaBlob &&other) noexcept;
+    ~SchemaBlob();
+
+    // 使用内存中的二进制描述，不复制数据，`data` 的生命周期需要长于本对象，且至少按 4 字节对齐
+    static SchemaBlob from_memory(const void *data, size_t size);
+    // 把文件 `mmap` 到内存中使用，本对象析构时解除映射
+    static SchemaBlob load(const char *path);
+
+    const void *data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // 运行参数解析，解析失败时通过 `exit_or_throw` 报错
+    BlobParseResult parse(int argc, const char *const *argv) const;
+    BlobParseResult parse(const std::vector<const char *> &args) const;
+    void parse(int argc, const char *const *argv, BlobParseResult &result) const;
+    void parse(const std::vector<const char *> &args, BlobParseResult &result) const;
+
+   private:
+    friend class BlobParseResult;
+    // `parse_simple_args` 所需的命令视图
+    struct CommandView;
+
+    // 校验头部、各段的边界以及每个命令和参数记录中的偏移和个数，并记录各段的起始位置，不合法时报错
+    void validate();
+
+    void do_parse(const internel::BlobCommand &command, int argc, const char *const *argv,
+                  BlobParseResult &result) const;
+    void check_result(const internel::BlobCommand &command, const BlobParseResult &result) const;
+    // 参数组的描述，例如 `[--a, -b]`
+    std::string get_group_description(const uint32_t *names, uint32_t count) const;
+
+    // 参数名字的描述，用于输出错误信息，例如 `--batch_size` 或 `-b`
+    void describe_arg(std::stringstream &error_msg, const internel::BlobArg &arg) const;
+    const internel::BlobArg &arg_at(const internel::BlobCommand &command, size_t index) const;
+    int32_t find_long(const internel::BlobCommand &command, std::string_view name, uint64_t hash) const;
+    int32_t find_short(const internel::BlobCommand &command, char name) const;
+    int32_t find_subcommand(const internel::BlobCommand &command, const char *name) const;
+
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    // 各段的起始位置，`commands_[0]` 是根命令
+    const internel::BlobCommand *commands_ = nullptr;
+    const internel::BlobArg *args_ = nullptr;
+    const uint32_t *words_ = nullptr;
+    const char *strings_ = nullptr;
+    // 通过 `load` 映射的内存，析构时解除映射
+    void *mapped_ = nullptr;
+    size_t mapped_size_ = 0;
 };
 
 }  // namespace zul
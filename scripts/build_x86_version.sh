@@ -6,7 +6,7 @@ rm -rf ./my_release/x86
 rm -rf ./tmp_build_dir
 mkdir ./tmp_build_dir
 cd ./tmp_build_dir
-cmake ..
+cmake -DRELEASE_DIR="$(cd .. && pwd)/my_release" ..
 make -j4
 cd ..
 rm -rf ./tmp_build_dir
@@ -0,0 +1,16 @@
+#!/bin/bash
+
+echo ""
+export LD_LIBRARY_PATH="./my_release/x86/lib/:LD_LIBRARY_PATH"
+for bench_bin in $(ls "./my_release/x86" | grep "^bench_*"); do
+    if [[ -f "./my_release/x86/${bench_bin}" ]]; then
+        echo "Running ***********************[${bench_bin}]***********************"
+        if ! ./my_release/x86/${bench_bin}; then
+            echo ""
+            echo "Benchmark [${bench_bin}] run failed!"
+            exit -1
+        fi
+    fi
+done
+
+echo "All benchmarks have been run completely!"
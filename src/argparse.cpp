@@ -1,20 +1,33 @@
 #include "argparse.h"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cerrno>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <list>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 
 namespace zul {  // zul = Zhang Dongyu's utils library.
 
 namespace internel {
 
-std::stringstream error_msg;
-
 void exit_or_throw(std::stringstream &error_msg)
 {
     if (config_exit_when_error) {
@@ -23,12 +36,744 @@ void exit_or_throw(std::stringstream &error_msg)
         }
         exit(1);
     } else {
-        std::string the_err_msg(error_msg.str());
-        error_msg = std::stringstream();
-        throw ParseArgsError(std::move(the_err_msg));
+        throw ParseArgsError(error_msg.str());
+    }
+}
+
+void static_schema_error(const char *message)
+{
+    std::stringstream error_msg;
+    error_msg << message;
+    exit_or_throw(error_msg);
+}
+
+bool PerfectHashTable::build(const std::vector<std::string_view> &names, const std::vector<int32_t> &values)
+{
+    std::vector<std::string_view> sorted_names(names);
+    std::sort(sorted_names.begin(), sorted_names.end());
+    if (std::adjacent_find(sorted_names.begin(), sorted_names.end()) != sorted_names.end()) {
+        return false;
+    }
+
+    size_ = names.size();
+    if (names.empty()) {
+        displacements_.clear();
+        slots_.clear();
+        return true;
+    }
+
+    // 槽位数取不小于名字个数的 2 的幂，找不到合适的位移值时先扩大槽位数，再更换哈希种子
+    uint32_t slot_count = 1;
+    while (slot_count < names.size()) {
+        slot_count <<= 1;
+    }
+    for (seed_ = 0;; seed_++) {
+        for (uint32_t count = slot_count; count <= slot_count * 4; count <<= 1) {
+            if (try_build(names, values, count)) {
+                return true;
+            }
+        }
+    }
+}
+
+bool PerfectHashTable::try_build(const std::vector<std::string_view> &names, const std::vector<int32_t> &values,
+                                 uint32_t slot_count)
+{
+    // 平均每个桶 4 个名字
+    displacements_.assign((names.size() + 3) / 4, Displacement());
+    slots_.assign(slot_count, Slot());
+    slot_mask_ = slot_count - 1;
+
+    std::vector<uint64_t> hashes(names.size());
+    std::vector<std::vector<uint32_t>> buckets(displacements_.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        hashes[i] = hash_name(names[i], seed_);
+        buckets[bucket_index(hashes[i])].push_back(static_cast<uint32_t>(i));
+    }
+
+    // 先处理名字多的桶，此时空闲的槽位多，更容易找到合适的位移值
+    std::vector<uint32_t> bucket_order(buckets.size());
+    for (uint32_t i = 0; i < bucket_order.size(); i++) {
+        bucket_order[i] = i;
+    }
+    std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                     [&buckets](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    std::vector<uint32_t> candidate_slots;
+    for (uint32_t bucket : bucket_order) {
+        const std::vector<uint32_t> &keys = buckets[bucket];
+        if (keys.empty()) {
+            break;
+        }
+        bool found = false;
+        for (uint64_t d = 0; d < static_cast<uint64_t>(slot_count) * slot_count && !found; d++) {
+            Displacement displacement{static_cast<uint32_t>(d % slot_count), static_cast<uint32_t>(d / slot_count)};
+            candidate_slots.clear();
+            found = true;
+            for (uint32_t key : keys) {
+                uint32_t slot = slot_index(hashes[key], displacement);
+                if (slots_[slot].value >= 0 ||
+                    std::find(candidate_slots.begin(), candidate_slots.end(), slot) != candidate_slots.end()) {
+                    found = false;
+                    break;
+                }
+                candidate_slots.push_back(slot);
+            }
+            if (found) {
+                displacements_[bucket] = displacement;
+                for (size_t i = 0; i < keys.size(); i++) {
+                    Slot &slot = slots_[candidate_slots[i]];
+                    slot.name = names[keys[i]].data();
+                    slot.length = static_cast<uint32_t>(names[keys[i]].size());
+                    slot.value = values[keys[i]];
+                }
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RadixTrie::build(const std::vector<std::string_view> &names, const std::vector<int32_t> &values)
+{
+    std::vector<Entry> entries;
+    entries.reserve(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        entries.emplace_back(names[i], values[i]);
+    }
+    std::sort(entries.begin(), entries.end());
+    auto same_name = [](const Entry &a, const Entry &b) { return a.first == b.first; };
+    if (std::adjacent_find(entries.begin(), entries.end(), same_name) != entries.end()) {
+        return false;
+    }
+
+    size_ = entries.size();
+    labels_.clear();
+    nodes_.assign(1, Node());
+    build_node(0, entries, 0, entries.size(), 0);
+    return true;
+}
+
+void RadixTrie::build_node(uint32_t node, const std::vector<Entry> &entries, size_t begin, size_t end, size_t depth)
+{
+    // `entries[begin, end)` 已排序，且前 `depth` 个字符都相同
+    if (end - begin == 1) {
+        nodes_[node].unique_value = entries[begin].second;
+    } else if (end - begin > 1) {
+        nodes_[node].unique_value = AMBIGUOUS;
+    }
+    if (begin < end && entries[begin].first.size() == depth) {
+        nodes_[node].value = entries[begin].second;
+        begin++;
+    }
+
+    // 按第 `depth` 个字符分组，每组对应一个子节点
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t i = begin; i < end;) {
+        size_t j = i + 1;
+        while (j < end && entries[j].first[depth] == entries[i].first[depth]) {
+            j++;
+        }
+        groups.emplace_back(i, j);
+        i = j;
+    }
+
+    uint32_t first_child = static_cast<uint32_t>(nodes_.size());
+    nodes_[node].first_child = first_child;
+    nodes_[node].child_count = static_cast<uint32_t>(groups.size());
+    nodes_.resize(nodes_.size() + groups.size());
+    for (size_t k = 0; k < groups.size(); k++) {
+        // 组内已排序，首尾两个名字的公共前缀即整组的公共前缀，作为子节点的边标签
+        std::string_view first = entries[groups[k].first].first;
+        std::string_view last = entries[groups[k].second - 1].first;
+        size_t length = depth + 1;
+        while (length < first.size() && length < last.size() && first[length] == last[length]) {
+            length++;
+        }
+        Node &child = nodes_[first_child + k];
+        child.label_offset = static_cast<uint32_t>(labels_.size());
+        child.label_length = static_cast<uint32_t>(length - depth);
+        labels_.append(first.substr(depth, length - depth));
+        build_node(static_cast<uint32_t>(first_child + k), entries, groups[k].first, groups[k].second, length);
+    }
+}
+
+uint32_t RadixTrie::descend(std::string_view prefix, bool &at_node_end) const
+{
+    const uint32_t not_found = static_cast<uint32_t>(nodes_.size());
+    at_node_end = true;
+    if (nodes_.empty()) {
+        return not_found;
+    }
+
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < prefix.size()) {
+        // 子节点按边标签的首字符排序，二分查找
+        const Node &parent = nodes_[node];
+        auto first = nodes_.begin() + parent.first_child;
+        auto last = first + parent.child_count;
+        unsigned char ch = static_cast<unsigned char>(prefix[pos]);
+        auto iter = std::lower_bound(first, last, ch, [this](const Node &child, unsigned char c) {
+            return static_cast<unsigned char>(labels_[child.label_offset]) < c;
+        });
+        if (iter == last || static_cast<unsigned char>(labels_[iter->label_offset]) != ch) {
+            return not_found;
+        }
+
+        size_t length = std::min<size_t>(iter->label_length, prefix.size() - pos);
+        if (memcmp(labels_.data() + iter->label_offset, prefix.data() + pos, length) != 0) {
+            return not_found;
+        }
+        node = static_cast<uint32_t>(iter - nodes_.begin());
+        pos += length;
+        at_node_end = length == iter->label_length;
+    }
+    return node;
+}
+
+int32_t RadixTrie::find_prefix(std::string_view prefix) const
+{
+    bool at_node_end = false;
+    uint32_t node = descend(prefix, at_node_end);
+    if (node == nodes_.size()) {
+        return NOT_FOUND;
+    }
+    if (at_node_end && nodes_[node].value != NOT_FOUND) {
+        return nodes_[node].value;
+    }
+    return nodes_[node].unique_value;
+}
+
+void RadixTrie::collect(std::string_view prefix, std::vector<int32_t> &values) const
+{
+    bool at_node_end = false;
+    uint32_t node = descend(prefix, at_node_end);
+    if (node != nodes_.size()) {
+        collect_node(node, values);
+    }
+}
+
+void RadixTrie::collect_node(uint32_t node, std::vector<int32_t> &values) const
+{
+    if (nodes_[node].value != NOT_FOUND) {
+        values.push_back(nodes_[node].value);
+    }
+    for (uint32_t i = 0; i < nodes_[node].child_count; i++) {
+        collect_node(nodes_[node].first_child + i, values);
+    }
+}
+
+ParsedValue::ParsedValue(const char *str) : str_(str)
+{
+    // 依次尝试转换为 `int64_t`、`uint64_t`、`double`，整数同时缓存其 `double` 值（整数转换为 `double` 也是正确舍入的）
+    std::string_view view(str);
+    int64_t int_value = 0;
+    uint64_t uint_value = 0;
+    if (try_to_number(view, int_value) == ConvertResult::OK) {
+        bits_ = static_cast<uint64_t>(int_value);
+        double_ = static_cast<double>(int_value);
+        kinds_ = int_value >= 0 ? (INT | UINT | DOUBLE) : (INT | DOUBLE);
+    } else if (try_to_number(view, uint_value) == ConvertResult::OK) {
+        bits_ = uint_value;
+        double_ = static_cast<double>(uint_value);
+        kinds_ = UINT | DOUBLE;
+    } else if (try_to_number(view, double_) == ConvertResult::OK) {
+        kinds_ = DOUBLE;
+    }
+}
+
+void ParsedValue::set_choice_id(int64_t id)
+{
+    choice_ = static_cast<uint64_t>(id);
+    kinds_ = (kinds_ & ~CHOICE_MASK) | CHOICE_ID;
+}
+
+void ParsedValue::set_choice_mask(uint64_t mask)
+{
+    choice_ = mask;
+    kinds_ = (kinds_ & ~CHOICE_ID) | CHOICE_MASK;
+}
+
+void GroupMask::build(const std::vector<uint32_t> &indexes)
+{
+    std::vector<uint32_t> sorted_indexes(indexes);
+    std::sort(sorted_indexes.begin(), sorted_indexes.end());
+    sorted_indexes.erase(std::unique(sorted_indexes.begin(), sorted_indexes.end()), sorted_indexes.end());
+
+    words_.clear();
+    for (uint32_t index : sorted_indexes) {
+        uint32_t word_index = index >> 6;
+        if (words_.empty() || words_.back().first != word_index) {
+            words_.emplace_back(word_index, 0);
+        }
+        words_.back().second |= uint64_t(1) << (index & 63);
+    }
+    size_ = sorted_indexes.size();
+}
+
+// 二进制命令描述（`SchemaBlob`）的格式，所有字段都是本机字节序的 32 位无符号整数
+// 布局为：`BlobHeader` | `BlobCommand` 数组 | `BlobArg` 数组 | `uint32_t` 数组 | 字符串表
+// 记录中的字符串都是在字符串表中的偏移，字符串以 `\0` 结尾；哈希表、短名字表等都是在 `uint32_t` 数组中的下标
+constexpr uint32_t BLOB_MAGIC = 0x4250415A;  // "ZAPB"
+constexpr uint32_t BLOB_VERSION = 1;
+constexpr uint32_t BLOB_NONE = 0xFFFFFFFF;
+
+struct BlobHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;           // 整个描述的字节数
+    uint32_t command_count;  // 第 0 个命令是根命令
+    uint32_t arg_count;
+    uint32_t word_count;
+    uint32_t string_size;
+};
+
+struct BlobCommand {
+    uint32_t name;
+    uint32_t usage;  // 帮助信息，没有时为 `BLOB_NONE`
+    // 本命令的参数是 `BlobArg` 数组中从 `arg_begin` 开始的 `arg_count` 个，下边的参数下标都是相对于 `arg_begin` 的
+    uint32_t arg_begin;
+    uint32_t arg_count;
+    uint32_t position_count;  // 必须传递的位置参数个数
+    // 长名字哈希表，槽位数为 2 的幂，使用线性探测，槽位中是参数下标，空槽位为 `BLOB_NONE`
+    uint32_t long_slots;
+    uint32_t long_slot_count;
+    // 短名字表，每项为（字符，参数下标）
+    uint32_t shorts;
+    uint32_t short_count;
+    // 子命令表，每项为（名字，命令下标），按名字排序
+    uint32_t subcommands;
+    uint32_t subcommand_count;
+    // 掩码每个字 32 位，第 i 位对应第 i 个参数，每个掩码有 `mask_words` 个字
+    uint32_t mask_words;
+    uint32_t required_mask;
+    uint32_t conflict_with_all_mask;
+    // 参数组，每组依次为：种类（`BlobGroupKind`）、名字个数、名字、掩码
+    uint32_t groups;
+    uint32_t group_count;
+};
+
+struct BlobArg {
+    uint32_t long_name;  // 没有时为 `BLOB_NONE`
+    uint32_t long_length;
+    uint32_t short_name;  // 没有时为 `' '`
+    uint32_t type;        // `ArgType`
+    // 默认值，每项为一个字符串
+    uint32_t defaults;
+    uint32_t default_count;
+};
+
+// 传递了标志参数时它的值，编码解析结果时按地址区分它与 `argv` 中的值
+const char FLAG_VALUE[] = "1";
+
+enum BlobGroupKind : uint32_t { BLOB_RELATED_GROUP, BLOB_CONFLICT_GROUP, BLOB_ONE_REQUIRED_GROUP };
+
+// 持久化的解析结果缓存文件（参看 `PersistentParseCache`）
+// 文件头之后是 `slot_count` 个大小为 `CACHE_SLOT_SIZE` 的槽位，每个槽位依次为：槽位头、解析结果的编码、
+// 参数列表的内容（每个参数以 '\0' 结尾）。编码以命令为单位（子命令紧跟在父命令之后），依次为：
+//     参数个数
+//     子命令名字在 `argv` 中的下标，没有子命令时为 `CACHE_NO_SUBCOMMAND`
+//     命中或者有值的参数个数，每个参数依次为：参数下标（命中时最高位为 1）、值的个数、每个值
+//     每个值为它在 `argv` 中的下标，标志参数的值 `FLAG_VALUE` 的下标为 `CACHE_FLAG_VALUE`，之后没有其它字段；
+//     其它值之后依次为在 `argv[下标]` 中的偏移、`ParsedValue` 中的 `kinds`，以及按 `kinds` 保存的整数、浮点数、
+//     可选值的 ID 或位掩码（只保存有效的字段）
+//     位置参数的个数，每个位置参数在 `argv` 中的下标和偏移
+// 之后是子命令的编码。值保存转换好的数值，槽位的认证码校验通过后直接使用，不再重新转换和校验
+// 槽位的键和认证码都用密钥文件中的密钥计算：键由命令描述的指纹和参数列表得出，认证码覆盖槽位头和解析结果的编码，
+// 因此参数列表本身不需要计算认证码，只用于与本次调用的参数列表逐字节比较
+constexpr uint32_t CACHE_MAGIC = 0x43524150;  // "PARC"
+constexpr uint32_t CACHE_VERSION = 3;
+constexpr size_t CACHE_HEADER_SIZE = 64;
+constexpr size_t CACHE_SLOT_SIZE = 4096;
+// 值不在 `argv` 中（标志参数的值 `FLAG_VALUE`）时的下标
+constexpr uint32_t CACHE_FLAG_VALUE = UINT32_MAX;
+constexpr uint32_t CACHE_NO_SUBCOMMAND = UINT32_MAX;
+// 参数下标中表示参数被命中的位
+constexpr uint32_t CACHE_HIT_BIT = 0x80000000;
+// 密钥文件的大小，即 SipHash 密钥的大小
+constexpr size_t CACHE_KEY_SIZE = 16;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+};
+
+struct CacheSlot {
+    // 槽位头的其它字段和解析结果的编码的认证码，为 0 表示空槽位
+    uint64_t mac;
+    // 用密钥对命令描述的指纹和参数列表计算的键，以及命令描述的指纹
+    uint64_t key;
+    uint64_t fingerprint;
+    uint32_t argc;
+    uint32_t argv_size;
+    uint32_t result_size;
+    uint32_t reserved;
+};
+
+template <typename T>
+void append_pod(std::string &out, const T &value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+bool read_pod(const char *&data, const char *end, T &value)
+{
+    if (static_cast<size_t>(end - data) < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, data, sizeof(value));
+    data += sizeof(value);
+    return true;
+}
+
+// SipHash-2-4：以 128 位密钥计算的消息认证码，没有密钥时无法构造出认证码相同的数据
+uint64_t siphash24(const uint64_t key[2], const uint8_t *data, size_t size)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+    auto rotl = [](uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); };
+    auto sip_round = [&]() {
+        v0 += v1;
+        v1 = rotl(v1, 13) ^ v0;
+        v0 = rotl(v0, 32);
+        v2 += v3;
+        v3 = rotl(v3, 16) ^ v2;
+        v0 += v3;
+        v3 = rotl(v3, 21) ^ v0;
+        v2 += v1;
+        v1 = rotl(v1, 17) ^ v2;
+        v2 = rotl(v2, 32);
+    };
+    auto compress = [&](uint64_t word) {
+        v3 ^= word;
+        sip_round();
+        sip_round();
+        v0 ^= word;
+    };
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        compress(word);
+    }
+    uint64_t last = uint64_t(size) << 56;
+    for (size_t j = 0; i + j < size; j++) {
+        last |= uint64_t(data[i + j]) << (8 * j);
+    }
+    compress(last);
+    v2 ^= 0xff;
+    for (int round = 0; round < 4; round++) {
+        sip_round();
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// 槽位的认证码，覆盖 `mac` 之后的 `size - 8` 个字节。0 表示空槽位
+uint64_t cache_mac(const uint64_t key[2], const uint8_t *slot, size_t size)
+{
+    uint64_t mac = siphash24(key, slot + sizeof(uint64_t), size - sizeof(uint64_t));
+    return mac == 0 ? 1 : mac;
+}
+
+// 打开并检查属于当前用户、其它用户不可写的普通文件，不跟随符号链接。不满足时返回 -1
+int open_private_file(const char *path, struct stat &file_stat)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_uid != geteuid() ||
+        (file_stat.st_mode & 022) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 读取密钥文件中的密钥，密钥文件为空（刚创建）时生成随机密钥并写入。调用者需持有缓存文件的锁
+bool load_cache_key(const std::string &path, uint64_t key[2])
+{
+    struct stat file_stat {};
+    int fd = open_private_file(path.c_str(), file_stat);
+    if (fd < 0) {
+        return false;
     }
+    bool ok = false;
+    if (file_stat.st_size == 0) {
+        ok = getrandom(key, CACHE_KEY_SIZE, 0) == static_cast<ssize_t>(CACHE_KEY_SIZE) &&
+             pwrite(fd, key, CACHE_KEY_SIZE, 0) == static_cast<ssize_t>(CACHE_KEY_SIZE);
+    } else if (file_stat.st_size == static_cast<off_t>(CACHE_KEY_SIZE)) {
+        ok = pread(fd, key, CACHE_KEY_SIZE, 0) == static_cast<ssize_t>(CACHE_KEY_SIZE);
+    }
+    close(fd);
+    return ok;
 }
 
+// 工作窃取线程池
+// 每次 `run` 把 [0, count) 切分成若干块，轮流分给每个线程的队列。线程先从自己队列的尾部取块执行，
+// 自己的队列空了之后再从其它线程队列的头部窃取，因此某些参数列表特别长（解析得慢）时，其它线程会分担剩余的块。
+// 调用 `run` 的线程也作为 0 号线程参与执行，后台线程在两次 `run` 之间休眠
+class WorkStealingPool {
+   public:
+    explicit WorkStealingPool(size_t thread_count) : queues_(thread_count)
+    {
+        for (size_t i = 1; i < thread_count; i++) {
+            threads_.emplace_back([this, i]() { worker_loop(i); });
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        start_cv_.notify_all();
+        for (auto &thread : threads_) {
+            thread.join();
+        }
+    }
+
+    size_t thread_count() const { return queues_.size(); }
+
+    // 在所有线程上执行 `task(begin, end)`，覆盖 [0, count)，全部执行完后返回
+    void run(size_t count, const std::function<void(size_t, size_t)> &task)
+    {
+        if (count == 0) {
+            return;
+        }
+        // 每个线程平均分到若干块：块太大时负载不均衡，块太小时取块的开销占比变大
+        constexpr size_t chunks_per_thread = 16;
+        size_t chunk_size = std::max<size_t>(1, count / (queues_.size() * chunks_per_thread));
+        size_t queue_index = 0;
+        for (size_t begin = 0; begin < count; begin += chunk_size) {
+            Queue &queue = queues_[queue_index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.chunks.emplace_back(begin, std::min(count, begin + chunk_size));
+            queue_index = (queue_index + 1) % queues_.size();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            active_ = threads_.size();
+            generation_++;
+        }
+        start_cv_.notify_all();
+        work(0);
+        // 所有后台线程都结束本次执行后才能返回，`task` 在此之前需要保持有效
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() { return active_ == 0; });
+        task_ = nullptr;
+    }
+
+   private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::pair<size_t, size_t>> chunks;
+    };
+
+    void worker_loop(size_t index)
+    {
+        uint64_t seen_generation = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_cv_.wait(lock, [&]() { return stopping_ || generation_ != seen_generation; });
+                if (stopping_) {
+                    return;
+                }
+                seen_generation = generation_;
+            }
+            work(index);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--active_ == 0) {
+                done_cv_.notify_one();
+            }
+        }
+    }
+
+    // 执行块直到所有队列都空了为止。块只在 `run` 开始时加入队列，因此所有队列都空了之后不会再有新的块
+    void work(size_t index)
+    {
+        std::pair<size_t, size_t> chunk;
+        while (take(index, chunk)) {
+            (*task_)(chunk.first, chunk.second);
+        }
+    }
+
+    bool take(size_t index, std::pair<size_t, size_t> &chunk)
+    {
+        {
+            Queue &own = queues_[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.chunks.empty()) {
+                chunk = own.chunks.back();
+                own.chunks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues_.size(); i++) {
+            Queue &victim = queues_[(index + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.chunks.empty()) {
+                chunk = victim.chunks.front();
+                victim.chunks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<Queue> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const std::function<void(size_t, size_t)> *task_ = nullptr;
+    // 每次 `run` 加一，后台线程据此判断是否有新的任务
+    uint64_t generation_ = 0;
+    // 本次 `run` 中还没有执行完的后台线程个数
+    size_t active_ = 0;
+    bool stopping_ = false;
+};
+
+// 解析结果缓存
+// 以参数列表内容的哈希值为键，按哈希值分成若干分片，每个分片有自己的锁和 LRU 链表，多个线程同时查找时
+// 只有落在同一个分片上才会竞争。淘汰在分片内进行，因此是近似的 LRU
+class ParseCache {
+   public:
+    // 缓存的一项：复制的参数列表以及在其上解析得到的结果
+    struct Entry {
+        Entry(uint64_t hash, int argc, const char *const *argv) : hash(hash)
+        {
+            size_t length = 0;
+            for (int i = 0; i < argc; i++) {
+                length += strlen(argv[i]) + 1;
+            }
+            // 预留好空间，保证追加时不会重新分配，`argv` 中的指针一直有效
+            text.reserve(length);
+            this->argv.reserve(argc);
+            for (int i = 0; i < argc; i++) {
+                this->argv.push_back(text.data() + text.size());
+                text.append(argv[i]).push_back('\0');
+            }
+        }
+
+        bool same_argv(int argc, const char *const *argv) const
+        {
+            if (static_cast<size_t>(argc) != this->argv.size()) {
+                return false;
+            }
+            for (int i = 0; i < argc; i++) {
+                if (strcmp(argv[i], this->argv[i]) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        uint64_t hash;
+        std::string text;
+        std::vector<const char *> argv;
+        ParseResult result;
+    };
+
+    explicit ParseCache(size_t capacity) : shards_(std::min(capacity, MAX_SHARD_COUNT)), capacity_(capacity)
+    {
+        // 把容量尽量平均地分给每个分片，总容量恰好为 `capacity`
+        for (size_t i = 0; i < shards_.size(); i++) {
+            shards_[i].capacity = capacity / shards_.size() + (i < capacity % shards_.size() ? 1 : 0);
+        }
+    }
+
+    static uint64_t hash_argv(int argc, const char *const *argv)
+    {
+        uint64_t hash = hash_name(std::string_view(), static_cast<uint64_t>(argc));
+        for (int i = 0; i < argc; i++) {
+            hash = hash_name(argv[i], hash);
+        }
+        return hash;
+    }
+
+    // 查找内容相同的参数列表的解析结果，找到时把它移到 LRU 链表的头部，找不到时返回空
+    std::shared_ptr<const ParseResult> find(uint64_t hash, int argc, const char *const *argv)
+    {
+        Shard &shard = get_shard(hash);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto iter = shard.index.find(hash);
+            // 哈希值相同但内容不同（极少见）时按未命中处理
+            if (iter != shard.index.end() && (*iter->second)->same_argv(argc, argv)) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                const std::shared_ptr<Entry> &entry = *iter->second;
+                return std::shared_ptr<const ParseResult>(entry, &entry->result);
+            }
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // 加入缓存，超出容量时淘汰分片中最久未使用的一项。多个线程同时解析同一个参数列表时保留先加入的一项
+    void insert(std::shared_ptr<Entry> entry)
+    {
+        Shard &shard = get_shard(entry->hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.index.count(entry->hash) == 1) {
+            return;
+        }
+        if (shard.lru.size() == shard.capacity) {
+            shard.index.erase(shard.lru.back()->hash);
+            shard.lru.pop_back();
+        }
+        shard.lru.push_front(std::move(entry));
+        shard.index.emplace(shard.lru.front()->hash, shard.lru.begin());
+    }
+
+    ParseCacheStats stats()
+    {
+        ParseCacheStats stats;
+        stats.hits = hits_.load(std::memory_order_relaxed);
+        stats.misses = misses_.load(std::memory_order_relaxed);
+        stats.capacity = capacity_;
+        for (Shard &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            stats.size += shard.lru.size();
+        }
+        return stats;
+    }
+
+   private:
+    static constexpr size_t MAX_SHARD_COUNT = 16;
+
+    struct Shard {
+        std::mutex mutex;
+        size_t capacity = 0;
+        // 头部是最近使用的
+        std::list<std::shared_ptr<Entry>> lru;
+        std::unordered_map<uint64_t, std::list<std::shared_ptr<Entry>>::iterator> index;
+    };
+
+    // 低位用于分片内的哈希表，分片使用高位
+    Shard &get_shard(uint64_t hash) { return shards_[(hash >> 32) % shards_.size()]; }
+
+    std::vector<Shard> shards_;
+    size_t capacity_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
 }  // namespace internel
 
 Arg::Arg(Private, ArgType type) { arg_type_ = type; }
@@ -44,198 +789,2323 @@ std::shared_ptr<Arg> Arg::new_arg(ArgType type) { return std::make_shared<Arg>(P
 
 std::shared_ptr<Arg> Arg::long_name(const char *name)
 {
+    set_long_name(name);
+    return shared_from_this();
+}
+
+std::shared_ptr<Arg> Arg::short_name(char name)
+{
+    set_short_name(name);
+    return shared_from_this();
+}
+
+std::shared_ptr<Arg> Arg::conflicts_with_all()
+{
+    set_conflicts_with_all();
+    return shared_from_this();
+}
+
+std::shared_ptr<Arg> Arg::default_value(const char *value)
+{
+    set_default_value(value);
+    return shared_from_this();
+}
+
+std::shared_ptr<Arg> Arg::default_values(std::vector<const char *> &&values)
+{
+    set_default_values(std::move(values));
+    return shared_from_this();
+}
+
+std::shared_ptr<Arg> Arg::range(NumType type, const char *left, const char *right, bool include_left,
+                                bool include_right)
+{
+    set_range(type, left, right, include_left, include_right);
+    return shared_from_this();
+}
+
+std::shared_ptr<Arg> Arg::choices(std::vector<const char *> &&choices)
+{
+    set_choices(std::move(choices));
+    return shared_from_this();
+}
+
+std::shared_ptr<Arg> Arg::choices(std::initializer_list<std::pair<const char *, int64_t>> choices, bool allow_list)
+{
+    set_choices(choices, allow_list);
+    return shared_from_this();
+}
+
+void Arg::set_long_name(const char *name)
+{
+    check_not_compiled();
     if (arg_type_ == ArgType::POSITION) {
-        internel::error_msg << "Position argument can not set long name.";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "Position argument can not set long name.";
+        internel::exit_or_throw(error_msg);
     }
     if (strncmp(name, "help", 4) == 0) {
-        internel::error_msg << "The option of --help and -h have been automatically added. Just run: xx.bin "
-                               "--help or xx.bin -h "
-                               "to show the usage help.";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "The option of --help and -h have been automatically added. Just run: xx.bin "
+                     "--help or xx.bin -h "
+                     "to show the usage help.";
+        internel::exit_or_throw(error_msg);
     }
     if (strlen(name) < 2) {
-        internel::error_msg << "The length of long option must be greater than 2.";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "The length of long option must be greater than 2.";
+        internel::exit_or_throw(error_msg);
     }
     if (strncmp(name, "-", 1) == 0) {
-        internel::error_msg << "The name cannot start with -- or - .";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "The name cannot start with -- or - .";
+        internel::exit_or_throw(error_msg);
     }
     if (std::any_of(name, name + strlen(name), [](const char elem) { return elem == ' '; })) {
-        internel::error_msg << "The long option can not contain spaces.";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "The long option can not contain spaces.";
+        internel::exit_or_throw(error_msg);
     }
     long_name_ = name;
-    return shared_from_this();
 }
 
-std::shared_ptr<Arg> Arg::short_name(char name)
+void Arg::set_short_name(char name)
 {
+    check_not_compiled();
     if (arg_type_ == ArgType::POSITION) {
-        internel::error_msg << "Position argument can not set short name.";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "Position argument can not set short name.";
+        internel::exit_or_throw(error_msg);
     }
     if (name == 'h') {
-        internel::error_msg << "The option of --help and -h have been automatically added. Just run: xx.bin "
-                               "--help or xx.bin -h "
-                               "to show the usage help.";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "The option of --help and -h have been automatically added. Just run: xx.bin "
+                     "--help or xx.bin -h "
+                     "to show the usage help.";
+        internel::exit_or_throw(error_msg);
     }
     if (name == ' ') {
-        internel::error_msg << "The short option can not be a space.";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "The short option can not be a space.";
+        internel::exit_or_throw(error_msg);
     }
     short_name_ = name;
-
-    return shared_from_this();
 }
 
-std::shared_ptr<Arg> Arg::conflicts_with_all()
+void Arg::set_conflicts_with_all()
 {
+    check_not_compiled();
     if (arg_type_ == ArgType::REQUIRED || arg_type_ == ArgType::POSITION) {
-        internel::error_msg << "The required argument or position argument can not set related options.";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "The required argument or position argument can not set related options.";
+        internel::exit_or_throw(error_msg);
     }
-    is_conflict_with_all_ = true;
-    return shared_from_this();
+    set_flag(CONFLICT_WITH_ALL);
 }
 
-std::shared_ptr<Arg> Arg::default_value(const char *value)
+void Arg::set_default_value(const char *value)
 {
+    check_not_compiled();
     if (arg_type_ != ArgType::OPTIONAL) {
-        internel::error_msg << "Only optional argument can set default value.";
-        internel::exit_or_throw(internel::error_msg);
+        std::stringstream error_msg;
+        error_msg << "Only optional argument can set default value.";
+        internel::exit_or_throw(error_msg);
     }
-    values_.push_back(value);
-    default_values_.push_back(std::move(value));
-    has_default_value_ = true;
-    check_range();
-    check_choice();
-    return shared_from_this();
+    internel::ParsedValue parsed_value(value);
+    check_value(parsed_value);
+    default_values_.push_back(parsed_value);
+    set_flag(HAS_DEFAULT_VALUE);
+}
+
+void Arg::set_default_values(std::vector<const char *> &&values)
+{
+    check_not_compiled();
+    if (arg_type_ != ArgType::OPTIONAL) {
+        std::stringstream error_msg;
+        error_msg << "Only optional argument can set default values.";
+        internel::exit_or_throw(error_msg);
+    }
+    if (values.empty()) {
+        std::stringstream error_msg;
+        error_msg << "The default values can not empty.";
+        internel::exit_or_throw(error_msg);
+    }
+    internel::ParsedValues parsed_values;
+    for (const char *value : values) {
+        internel::ParsedValue parsed_value(value);
+        check_value(parsed_value);
+        parsed_values.push_back(parsed_value);
+    }
+    default_values_ = std::move(parsed_values);
+    set_flag(HAS_DEFAULT_VALUE);
+}
+
+void Arg::set_range(NumType type, const char *left, const char *right, bool include_left, bool include_right)
+{
+    // 边界只在这里转换一次，不合法的边界在声明参数时就报错，而不是等到解析参数时
+    internel::RangeBound bounds[2]{};
+    const char *texts[2] = {left, right};
+    for (int i = 0; i < 2; i++) {
+        internel::ParsedValue value(texts[i]);
+        bool is_valid = false;
+        if (type == NumType::INT) {
+            is_valid = value.is_int();
+            bounds[i].int_value = value.as_int();
+        } else if (type == NumType::UINT) {
+            is_valid = value.is_uint();
+            bounds[i].uint_value = value.as_uint();
+        } else if (type == NumType::DOUBlE) {
+            is_valid = value.is_double();
+            bounds[i].double_value = value.as_double();
+        }
+        if (!is_valid) {
+            std::stringstream error_msg;
+            error_msg << "The range boundary '" << texts[i] << "' is not a valid "
+                      << (type == NumType::INT ? "int64_t" : type == NumType::UINT ? "uint64_t" : "double") << ".";
+            internel::exit_or_throw(error_msg);
+        }
+    }
+    set_range(type, bounds[0], bounds[1], left, right, include_left, include_right);
+}
+
+void Arg::set_range(NumType type, internel::RangeBound left, internel::RangeBound right, const char *left_text,
+                    const char *right_text, bool include_left, bool include_right)
+{
+    check_not_compiled();
+    if (arg_type_ == ArgType::FLAG) {
+        std::stringstream error_msg;
+        error_msg << "The flag option can not set value range.";
+        internel::exit_or_throw(error_msg);
+    }
+    if (has_flag(IS_CHOICE)) {
+        std::stringstream error_msg;
+        error_msg << "The selection value has been set for the option, and the range value can not be "
+                     "set again.";
+        internel::exit_or_throw(error_msg);
+    }
+
+    bool is_valid = true;
+    if (type == NumType::INT) {
+        is_valid = left.int_value <= right.int_value;
+    } else if (type == NumType::UINT) {
+        is_valid = left.uint_value <= right.uint_value;
+    } else if (type == NumType::DOUBlE) {
+        // 边界为 NaN 时比较结果也为 `false`
+        is_valid = left.double_value <= right.double_value;
+    }
+    if (!is_valid) {
+        std::stringstream error_msg;
+        error_msg << "The left boundary of the range can not be greater than the right boundary.";
+        internel::exit_or_throw(error_msg);
+    }
+
+    // 边界以数值给出时，使用最短且能精确还原的格式生成文本
+    auto to_text = [type](internel::RangeBound bound) {
+        char buffer[32];
+        std::to_chars_result result;
+        if (type == NumType::INT) {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), bound.int_value);
+        } else if (type == NumType::UINT) {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), bound.uint_value);
+        } else {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), bound.double_value);
+        }
+        return std::string(buffer, result.ptr);
+    };
+    ValueRule &rule = mutable_rule();
+    rule.left = left;
+    rule.right = right;
+    rule.left_text = left_text ? std::string(left_text) : to_text(left);
+    rule.right_text = right_text ? std::string(right_text) : to_text(right);
+    rule.include_left = include_left;
+    rule.include_right = include_right;
+    rule.num_type = type;
+    set_flag(IS_RANGE);
+}
+
+void Arg::set_choices(std::vector<const char *> &&choices)
+{
+    std::vector<std::pair<const char *, int64_t>> id_choices;
+    id_choices.reserve(choices.size());
+    for (const char *choice : choices) {
+        id_choices.emplace_back(choice, 0);
+    }
+    set_choices(std::move(id_choices), false, false);
+}
+
+void Arg::set_choices(std::initializer_list<std::pair<const char *, int64_t>> choices, bool allow_list)
+{
+    set_choices(std::vector<std::pair<const char *, int64_t>>(choices), true, allow_list);
+}
+
+void Arg::set_choices(std::vector<std::pair<const char *, int64_t>> &&choices, bool has_ids, bool allow_list)
+{
+    check_not_compiled();
+    if (arg_type_ == ArgType::FLAG) {
+        std::stringstream error_msg;
+        error_msg << "The flag option can not set value choices.";
+        internel::exit_or_throw(error_msg);
+    }
+    if (has_flag(IS_RANGE)) {
+        std::stringstream error_msg;
+        error_msg << "The range value has been set for the option, and the selection value can not be "
+                     "set again.";
+        internel::exit_or_throw(error_msg);
+    }
+    if (choices.empty()) {
+        std::stringstream error_msg;
+        error_msg << "The value choices vector can not empty.";
+        internel::exit_or_throw(error_msg);
+    }
+
+    // 排序并去重后冻结为连续存储的数组，同时预先生成描述信息
+    // 带 ID 的可选值不允许重复，因为无法确定重复的名字对应哪一个 ID
+    std::stable_sort(choices.begin(), choices.end(),
+                     [](const auto &a, const auto &b) { return strcmp(a.first, b.first) < 0; });
+    auto same_name = [](const auto &a, const auto &b) { return strcmp(a.first, b.first) == 0; };
+    if (has_ids) {
+        auto iter = std::adjacent_find(choices.begin(), choices.end(), same_name);
+        if (iter != choices.end()) {
+            std::stringstream error_msg;
+            error_msg << "Duplicate choice '" << iter->first << "'.";
+            internel::exit_or_throw(error_msg);
+        }
+    } else {
+        choices.erase(std::unique(choices.begin(), choices.end(), same_name), choices.end());
+    }
+    if (allow_list) {
+        for (const auto &choice : choices) {
+            if (choice.second < 0 || choice.second >= 64) {
+                std::stringstream error_msg;
+                error_msg << "The ID of choice '" << choice.first << "' must be in the range of [0, 64).";
+                internel::exit_or_throw(error_msg);
+            }
+        }
+    }
+
+    ValueRule &rule = mutable_rule();
+    rule.choices.clear();
+    rule.choice_lengths.clear();
+    rule.choice_ids.clear();
+    std::vector<std::string_view> names;
+    std::vector<int32_t> indexes;
+    for (size_t i = 0; i < choices.size(); i++) {
+        rule.choices.push_back(choices[i].first);
+        rule.choice_lengths.push_back(static_cast<uint32_t>(strlen(choices[i].first)));
+        rule.choice_ids.push_back(choices[i].second);
+        names.emplace_back(rule.choices[i], rule.choice_lengths[i]);
+        indexes.push_back(static_cast<int32_t>(i));
+    }
+    // 可选值较少时直接线性比较，不需要哈希表
+    if (rule.choices.size() > SMALL_CHOICE_COUNT) {
+        rule.choice_table.build(names, indexes);
+    }
+
+    rule.choice_description.clear();
+    rule.choice_description.push_back('[');
+    for (size_t i = 0; i < rule.choices.size(); i++) {
+        if (i != 0) {
+            rule.choice_description.append(", ");
+        }
+        rule.choice_description.append(rule.choices[i], rule.choice_lengths[i]);
+    }
+    rule.choice_description.push_back(']');
+    rule.has_choice_ids = has_ids;
+    rule.allow_choice_list = allow_list;
+    set_flag(IS_CHOICE);
+
+    // 先设置的默认值也需要校验，并记录其 ID
+    for (auto &value : default_values_) {
+        check_value(value);
+    }
+}
+
+Arg::ValueRule &Arg::mutable_rule()
+{
+    if (!rule_) {
+        rule_ = std::make_unique<ValueRule>();
+    }
+    return *rule_;
+}
+
+void Arg::set_command(Command *command) { command_ = command; }
+
+void Arg::set_position_id(int position_id) { position_id_ = position_id; }
+
+std::shared_ptr<Arg> Arg::new_help_arg() { return std::make_shared<Arg>(Private(), "help", 'h', ArgType::FLAG); }
+
+const char *Arg::get_long() const { return long_name_; }
+
+char Arg::get_short() const { return short_name_; }
+
+int Arg::get_position_id() const { return position_id_; }
+
+void Arg::set_argid(int opt_id) { arg_id_ = opt_id; }
+
+int Arg::get_argid() const { return arg_id_; }
+
+void Arg::set_index(size_t index) { index_ = static_cast<uint32_t>(index); }
+
+size_t Arg::get_index() const { return index_; }
+
+ArgType Arg::get_arg_type() const { return arg_type_; }
+
+const internel::ParsedValues &Arg::get_default_values() const { return default_values_; }
+
+const std::string &Arg::get_choice_description() const { return rule_->choice_description; }
+
+int32_t Arg::find_choice(std::string_view value) const
+{
+    const ValueRule &rule = *rule_;
+    if (rule.choices.size() <= SMALL_CHOICE_COUNT) {
+        // 先比较预先计算好的长度，长度相同时才比较内容
+        for (size_t i = 0; i < rule.choices.size(); i++) {
+            if (rule.choice_lengths[i] == value.size() && memcmp(rule.choices[i], value.data(), value.size()) == 0) {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    }
+    return rule.choice_table.find(value);
+}
+
+std::string Arg::get_boundary_description() const
+{
+    const ValueRule &rule = *rule_;
+    std::string description;
+    description.reserve(100);
+    if (rule.include_left) {
+        description.push_back('[');
+    } else {
+        description.push_back('(');
+    }
+    description.append(rule.left_text).append(", ").append(rule.right_text);
+    if (rule.include_right) {
+        description.push_back(']');
+    } else {
+        description.push_back(')');
+    }
+    return description;
+}
+
+bool Arg::is_conflict_with_all() const { return has_flag(CONFLICT_WITH_ALL); }
+
+void Arg::check_not_compiled() const
+{
+    if (command_ != nullptr) {
+        command_->check_not_compiled();
+    }
+}
+
+void Arg::check_value(internel::ParsedValue &value) const
+{
+    ParseErrorCode code = validate_value(value);
+    if (code != ParseErrorCode::OK) {
+        std::stringstream error_msg;
+        error_msg << describe_value_error(code, value.str());
+        internel::exit_or_throw(error_msg);
+    }
+}
+
+ParseErrorCode Arg::validate_value(internel::ParsedValue &value) const
+{
+    ParseErrorCode code = validate_range(value);
+    if (code != ParseErrorCode::OK) {
+        return code;
+    }
+    return validate_choice(value);
+}
+
+ParseErrorCode Arg::validate_range(const internel::ParsedValue &value) const
+{
+    if (!has_flag(IS_RANGE)) {
+        return ParseErrorCode::OK;
+    }
+    // 边界在设置时已经转换好，值在解析时已经转换好，这里只有两次比较
+    const ValueRule &rule = *rule_;
+    bool check_ret = false;
+    if (rule.num_type == NumType::INT) {
+        if (!value.is_int()) {
+            return ParseErrorCode::INVALID_NUMBER;
+        }
+        check_ret = check_range(value.as_int(), rule.left.int_value, rule.right.int_value);
+    } else if (rule.num_type == NumType::UINT) {
+        if (!value.is_uint()) {
+            return ParseErrorCode::INVALID_NUMBER;
+        }
+        check_ret = check_range(value.as_uint(), rule.left.uint_value, rule.right.uint_value);
+    } else {
+        if (!value.is_double()) {
+            return ParseErrorCode::INVALID_NUMBER;
+        }
+        check_ret = check_range(value.as_double(), rule.left.double_value, rule.right.double_value);
+    }
+    return check_ret ? ParseErrorCode::OK : ParseErrorCode::OUT_OF_RANGE;
+}
+
+ParseErrorCode Arg::validate_choice(internel::ParsedValue &value) const
+{
+    if (!has_flag(IS_CHOICE)) {
+        return ParseErrorCode::OK;
+    }
+    const ValueRule &rule = *rule_;
+    std::string_view str(value.str());
+    if (rule.allow_choice_list) {
+        // 逗号分隔的多个可选值，每一个都必须合法，结果为所有可选值的位掩码
+        uint64_t mask = 0;
+        size_t begin = 0;
+        while (true) {
+            size_t end = str.find(',', begin);
+            int32_t index = find_choice(str.substr(begin, end == std::string_view::npos ? end : end - begin));
+            if (index < 0) {
+                return ParseErrorCode::INVALID_CHOICE;
+            }
+            mask |= uint64_t(1) << rule.choice_ids[index];
+            if (end == std::string_view::npos) {
+                break;
+            }
+            begin = end + 1;
+        }
+        value.set_choice_mask(mask);
+    } else {
+        int32_t index = find_choice(str);
+        if (index < 0) {
+            return ParseErrorCode::INVALID_CHOICE;
+        }
+        if (rule.has_choice_ids) {
+            value.set_choice_id(rule.choice_ids[index]);
+        }
+    }
+    return ParseErrorCode::OK;
+}
+
+std::string Arg::describe_value_error(ParseErrorCode code, std::string_view value) const
+{
+    std::stringstream error_msg;
+    if (code == ParseErrorCode::INVALID_NUMBER) {
+        // 与 `internel::to_value` 的错误信息保持一致
+        auto describe = [&](auto number) {
+            using T = decltype(number);
+            if (internel::try_to_number(value, number) == internel::ConvertResult::OUT_OF_RANGE) {
+                error_msg << "The value '" << value << "' is out of the range of " << internel::type_name<T>() << ".";
+            } else {
+                error_msg << "The value '" << value << "' is not a valid " << internel::type_name<T>() << ".";
+            }
+        };
+        if (rule_->num_type == NumType::INT) {
+            describe(int64_t(0));
+        } else if (rule_->num_type == NumType::UINT) {
+            describe(uint64_t(0));
+        } else {
+            describe(double(0));
+        }
+    } else if (code == ParseErrorCode::OUT_OF_RANGE) {
+        if (get_position_id() != -1) {
+            error_msg << "The value of position argument (position index " << get_position_id()
+                      << ") is not within the range of " << get_boundary_description() << ".";
+        } else if (get_long()) {
+            error_msg << "The value of option --" << get_long() << " is not in the range of "
+                      << get_boundary_description() << ".";
+        } else {
+            error_msg << "The value of option -" << get_short() << " is not in the range of "
+                      << get_boundary_description() << ".";
+        }
+    } else if (code == ParseErrorCode::INVALID_CHOICE) {
+        if (get_position_id() != -1) {
+            error_msg << "The value of position argument (position index " << get_position_id() << ") is not within "
+                      << get_choice_description() << ".";
+        } else if (get_long()) {
+            error_msg << "The value of option --" << get_long() << " is not within " << get_choice_description() << ".";
+        } else {
+            error_msg << "The value of option -" << get_short() << " is not within " << get_choice_description() << ".";
+        }
+    }
+    return error_msg.str();
+}
+
+bool ParseResult::has_arg(const char *long_name) const
+{
+    const Arg *arg = command_ ? command_->find_arg(long_name) : nullptr;
+    return arg != nullptr && is_hit(*arg);
+}
+
+bool ParseResult::has_arg(char short_name) const
+{
+    const Arg *arg = command_ ? command_->find_arg(short_name) : nullptr;
+    return arg != nullptr && is_hit(*arg);
+}
+
+ParseResult::ParseResult(std::pmr::memory_resource *resource)
+    : arg_states_(resource),
+      hit_bits_(resource),
+      hit_indexes_(resource),
+      position_values_(resource),
+      subcommand_result_(resource)
+{
+}
+
+const ParseResult &ParseResult::get_subcommand() const
+{
+    if (!has_subcommand_) {
+        std::stringstream error_msg;
+        error_msg << "No subcommand has been parsed.";
+        internel::exit_or_throw(error_msg);
+    }
+    return subcommand_result_.front();
+}
+
+std::string ParseResult::command_name() const { return std::string(command_name_sv()); }
+
+std::string_view ParseResult::command_name_sv() const
+{
+    return command_ ? command_->command_name_sv() : std::string_view();
+}
+
+const internel::ParsedValues &ParseResult::get_values(const Arg &arg) const
+{
+    const ArgState &state = arg_states_.at(arg.get_index());
+    if (state.generation != generation_ || state.values.empty()) {
+        return arg.get_default_values();
+    }
+    return state.values;
+}
+
+const internel::ParsedValues &ParseResult::get_values(const char *long_name) const
+{
+    const Arg *arg = command_ ? command_->find_arg(long_name) : nullptr;
+    if (arg == nullptr) {
+        std::stringstream error_msg;
+        error_msg << "Can not find --" << long_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return get_values(*arg);
+}
+
+const internel::ParsedValues &ParseResult::get_values(char short_name) const
+{
+    const Arg *arg = command_ ? command_->find_arg(short_name) : nullptr;
+    if (arg == nullptr) {
+        std::stringstream error_msg;
+        error_msg << "Can not find -" << short_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return get_values(*arg);
+}
+
+const Arg *ParseResult::find_arg(const ArgKey &key) const { return command_ ? command_->find_arg(key) : nullptr; }
+
+const Arg &ParseResult::get_key_arg(const ArgKey &key) const
+{
+    const Arg *arg = find_arg(key);
+    if (arg == nullptr) {
+        std::stringstream error_msg;
+        error_msg << "Can not find --" << key.view() << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return *arg;
+}
+
+const Arg &ParseResult::get_handle_arg(const Arg *arg) const
+{
+    if (arg == nullptr) {
+        std::stringstream error_msg;
+        error_msg << "Invalid argument handle.";
+        internel::exit_or_throw(error_msg);
+    }
+    if (command_ == nullptr || arg->command_ != command_) {
+        std::stringstream error_msg;
+        error_msg << "The argument handle does not belong to the parsed command";
+        if (command_ != nullptr) {
+            error_msg << " " << command_->command_name_sv();
+        }
+        error_msg << ".";
+        internel::exit_or_throw(error_msg);
+    }
+    return *arg;
+}
+
+const internel::ParsedValue &ParseResult::get_first_value(const Arg &arg) const
+{
+    const internel::ParsedValues &values = get_values(arg);
+    if (values.empty()) {
+        std::stringstream error_msg;
+        if (arg.get_long() != nullptr) {
+            error_msg << "Option --" << arg.get_long() << " does not have a value.";
+        } else if (arg.get_short() != ' ') {
+            error_msg << "Option -" << arg.get_short() << " does not have a value.";
+        } else {
+            error_msg << "Position argument " << arg.get_position_id() << " does not have a value.";
+        }
+        internel::exit_or_throw(error_msg);
+    }
+    return values[0];
+}
+
+int64_t ParseResult::get_choice_id(const Arg &arg) const
+{
+    const internel::ParsedValues &values = get_values(arg);
+    if (values.empty() || !values[0].has_choice_id()) {
+        std::stringstream error_msg;
+        if (values.empty()) {
+            error_msg << "The option does not have a value.";
+        } else {
+            error_msg << "The value '" << values[0].str() << "' does not have a choice ID.";
+        }
+        internel::exit_or_throw(error_msg);
+    }
+    return values[0].choice_id();
+}
+
+uint64_t ParseResult::get_choice_mask(const Arg &arg) const
+{
+    uint64_t mask = 0;
+    for (const auto &value : get_values(arg)) {
+        if (!value.has_choice_mask()) {
+            std::stringstream error_msg;
+            error_msg << "The value '" << value.str() << "' does not have a choice ID.";
+            internel::exit_or_throw(error_msg);
+        }
+        mask |= value.choice_mask();
+    }
+    return mask;
+}
+
+int64_t ParseResult::get_choice_id(const char *long_name) const
+{
+    const Arg *arg = command_ ? command_->find_arg(long_name) : nullptr;
+    if (arg == nullptr) {
+        std::stringstream error_msg;
+        error_msg << "Can not find --" << long_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return get_choice_id(*arg);
+}
+
+int64_t ParseResult::get_choice_id(char short_name) const
+{
+    const Arg *arg = command_ ? command_->find_arg(short_name) : nullptr;
+    if (arg == nullptr) {
+        std::stringstream error_msg;
+        error_msg << "Can not find -" << short_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return get_choice_id(*arg);
+}
+
+uint64_t ParseResult::get_choice_mask(const char *long_name) const
+{
+    const Arg *arg = command_ ? command_->find_arg(long_name) : nullptr;
+    if (arg == nullptr) {
+        std::stringstream error_msg;
+        error_msg << "Can not find --" << long_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return get_choice_mask(*arg);
+}
+
+uint64_t ParseResult::get_choice_mask(char short_name) const
+{
+    const Arg *arg = command_ ? command_->find_arg(short_name) : nullptr;
+    if (arg == nullptr) {
+        std::stringstream error_msg;
+        error_msg << "Can not find -" << short_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return get_choice_mask(*arg);
+}
+
+bool ParseResult::is_hit(const Arg &arg) const { return hit_bits_.test(arg.get_index()); }
+
+void ParseResult::set_hit(const Arg &arg)
+{
+    if (!hit_bits_.test(arg.get_index())) {
+        hit_bits_.set(arg.get_index());
+        hit_indexes_.push_back(static_cast<uint32_t>(arg.get_index()));
+    }
+}
+
+void ParseResult::reset(const Command &command)
+{
+    if (command_ != &command || arg_states_.size() != command.args_.size()) {
+        command_ = &command;
+        arg_states_.clear();
+        arg_states_.reserve(command.args_.size());
+        for (size_t i = 0; i < command.args_.size(); i++) {
+            arg_states_.emplace_back(resource());
+        }
+        hit_bits_.reset(command.args_.size());
+        generation_ = 0;
+    } else {
+        for (uint32_t index : hit_indexes_) {
+            hit_bits_.clear(index);
+        }
+    }
+    hit_indexes_.clear();
+    generation_++;
+    position_values_.clear();
+    has_subcommand_ = false;
+}
+
+ParseErrorCode ParseResult::add_value(const Arg &arg, const char *value)
+{
+    ArgState &state = arg_states_.at(arg.get_index());
+    if (state.generation != generation_) {
+        // 之前某次解析遗留的值，清空后复用其内存
+        state.values.clear();
+        state.generation = generation_;
+    }
+    if (arg.get_arg_type() == ArgType::FLAG) {
+        // 标志参数被传递多次时也只有一个值
+        state.values.assign(1, internel::ParsedValue(value));
+    } else {
+        // 存储用户传递的参数值并进行预设规则校验，用户传递的值会覆盖默认值
+        // 值在这里只转换一次，校验取值范围和之后的取值都使用转换好的数值
+        internel::ParsedValue parsed_value(value);
+        ParseErrorCode code = arg.validate_value(parsed_value);
+        if (code != ParseErrorCode::OK) {
+            return code;
+        }
+        state.values.push_back(parsed_value);
+    }
+    return ParseErrorCode::OK;
+}
+
+std::shared_ptr<Command> Command::new_command(const char *name)
+{
+    auto command = std::make_shared<Command>(Private());
+    command->command_name_ = name;
+    command->add_help_arg(Arg::new_help_arg());
+    return command;
+}
+
+Command::Command(Private) {}
+
+Command::~Command() = default;
+
+CommandRef SchemaArena::new_command(const char *name)
+{
+    Command *command = commands_.create(Command::Private());
+    command->command_name_ = name;
+    command->add_help_arg(internel::borrow(*args_.create(Arg::Private(), "help", 'h', ArgType::FLAG)));
+    return CommandRef(command);
+}
+
+ArgRef SchemaArena::new_arg(ArgType type) { return ArgRef(args_.create(Arg::Private(), type)); }
+
+BatchParser::BatchParser(const Command &command, size_t thread_count) : command_(command)
+{
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    pool_ = std::make_unique<internel::WorkStealingPool>(thread_count);
+}
+
+BatchParser::~BatchParser() = default;
+
+size_t BatchParser::parse(const std::vector<const char *> *argvs, size_t count)
+{
+    // 只在主线程中调整大小，解析时每个线程只访问自己取到的块对应的解析结果
+    if (results_.size() < count) {
+        results_.resize(count);
+    }
+    errors_.resize(count);
+    size_ = count;
+    pool_->run(count, [this, argvs](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            errors_[i] = command_.try_parse(argvs[i], results_[i]);
+        }
+    });
+    return static_cast<size_t>(
+        std::count_if(errors_.begin(), errors_.begin() + count, [](const ParseError &error) { return error.ok(); }));
+}
+
+size_t BatchParser::parse(const std::vector<std::vector<const char *>> &argvs)
+{
+    return parse(argvs.data(), argvs.size());
+}
+
+size_t BatchParser::thread_count() const { return pool_->thread_count(); }
+
+PersistentParseCache::PersistentParseCache(const char *path, uint32_t slot_count)
+{
+    // 不跟随符号链接，并且只使用属于当前用户、其它用户不可写的普通文件，避免其它用户预先放置或替换缓存文件
+    struct stat file_stat {};
+    int fd = internel::open_private_file(path, file_stat);
+    if (fd < 0) {
+        return;
+    }
+    // 创建文件、检查文件头以及生成密钥时加锁，避免多个进程同时初始化同一个文件
+    internel::CacheHeader header{};
+    bool ok = flock(fd, LOCK_EX) == 0;
+    if (ok && file_stat.st_size == 0) {
+        header = {internel::CACHE_MAGIC, internel::CACHE_VERSION, slot_count, internel::CACHE_SLOT_SIZE};
+        ok = slot_count > 0 &&
+             ftruncate(fd, static_cast<off_t>(internel::CACHE_HEADER_SIZE + slot_count * internel::CACHE_SLOT_SIZE)) ==
+                 0 &&
+             pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    } else if (ok) {
+        ok = pread(fd, &header, sizeof(header), 0) == sizeof(header) && header.magic == internel::CACHE_MAGIC &&
+             header.version == internel::CACHE_VERSION && header.slot_size == internel::CACHE_SLOT_SIZE &&
+             header.slot_count > 0 &&
+             static_cast<uint64_t>(file_stat.st_size) ==
+                 internel::CACHE_HEADER_SIZE + uint64_t(header.slot_count) * internel::CACHE_SLOT_SIZE;
+    }
+    // 密钥保存在缓存文件之外，只有能读取密钥文件的进程才能写入可命中的槽位
+    ok = ok && internel::load_cache_key(std::string(path) + ".key", mac_key_);
+    flock(fd, LOCK_UN);
+    size_t size = internel::CACHE_HEADER_SIZE + size_t(header.slot_count) * internel::CACHE_SLOT_SIZE;
+    void *addr = ok ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return;
+    }
+    mapped_ = addr;
+    mapped_size_ = size;
+    slots_ = static_cast<uint8_t *>(addr) + internel::CACHE_HEADER_SIZE;
+    slot_count_ = header.slot_count;
+}
+
+PersistentParseCache::~PersistentParseCache()
+{
+    if (mapped_ != nullptr) {
+        munmap(mapped_, mapped_size_);
+    }
+}
+
+ParseResult PersistentParseCache::parse(const Command &command, int argc, const char *const *argv)
+{
+    ParseResult result;
+    parse(command, argc, argv, result);
+    return result;
+}
+
+ParseResult PersistentParseCache::parse(const Command &command, const std::vector<const char *> &args)
+{
+    return parse(command, static_cast<int>(args.size()), args.data());
+}
+
+void PersistentParseCache::parse(const Command &command, int argc, const char *const *argv, ParseResult &result)
+{
+    command.ensure_compiled();
+    if (!is_open()) {
+        command.do_parse_args(argc, argv, result);
+        return;
+    }
+
+    // 依次复制命令描述的指纹和参数列表，用于计算键以及与槽位中的参数列表比较
+    // 参数列表本身就放不进一个槽位时不使用缓存
+    constexpr size_t body_capacity = internel::CACHE_SLOT_SIZE - sizeof(internel::CacheSlot);
+    uint64_t fingerprint = command.schema_fingerprint_;
+    alignas(8) uint8_t text[sizeof(fingerprint) + body_capacity];
+    memcpy(text, &fingerprint, sizeof(fingerprint));
+    size_t argv_size = 0;
+    for (int i = 0; i < argc; i++) {
+        size_t length = strlen(argv[i]) + 1;
+        if (length > body_capacity - argv_size) {
+            command.do_parse_args(argc, argv, result);
+            return;
+        }
+        memcpy(text + sizeof(fingerprint) + argv_size, argv[i], length);
+        argv_size += length;
+    }
+    uint64_t key = internel::siphash24(mac_key_, text, sizeof(fingerprint) + argv_size);
+    uint8_t *slot_data = slot(key);
+
+    // 其它进程可能正在写入这个槽位，先复制到本地，复制前后槽位头相同并且认证码校验通过后再使用复制的数据
+    internel::CacheSlot header{};
+    memcpy(&header, slot_data, sizeof(header));
+    if (header.key == key && header.fingerprint == fingerprint && header.argc == static_cast<uint32_t>(argc) &&
+        header.argv_size == argv_size && uint64_t(header.argv_size) + header.result_size <= body_capacity) {
+        alignas(8) uint8_t copy[internel::CACHE_SLOT_SIZE];
+        size_t mac_size = sizeof(header) + header.result_size;
+        memcpy(copy, slot_data, mac_size + argv_size);
+        const char *data = reinterpret_cast<const char *>(copy + sizeof(header));
+        if (memcmp(copy, &header, sizeof(header)) == 0 &&
+            memcmp(copy + mac_size, text + sizeof(fingerprint), argv_size) == 0 &&
+            internel::cache_mac(mac_key_, copy, mac_size) == header.mac &&
+            load(command, argc, argv, data, header.result_size, result)) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+
+    // 出错时退出或抛出异常，不写入缓存
+    command.do_parse_args(argc, argv, result);
+
+    std::string data(sizeof(header), '\0');
+    if (!encode(result, argc, argv, 0, data) || data.size() + argv_size > internel::CACHE_SLOT_SIZE) {
+        return;
+    }
+    header.key = key;
+    header.fingerprint = fingerprint;
+    header.argc = static_cast<uint32_t>(argc);
+    header.argv_size = static_cast<uint32_t>(argv_size);
+    header.result_size = static_cast<uint32_t>(data.size() - sizeof(header));
+    header.reserved = 0;
+    memcpy(&data[0], &header, sizeof(header));
+    header.mac = internel::cache_mac(mac_key_, reinterpret_cast<const uint8_t *>(data.data()), data.size());
+    // 先写入内容再写入槽位头，读取时认证码不匹配的按未命中处理
+    memcpy(slot_data + sizeof(header), data.data() + sizeof(header), data.size() - sizeof(header));
+    memcpy(slot_data + data.size(), text + sizeof(fingerprint), argv_size);
+    memcpy(slot_data, &header, sizeof(header));
+}
+
+ParseCacheStats PersistentParseCache::stats() const
+{
+    ParseCacheStats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.capacity = slot_count_;
+    for (uint32_t i = 0; i < slot_count_; i++) {
+        internel::CacheSlot header{};
+        memcpy(&header, slots_ + size_t(i) * internel::CACHE_SLOT_SIZE, sizeof(header));
+        stats.size += header.mac != 0 ? 1 : 0;
+    }
+    return stats;
+}
+
+uint8_t *PersistentParseCache::slot(uint64_t key) const
+{
+    return slots_ + (key % slot_count_) * internel::CACHE_SLOT_SIZE;
+}
+
+bool PersistentParseCache::encode(const ParseResult &result, int argc, const char *const *argv, int begin,
+                                  std::string &out)
+{
+    // 根据指针找到它在 `argv` 中的下标和偏移。值大多按 `argv` 的顺序出现，因此从上一次找到的位置开始找
+    int hint = 0;
+    auto locate = [argc, argv, &hint](const char *str, uint32_t &argv_index, uint32_t &offset) {
+        argv_index = internel::CACHE_FLAG_VALUE;
+        offset = 0;
+        if (str == internel::FLAG_VALUE) {
+            return true;
+        }
+        for (int n = 0; n < argc; n++) {
+            int i = (hint + n) % argc;
+            if (str >= argv[i] && str <= argv[i] + strlen(argv[i])) {
+                hint = i;
+                argv_index = static_cast<uint32_t>(i);
+                offset = static_cast<uint32_t>(str - argv[i]);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // 与 `Command::try_parse_args` 相同，子命令是当前命令之后第一个与子命令名字相同的参数
+    const Command &command = *result.command_;
+    uint32_t name_index = internel::CACHE_NO_SUBCOMMAND;
+    if (result.has_subcommand_) {
+        int idx = begin;
+        while (idx < argc && command.subcommandname_2_subcommand_.count(argv[idx]) == 0) {
+            idx++;
+        }
+        if (idx == argc) {
+            return false;
+        }
+        name_index = static_cast<uint32_t>(idx);
+    }
+    internel::append_pod(out, static_cast<uint32_t>(result.arg_states_.size()));
+    internel::append_pod(out, name_index);
+
+    // 位置参数没有命中标记，因此按解析代数找出本次解析中有值的参数，与命中的参数一起记录
+    auto is_recorded = [&result](size_t index) {
+        return result.arg_states_[index].generation == result.generation_ || result.hit_bits_.test(index);
+    };
+    uint32_t state_count = 0;
+    for (size_t i = 0; i < result.arg_states_.size(); i++) {
+        state_count += is_recorded(i) ? 1 : 0;
+    }
+    internel::append_pod(out, state_count);
+    for (size_t i = 0; i < result.arg_states_.size(); i++) {
+        if (!is_recorded(i)) {
+            continue;
+        }
+        // 超出槽位大小时不会写入缓存，不需要再继续编码
+        if (out.size() > internel::CACHE_SLOT_SIZE) {
+            return false;
+        }
+        const ParseResult::ArgState &state = result.arg_states_[i];
+        bool has_values = state.generation == result.generation_;
+        internel::append_pod(out, static_cast<uint32_t>(i) | (result.hit_bits_.test(i) ? internel::CACHE_HIT_BIT : 0));
+        internel::append_pod(out, static_cast<uint32_t>(has_values ? state.values.size() : 0));
+        for (size_t j = 0; has_values && j < state.values.size(); j++) {
+            const internel::ParsedValue &value = state.values[j];
+            uint32_t argv_index = 0;
+            uint32_t offset = 0;
+            if (!locate(value.str_, argv_index, offset)) {
+                return false;
+            }
+            internel::append_pod(out, argv_index);
+            if (argv_index == internel::CACHE_FLAG_VALUE) {
+                continue;
+            }
+            internel::append_pod(out, offset);
+            internel::append_pod(out, static_cast<uint32_t>(value.kinds_));
+            if (value.kinds_ & (internel::ParsedValue::INT | internel::ParsedValue::UINT)) {
+                internel::append_pod(out, value.bits_);
+            }
+            if (value.kinds_ & internel::ParsedValue::DOUBLE) {
+                internel::append_pod(out, value.double_);
+            }
+            if (value.kinds_ & (internel::ParsedValue::CHOICE_ID | internel::ParsedValue::CHOICE_MASK)) {
+                internel::append_pod(out, value.choice_);
+            }
+        }
+    }
+    internel::append_pod(out, static_cast<uint32_t>(result.position_values_.size()));
+    for (const char *value : result.position_values_) {
+        uint32_t argv_index = 0;
+        uint32_t offset = 0;
+        if (!locate(value, argv_index, offset) || argv_index == internel::CACHE_FLAG_VALUE) {
+            return false;
+        }
+        internel::append_pod(out, argv_index);
+        internel::append_pod(out, offset);
+    }
+
+    if (result.has_subcommand_) {
+        return encode(result.subcommand_result_.front(), argc, argv, static_cast<int>(name_index), out);
+    }
+    return true;
+}
+
+bool PersistentParseCache::decode(const Command &command, int argc, const char *const *argv, int begin,
+                                  const char *&data, const char *end, ParseResult &result)
+{
+    result.reset(command);
+    uint32_t arg_count = 0;
+    uint32_t name_index = 0;
+    if (!internel::read_pod(data, end, arg_count) || arg_count != command.args_.size() ||
+        !internel::read_pod(data, end, name_index)) {
+        return false;
+    }
+    // 编码由认证码保证是本程序写入的，这里只检查下标不越界：值只能指向当前命令的参数范围 `(begin, level_end)`
+    int level_end = argc;
+    if (name_index != internel::CACHE_NO_SUBCOMMAND) {
+        if (name_index <= static_cast<uint32_t>(begin) || name_index >= static_cast<uint32_t>(argc)) {
+            return false;
+        }
+        level_end = static_cast<int>(name_index);
+    }
+
+    // 由下标和偏移还原出指向 `argv` 的指针
+    auto relocate = [argv, begin, level_end](uint32_t argv_index, uint32_t offset, const char *&str) {
+        if (argv_index <= static_cast<uint32_t>(begin) || argv_index >= static_cast<uint32_t>(level_end) ||
+            offset > strlen(argv[argv_index])) {
+            return false;
+        }
+        str = argv[argv_index] + offset;
+        return true;
+    };
+
+    // 值直接使用缓存中转换好的数值，不再重新转换和校验
+    static const internel::ParsedValue flag_value(internel::FLAG_VALUE);
+    uint32_t state_count = 0;
+    if (!internel::read_pod(data, end, state_count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < state_count; i++) {
+        uint32_t index = 0;
+        uint32_t value_count = 0;
+        if (!internel::read_pod(data, end, index) || (index & ~internel::CACHE_HIT_BIT) >= arg_count ||
+            !internel::read_pod(data, end, value_count)) {
+            return false;
+        }
+        if (index & internel::CACHE_HIT_BIT) {
+            index &= ~internel::CACHE_HIT_BIT;
+            result.set_hit(*command.args_[index]);
+        }
+        ParseResult::ArgState &state = result.arg_states_[index];
+        state.values.clear();
+        state.generation = result.generation_;
+        for (uint32_t j = 0; j < value_count; j++) {
+            uint32_t argv_index = 0;
+            uint32_t offset = 0;
+            uint32_t kinds = 0;
+            if (!internel::read_pod(data, end, argv_index)) {
+                return false;
+            }
+            if (argv_index == internel::CACHE_FLAG_VALUE) {
+                state.values.push_back(flag_value);
+                continue;
+            }
+            internel::ParsedValue value;
+            if (!internel::read_pod(data, end, offset) || !relocate(argv_index, offset, value.str_) ||
+                !internel::read_pod(data, end, kinds)) {
+                return false;
+            }
+            value.kinds_ = static_cast<uint8_t>(kinds);
+            if (((kinds & (internel::ParsedValue::INT | internel::ParsedValue::UINT)) &&
+                 !internel::read_pod(data, end, value.bits_)) ||
+                ((kinds & internel::ParsedValue::DOUBLE) && !internel::read_pod(data, end, value.double_)) ||
+                ((kinds & (internel::ParsedValue::CHOICE_ID | internel::ParsedValue::CHOICE_MASK)) &&
+                 !internel::read_pod(data, end, value.choice_))) {
+                return false;
+            }
+            state.values.push_back(value);
+        }
+    }
+
+    uint32_t position_count = 0;
+    if (!internel::read_pod(data, end, position_count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < position_count; i++) {
+        uint32_t argv_index = 0;
+        uint32_t offset = 0;
+        const char *value = nullptr;
+        if (!internel::read_pod(data, end, argv_index) || !internel::read_pod(data, end, offset) ||
+            !relocate(argv_index, offset, value)) {
+            return false;
+        }
+        result.position_values_.push_back(value);
+    }
+
+    if (name_index == internel::CACHE_NO_SUBCOMMAND) {
+        return true;
+    }
+    auto iter = command.subcommandname_2_subcommand_.find(argv[name_index]);
+    if (iter == command.subcommandname_2_subcommand_.end()) {
+        return false;
+    }
+    if (result.subcommand_result_.empty()) {
+        result.subcommand_result_.emplace_back(result.resource());
+    }
+    result.has_subcommand_ = true;
+    return decode(*iter->second, argc, argv, static_cast<int>(name_index), data, end,
+                  result.subcommand_result_.front());
+}
+
+bool PersistentParseCache::load(const Command &command, int argc, const char *const *argv, const char *data,
+                                size_t size, ParseResult &result)
+{
+    const char *end = data + size;
+    // 编码需要恰好用完，否则按未命中处理
+    return decode(command, argc, argv, 0, data, end, result) && data == end;
+}
+
+std::shared_ptr<Command> Command::usage(const char *usage)
+{
+    set_usage(usage);
+    return shared_from_this();
+}
+
+std::shared_ptr<Command> Command::usage(const char *usage[], size_t size)
+{
+    set_usage(usage, size);
+    return shared_from_this();
+}
+
+std::shared_ptr<Command> Command::arg(std::shared_ptr<Arg> arg)
+{
+    add_arg_internel(std::move(arg));
+    return shared_from_this();
+}
+
+std::shared_ptr<Command> Command::subcommand(std::shared_ptr<Command> subcommand)
+{
+    add_subcommand_internel(std::move(subcommand));
+    return shared_from_this();
+}
+
+std::shared_ptr<Command> Command::related_group(std::vector<const char *> &&related_group)
+{
+    add_group_internel(related_groups_, std::move(related_group));
+    return shared_from_this();
+}
+
+std::shared_ptr<Command> Command::conflict_group(std::vector<const char *> &&conflict_group)
+{
+    add_group_internel(conflict_groups_, std::move(conflict_group));
+    return shared_from_this();
+}
+
+std::shared_ptr<Command> Command::one_required_group(std::vector<const char *> &&one_required_group)
+{
+    add_group_internel(one_required_groups_, std::move(one_required_group));
+    return shared_from_this();
+}
+
+void Command::set_usage(const char *usage) { usage_format1_ = usage; }
+
+void Command::set_usage(const char *usage[], size_t size)
+{
+    usage_format2_ = usage;
+    line_size_ = size;
+}
+
+void Command::add_arg_internel(std::shared_ptr<Arg> arg)
+{
+    check_not_compiled();
+    if (arg->get_arg_type() != ArgType::POSITION && arg->get_long() == nullptr && arg->get_short() == ' ') {
+        std::stringstream error_msg;
+        error_msg << "The argument should have a long name or a short name.";
+        internel::exit_or_throw(error_msg);
+    }
+    if (arg->command_ != nullptr) {
+        std::stringstream error_msg;
+        error_msg << command_name_ << ": The argument has already been added to a command.";
+        internel::exit_or_throw(error_msg);
+    }
+    if (arg->get_long() && longname_2_arg_.count(arg->get_long()) == 1) {
+        std::stringstream error_msg;
+        error_msg << command_name_ << ": Duplicate option --" << arg->get_long() << ".";
+        internel::exit_or_throw(error_msg);
+    }
+    if (arg->get_short() != ' ' && shortname_2_arg_.count(arg->get_short()) == 1) {
+        std::stringstream error_msg;
+        error_msg << command_name_ << ": Duplicate option -" << arg->get_short() << ".";
+        internel::exit_or_throw(error_msg);
+    }
+
+    int argid = current_argid_--;
+    arg->set_argid(argid);
+    arg->set_index(args_.size());
+    arg->set_command(this);
+
+    if (arg->get_long()) {
+        longname_2_arg_[arg->get_long()] = arg.get();
+    }
+
+    if (arg->get_short() != ' ') {
+        shortname_2_arg_[arg->get_short()] = arg.get();
+    }
+
+    if (arg->is_conflict_with_all()) {
+        conflict_with_all_args_.push_back(arg.get());
+    }
+
+    // 如果是标志参数，其默认值被设为 0，也就是 `false`。若用户在参数解析过程中传递了该参数，就会将其设为
+    // 1，即 `true`。
+    if (arg->get_arg_type() == ArgType::FLAG) {
+        arg->default_values_.assign(1, internel::ParsedValue("0"));
+    }
+
+    // 如果是位置参数，则给位置参数分配标识位置的 ID（从 0 开始，依次递增），并记录位置参数
+    if (arg->get_arg_type() == ArgType::POSITION) {
+        arg->set_position_id(current_position_id_++);
+        position_args_.push_back(arg.get());
+    }
+
+    args_.push_back(std::move(arg));
+}
+
+void Command::add_subcommand_internel(std::shared_ptr<Command> subcommand)
+{
+    check_not_compiled();
+    const char *name = subcommand->command_name_;
+    subcommandname_2_subcommand_[name] = std::move(subcommand);
+}
+
+void Command::add_group_internel(std::vector<ArgGroup> &groups, std::vector<const char *> &&names)
+{
+    check_not_compiled();
+    groups.push_back(make_group(std::move(names)));
+}
+
+Command::ArgGroup Command::make_group(std::vector<const char *> &&names) const
+{
+    // 名字只有一个字符时为短名字，否则为长名字
+    ArgGroup group;
+    for (const char *name : names) {
+        const Arg *arg = nullptr;
+        if (strlen(name) == 1) {
+            auto iter = shortname_2_arg_.find(name[0]);
+            arg = iter == shortname_2_arg_.end() ? nullptr : iter->second;
+        } else {
+            auto iter = longname_2_arg_.find(name);
+            arg = iter == longname_2_arg_.end() ? nullptr : iter->second;
+        }
+        if (arg == nullptr) {
+            std::stringstream error_msg;
+            error_msg << command_name_ << ": Can not find " << (strlen(name) == 1 ? "-" : "--") << name
+                      << " option.";
+            internel::exit_or_throw(error_msg);
+        }
+        group.indexes.push_back(static_cast<uint32_t>(arg->get_index()));
+    }
+    group.names = std::move(names);
+    return group;
+}
+
+const std::shared_ptr<Command> Command::get_subcommand()
+{
+    return subcommandname_2_subcommand_.at(current_subcommand_name_);
+}
+
+std::string Command::serialize_schema() const
+{
+    ensure_compiled();
+    // 按层序给所有命令编号，根命令为 0
+    std::vector<const Command *> commands{this};
+    std::map<const Command *, uint32_t> command_indexes{{this, 0}};
+    for (size_t i = 0; i < commands.size(); i++) {
+        for (const auto &it : commands[i]->subcommandname_2_subcommand_) {
+            command_indexes[it.second.get()] = static_cast<uint32_t>(commands.size());
+            commands.push_back(it.second.get());
+        }
+    }
+
+    std::vector<internel::BlobCommand> blob_commands;
+    std::vector<internel::BlobArg> blob_args;
+    std::vector<uint32_t> words;
+    std::string strings;
+    auto add_string = [&strings](std::string_view str) {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.append(str);
+        strings.push_back('\0');
+        return offset;
+    };
+
+    for (const Command *command : commands) {
+        internel::BlobCommand record{};
+        record.name = add_string(command->command_name_);
+        record.usage = internel::BLOB_NONE;
+        if (command->usage_format1_ != nullptr) {
+            record.usage = add_string(command->usage_format1_);
+        } else if (command->usage_format2_ != nullptr) {
+            std::string usage;
+            for (size_t i = 0; i < command->line_size_; i++) {
+                usage.append(i == 0 ? "" : "\n").append(command->usage_format2_[i]);
+            }
+            record.usage = add_string(usage);
+        }
+
+        // 自动添加的 `--help` 不写入描述，解析时直接按文本识别
+        std::vector<uint32_t> new_indexes(command->args_.size(), internel::BLOB_NONE);
+        record.arg_begin = static_cast<uint32_t>(blob_args.size());
+        for (const auto &arg : command->args_) {
+            if (arg.get() == command->help_arg_) {
+                continue;
+            }
+            if (arg->has_flag(Arg::IS_RANGE) || arg->has_flag(Arg::IS_CHOICE)) {
+                std::stringstream error_msg;
+                error_msg << command->command_name_ << ": Option with a range or choices can not be serialized.";
+                internel::exit_or_throw(error_msg);
+            }
+            new_indexes[arg->get_index()] = static_cast<uint32_t>(blob_args.size()) - record.arg_begin;
+            internel::BlobArg blob_arg{};
+            blob_arg.long_name = arg->get_long() ? add_string(arg->get_long()) : internel::BLOB_NONE;
+            blob_arg.long_length = arg->get_long() ? static_cast<uint32_t>(strlen(arg->get_long())) : 0;
+            blob_arg.short_name = static_cast<unsigned char>(arg->get_short());
+            blob_arg.type = static_cast<uint32_t>(arg->get_arg_type());
+            blob_arg.defaults = static_cast<uint32_t>(words.size());
+            blob_arg.default_count = static_cast<uint32_t>(arg->default_values_.size());
+            for (const internel::ParsedValue &value : arg->default_values_) {
+                words.push_back(add_string(value.str()));
+            }
+            blob_args.push_back(blob_arg);
+        }
+        record.arg_count = static_cast<uint32_t>(blob_args.size()) - record.arg_begin;
+        record.position_count = static_cast<uint32_t>(command->position_args_.size());
+
+        // 长名字哈希表，槽位数不小于参数个数的两倍，保证总有空槽位
+        record.long_slot_count = 2;
+        while (record.long_slot_count < record.arg_count * 2) {
+            record.long_slot_count <<= 1;
+        }
+        record.long_slots = static_cast<uint32_t>(words.size());
+        words.resize(words.size() + record.long_slot_count, internel::BLOB_NONE);
+        for (uint32_t i = 0; i < record.arg_count; i++) {
+            const internel::BlobArg &blob_arg = blob_args[record.arg_begin + i];
+            if (blob_arg.long_name == internel::BLOB_NONE) {
+                continue;
+            }
+            uint64_t hash = internel::hash_name(std::string_view(strings.data() + blob_arg.long_name));
+            uint32_t slot = static_cast<uint32_t>(hash) & (record.long_slot_count - 1);
+            while (words[record.long_slots + slot] != internel::BLOB_NONE) {
+                slot = (slot + 1) & (record.long_slot_count - 1);
+            }
+            words[record.long_slots + slot] = i;
+        }
+
+        record.shorts = static_cast<uint32_t>(words.size());
+        for (const auto &it : command->shortname_2_arg_) {
+            if (new_indexes[it.second->get_index()] != internel::BLOB_NONE) {
+                words.push_back(static_cast<unsigned char>(it.first));
+                words.push_back(new_indexes[it.second->get_index()]);
+                record.short_count++;
+            }
+        }
+
+        record.subcommands = static_cast<uint32_t>(words.size());
+        for (const auto &it : command->subcommandname_2_subcommand_) {
+            words.push_back(add_string(it.first));
+            words.push_back(command_indexes.at(it.second.get()));
+            record.subcommand_count++;
+        }
+
+        record.mask_words = (record.arg_count + 31) / 32;
+        auto add_mask = [&words, &record, &new_indexes](const std::vector<const Arg *> &args) {
+            uint32_t offset = static_cast<uint32_t>(words.size());
+            words.resize(words.size() + record.mask_words, 0);
+            for (const Arg *arg : args) {
+                uint32_t index = new_indexes[arg->get_index()];
+                if (index != internel::BLOB_NONE) {
+                    words[offset + index / 32] |= uint32_t(1) << (index % 32);
+                }
+            }
+            return offset;
+        };
+        record.required_mask = add_mask(command->required_args_);
+        record.conflict_with_all_mask = add_mask(command->conflict_with_all_args_);
+
+        record.groups = static_cast<uint32_t>(words.size());
+        auto add_groups = [&](const std::vector<ArgGroup> &groups, internel::BlobGroupKind kind) {
+            for (const ArgGroup &group : groups) {
+                words.push_back(kind);
+                words.push_back(static_cast<uint32_t>(group.names.size()));
+                for (const char *name : group.names) {
+                    words.push_back(add_string(name));
+                }
+                std::vector<const Arg *> args;
+                for (uint32_t index : group.indexes) {
+                    args.push_back(command->args_[index].get());
+                }
+                add_mask(args);
+                record.group_count++;
+            }
+        };
+        add_groups(command->related_groups_, internel::BLOB_RELATED_GROUP);
+        add_groups(command->conflict_groups_, internel::BLOB_CONFLICT_GROUP);
+        add_groups(command->one_required_groups_, internel::BLOB_ONE_REQUIRED_GROUP);
+
+        blob_commands.push_back(record);
+    }
+
+    internel::BlobHeader header{};
+    header.magic = internel::BLOB_MAGIC;
+    header.version = internel::BLOB_VERSION;
+    header.command_count = static_cast<uint32_t>(blob_commands.size());
+    header.arg_count = static_cast<uint32_t>(blob_args.size());
+    header.word_count = static_cast<uint32_t>(words.size());
+    header.string_size = static_cast<uint32_t>(strings.size());
+    header.size = static_cast<uint32_t>(sizeof(header) + blob_commands.size() * sizeof(internel::BlobCommand) +
+                                        blob_args.size() * sizeof(internel::BlobArg) + words.size() * sizeof(uint32_t) +
+                                        strings.size());
+
+    std::string blob;
+    blob.reserve(header.size);
+    blob.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    blob.append(reinterpret_cast<const char *>(blob_commands.data()),
+                blob_commands.size() * sizeof(internel::BlobCommand));
+    blob.append(reinterpret_cast<const char *>(blob_args.data()), blob_args.size() * sizeof(internel::BlobArg));
+    blob.append(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(uint32_t));
+    blob.append(strings);
+    return blob;
+}
+
+std::shared_ptr<Command> Command::compile()
+{
+    ensure_compiled();
+    return shared_from_this();
+}
+
+bool Command::is_compiled() const { return is_compiled_; }
+
+void Command::ensure_compiled() const
+{
+    // `std::call_once` 保证并发的第一次解析只编译一次，并且其它线程能看到编译的结果
+    std::call_once(compile_flag_, [this]() { const_cast<Command *>(this)->do_compile(); });
+}
+
+void Command::do_compile()
+{
+    std::vector<std::string_view> long_names;
+    std::vector<int32_t> long_indexes;
+    shortname_table_.fill(-1);
+    for (const auto &arg : args_) {
+        if (arg->get_long()) {
+            long_names.emplace_back(arg->get_long());
+            long_indexes.push_back(static_cast<int32_t>(arg->get_index()));
+        }
+        if (arg->get_short() != ' ') {
+            shortname_table_[static_cast<unsigned char>(arg->get_short())] = static_cast<int32_t>(arg->get_index());
+        }
+        if (arg->get_arg_type() == ArgType::REQUIRED) {
+            required_args_.push_back(arg.get());
+        }
+    }
+    std::vector<uint32_t> required_indexes, conflict_with_all_indexes;
+    for (const Arg *arg : required_args_) {
+        required_indexes.push_back(static_cast<uint32_t>(arg->get_index()));
+    }
+    for (const auto &arg : conflict_with_all_args_) {
+        conflict_with_all_indexes.push_back(static_cast<uint32_t>(arg->get_index()));
+    }
+    required_mask_.build(required_indexes);
+    conflict_with_all_mask_.build(conflict_with_all_indexes);
+    for (auto *groups : {&related_groups_, &conflict_groups_, &one_required_groups_}) {
+        for (auto &group : *groups) {
+            group.mask.build(group.indexes);
+        }
+    }
+    // 添加参数时已经检查过重复的名字，这里不会失败
+    longname_table_.build(long_names, long_indexes);
+    longname_trie_.build(long_names, long_indexes);
+
+    for (auto &iter : subcommandname_2_subcommand_) {
+        iter.second->ensure_compiled();
+    }
+    schema_fingerprint_ = compute_schema_fingerprint();
+    is_compiled_ = true;
+}
+
+uint64_t Command::schema_fingerprint() const
+{
+    ensure_compiled();
+    return schema_fingerprint_;
+}
+
+uint64_t Command::compute_schema_fingerprint() const
+{
+    // 依次混入所有影响解析结果的描述，字符串连同长度一起混入，避免不同的描述拼接后得到相同的输入
+    uint64_t hash = internel::hash_name(command_name_);
+    auto mix = [&hash](uint64_t value) {
+        hash = internel::hash_name(std::string_view(reinterpret_cast<const char *>(&value), sizeof(value)), hash);
+    };
+    auto mix_text = [&hash, &mix](std::string_view text) {
+        mix(text.size());
+        hash = internel::hash_name(text, hash);
+    };
+
+    mix(args_.size());
+    for (const auto &arg : args_) {
+        mix_text(arg->get_long() ? arg->get_long() : "");
+        mix(static_cast<unsigned char>(arg->get_short()));
+        mix(static_cast<uint64_t>(arg->get_arg_type()));
+        mix(arg->flags_);
+        mix(arg->default_values_.size());
+        for (const internel::ParsedValue &value : arg->default_values_) {
+            mix_text(value.str());
+        }
+        if (arg->rule_ != nullptr) {
+            const Arg::ValueRule &rule = *arg->rule_;
+            mix_text(rule.left_text);
+            mix_text(rule.right_text);
+            mix(rule.include_left);
+            mix(rule.include_right);
+            mix(static_cast<uint64_t>(rule.num_type));
+            mix(rule.choices.size());
+            for (size_t i = 0; i < rule.choices.size(); i++) {
+                mix_text(rule.choices[i]);
+                mix(rule.has_choice_ids ? static_cast<uint64_t>(rule.choice_ids[i]) : 0);
+            }
+            mix(rule.has_choice_ids);
+            mix(rule.allow_choice_list);
+        }
+    }
+    for (const auto *groups : {&related_groups_, &conflict_groups_, &one_required_groups_}) {
+        mix(groups->size());
+        for (const auto &group : *groups) {
+            mix(group.names.size());
+            for (const char *name : group.names) {
+                mix_text(name);
+            }
+        }
+    }
+    mix(subcommandname_2_subcommand_.size());
+    for (const auto &iter : subcommandname_2_subcommand_) {
+        mix_text(iter.first);
+        mix(iter.second->schema_fingerprint_);
+    }
+    return hash;
+}
+
+void Command::check_not_compiled() const
+{
+    if (is_compiled_) {
+        std::stringstream error_msg;
+        error_msg << command_name_ << ": The command has been compiled and can not be modified.";
+        internel::exit_or_throw(error_msg);
+    }
+}
+
+std::string Command::command_name() const { return command_name_; }
+
+std::string_view Command::command_name_sv() const { return command_name_; }
+
+ParseResult Command::parse(int argc, const char *const *argv) const
+{
+    ensure_compiled();
+    ParseResult result;
+    do_parse_args(argc, argv, result);
+    return result;
+}
+
+ParseResult Command::parse(const std::vector<const char *> &args) const
+{
+    return parse(static_cast<int>(args.size()), args.data());
+}
+
+ParseResult Command::parse(int argc, const char *const *argv, std::pmr::memory_resource *resource) const
+{
+    ensure_compiled();
+    ParseResult result(resource);
+    do_parse_args(argc, argv, result);
+    return result;
+}
+
+ParseResult Command::parse(const std::vector<const char *> &args, std::pmr::memory_resource *resource) const
+{
+    return parse(static_cast<int>(args.size()), args.data(), resource);
+}
+
+void Command::parse(int argc, const char *const *argv, ParseResult &result) const
+{
+    ensure_compiled();
+    do_parse_args(argc, argv, result);
+}
+
+void Command::parse(const std::vector<const char *> &args, ParseResult &result) const
+{
+    parse(static_cast<int>(args.size()), args.data(), result);
+}
+
+ParseError Command::try_parse(int argc, const char *const *argv, ParseResult &result) const noexcept
+{
+    ensure_compiled();
+    ParseError error;
+    internel::ErrorSink errors(error);
+    try_parse_args(argc, argv, result, errors);
+    return error;
+}
+
+ParseError Command::try_parse(const std::vector<const char *> &args, ParseResult &result) const noexcept
+{
+    return try_parse(static_cast<int>(args.size()), args.data(), result);
+}
+
+bool Command::try_parse_all(int argc, const char *const *argv, ParseResult &result,
+                            ParseErrorList &errors) const noexcept
+{
+    ensure_compiled();
+    errors.clear();
+    internel::ErrorSink sink(errors);
+    try_parse_args(argc, argv, result, sink);
+    return errors.empty();
+}
+
+bool Command::try_parse_all(const std::vector<const char *> &args, ParseResult &result,
+                            ParseErrorList &errors) const noexcept
+{
+    return try_parse_all(static_cast<int>(args.size()), args.data(), result, errors);
+}
+
+void Command::enable_parse_cache(size_t capacity)
+{
+    parse_cache_ = capacity > 0 ? std::make_unique<internel::ParseCache>(capacity) : nullptr;
+}
+
+std::shared_ptr<const ParseResult> Command::cached_parse(int argc, const char *const *argv) const
+{
+    ensure_compiled();
+    if (parse_cache_ == nullptr) {
+        auto result = std::make_shared<ParseResult>();
+        do_parse_args(argc, argv, *result);
+        return result;
+    }
+
+    uint64_t hash = internel::ParseCache::hash_argv(argc, argv);
+    std::shared_ptr<const ParseResult> result = parse_cache_->find(hash, argc, argv);
+    if (result != nullptr) {
+        return result;
+    }
+    // 未命中时在复制的参数列表上解析，解析结果中的值指向副本，因此与调用者的 `argv` 无关
+    // 出错时退出或抛出异常，不会加入缓存
+    auto entry = std::make_shared<internel::ParseCache::Entry>(hash, argc, argv);
+    do_parse_args(argc, entry->argv.data(), entry->result);
+    parse_cache_->insert(entry);
+    return std::shared_ptr<const ParseResult>(entry, &entry->result);
+}
+
+std::shared_ptr<const ParseResult> Command::cached_parse(const std::vector<const char *> &args) const
+{
+    return cached_parse(static_cast<int>(args.size()), args.data());
+}
+
+ParseCacheStats Command::parse_cache_stats() const
+{
+    return parse_cache_ != nullptr ? parse_cache_->stats() : ParseCacheStats();
+}
+
+ParseErrorList::ParseErrorList(size_t capacity) : capacity_(capacity) { errors_.reserve(capacity); }
+
+void ParseErrorList::clear()
+{
+    errors_.clear();
+    truncated_ = false;
+}
+
+std::string ParseErrorList::message() const
+{
+    std::string message;
+    for (const ParseError &error : errors_) {
+        if (error.code == ParseErrorCode::HELP) {
+            continue;
+        }
+        message.append(message.empty() ? "" : "\n").append(error.message());
+    }
+    return message;
+}
+
+bool internel::ErrorSink::report(ParseError error)
+{
+    if (error.argv_index >= 0) {
+        error.argv_index += argv_offset;
+    }
+    if (first_ != nullptr) {
+        *first_ = error;
+        stopped_ = true;
+        return false;
+    }
+    // 错误列表满了之后，再遇到错误时停止解析
+    if (list_->errors_.size() == list_->capacity_) {
+        list_->truncated_ = true;
+        stopped_ = true;
+        return false;
+    }
+    list_->errors_.push_back(error);
+    stopped_ = error.code == ParseErrorCode::HELP;
+    return !stopped_;
+}
+
+bool ParseError::is_arg(const Arg &arg) const { return arg_id == arg.get_argid(); }
+
+std::string ParseError::message() const { return command ? command->format_error(*this) : std::string(); }
+
+void Command::parse_args(int argc, char **argv)
+{
+    // 复用上一次的解析结果，反复调用时不会重新分配内存
+    current_result_ = nullptr;
+    parse(argc, argv, last_result_);
+
+    // 让每一层命令都能通过 `get_one_value` 等函数获取属于自己的那部分解析结果
+    Command *command = this;
+    const ParseResult *result = &last_result_;
+    while (true) {
+        command->current_result_ = result;
+        if (!result->has_subcommand_) {
+            break;
+        }
+        result = &result->subcommand_result_.front();
+        command->current_subcommand_name_ = result->command_->command_name_;
+        command = command->subcommandname_2_subcommand_.at(command->current_subcommand_name_).get();
+    }
+}
+
+void Command::parse_args(std::vector<const char *> &&args)
+{
+    parse_args(static_cast<int>(args.size()), const_cast<char **>(args.data()));
+}
+
+bool Command::has_arg(const char *long_name)
+{
+    return current_result_ != nullptr && current_result_->has_arg(long_name);
+}
+
+bool Command::has_arg(char short_name) { return current_result_ != nullptr && current_result_->has_arg(short_name); }
+
+int64_t Command::get_choice_id(const char *long_name) { return get_current_result().get_choice_id(long_name); }
+
+int64_t Command::get_choice_id(char short_name) { return get_current_result().get_choice_id(short_name); }
+
+uint64_t Command::get_choice_mask(const char *long_name) { return get_current_result().get_choice_mask(long_name); }
+
+uint64_t Command::get_choice_mask(char short_name) { return get_current_result().get_choice_mask(short_name); }
+
+const ParseResult &Command::get_current_result() const
+{
+    if (current_result_ == nullptr) {
+        std::stringstream error_msg;
+        error_msg << command_name_ << ": The arguments have not been parsed.";
+        internel::exit_or_throw(error_msg);
+    }
+    return *current_result_;
+}
+
+const Arg *Command::find_arg(std::string_view long_name) const
+{
+    int32_t index = longname_table_.find(long_name);
+    return index < 0 ? nullptr : args_[index].get();
+}
+
+const Arg *Command::find_arg(const char *long_name) const { return find_arg(std::string_view(long_name)); }
+
+const Arg *Command::find_arg(char short_name) const
+{
+    int32_t index = shortname_table_[static_cast<unsigned char>(short_name)];
+    return index < 0 ? nullptr : args_[index].get();
+}
+
+const Arg *Command::find_arg(const ArgKey &key) const
+{
+    uint64_t seed = longname_table_.seed();
+    uint64_t hash = seed == 0 ? key.hash() : internel::hash_name(key.view(), seed);
+    int32_t index = longname_table_.find(key.view(), hash);
+    return index < 0 ? nullptr : args_[index].get();
+}
+
+const Arg *Command::get_registered_arg(const char *long_name) const
+{
+    auto it = longname_2_arg_.find(long_name);
+    if (it == longname_2_arg_.end()) {
+        std::stringstream error_msg;
+        error_msg << command_name_ << ": Can not find --" << long_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return it->second;
+}
+
+const Arg *Command::get_registered_arg(char short_name) const
+{
+    auto it = shortname_2_arg_.find(short_name);
+    if (it == shortname_2_arg_.end()) {
+        std::stringstream error_msg;
+        error_msg << command_name_ << ": Can not find -" << short_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return it->second;
+}
+
+void Command::do_parse_args(int argc, const char *const *argv, ParseResult &result) const
+{
+    ParseError error;
+    internel::ErrorSink errors(error);
+    if (!try_parse_args(argc, argv, result, errors)) {
+        raise_error(error);
+    }
+}
+
+bool Command::try_parse_args(int argc, const char *const *argv, ParseResult &result,
+                             internel::ErrorSink &errors) const
+{
+    result.reset(*this);
+
+    if (subcommandname_2_subcommand_.empty()) {
+        return try_parse_args_internel(argc, argv, result, errors) && check_arg_groups(result, errors);
+    }
+
+    // 从 `argv` 中查找子命令对应的索引
+    int idx = 0;
+    for (; idx < argc; idx++) {
+        if (subcommandname_2_subcommand_.count(argv[idx]) == 1) {
+            break;
+        }
+    }
+
+    // 首先，解析当前层级的参数（即父命令的参数）
+    if (!(try_parse_args_internel(idx, argv, result, errors) && check_arg_groups(result, errors))) {
+        return false;
+    }
+
+    // 然后判断是否找到了子命令
+    // 这涉及到出错时信息显示顺序的问题。采用这种方式，会先显示父命令的错误信息，然后再显示子命令的错误信息。
+    if (idx == argc) {
+        return report_error(errors, ParseErrorCode::MISSING_SUBCOMMAND);
+    }
+
+    // 进而，解析下一层级的参数（即子命令的参数）
+    if (result.subcommand_result_.empty()) {
+        result.subcommand_result_.emplace_back(result.resource());
+    }
+    result.has_subcommand_ = true;
+    errors.argv_offset += idx;
+    bool ok = subcommandname_2_subcommand_.at(argv[idx])->try_parse_args(argc - idx, argv + idx,
+                                                                          result.subcommand_result_.front(), errors);
+    errors.argv_offset -= idx;
+    return ok;
+}
+
+bool Command::try_parse_args_internel(int argc, const char *const *argv, ParseResult &result,
+                                      internel::ErrorSink &errors) const
+{
+    internel::TokenizerContext ctx(argc, argv);
+    internel::Token token;
+    while (next_token(ctx, token, errors)) {
+        // 与 GNU `getopt` 的重排语义保持一致：位置参数可以出现在选项之间，按出现的先后顺序记录
+        if (token.kind == internel::Token::Kind::POSITION) {
+            result.position_values_.emplace_back(token.value);
+            continue;
+        }
+        // 出错的词法单元已经记录了错误，跳过
+        if (token.kind == internel::Token::Kind::INVALID) {
+            continue;
+        }
+        if (token.arg == help_arg_) {
+            return report_error(errors, ParseErrorCode::HELP);
+        }
+        result.set_hit(*token.arg);
+        ParseErrorCode code = result.add_value(*token.arg, token.value ? token.value : internel::FLAG_VALUE);
+        if (code != ParseErrorCode::OK && !report_error(errors, code, token.arg, token.value, ctx.index - 1)) {
+            return false;
+        }
+    }
+    if (errors.stopped()) {
+        return false;
+    }
+    return finish_parse_args(argc, argv, result, errors);
+}
+
+bool Command::finish_parse_args(int argc, const char *const *argv, ParseResult &result,
+                                internel::ErrorSink &errors) const
+{
+    // 验证所有必选参数是否都已被传递
+    if (!check_required_args(result, errors)) {
+        return false;
+    }
+
+    // 解析位置参数
+    if (result.position_values_.size() < position_args_.size() &&
+        !report_error(errors, ParseErrorCode::MISSING_POSITION_ARGUMENT)) {
+        return false;
+    }
+    // 检查在命令中显式设置的位置参数，而不检查其它未显式设置的位置参数（用户可能仅设置了 3
+    // 个位置参数，但是传递了大于 3 个的位置参数）
+    size_t position_count = std::min(position_args_.size(), result.position_values_.size());
+    for (size_t i = 0; i < position_count; i++) {
+        const char *value = result.position_values_[i];
+        ParseErrorCode code = result.add_value(*position_args_[i], value);
+        if (code != ParseErrorCode::OK) {
+            // 出错时才查找位置参数在 `argv` 中的下标
+            int32_t argv_index = static_cast<int32_t>(std::find(argv, argv + argc, value) - argv);
+            if (!report_error(errors, code, position_args_[i], value, argv_index < argc ? argv_index : -1)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool Command::next_token(internel::TokenizerContext &ctx, internel::Token &token, internel::ErrorSink &errors) const
+{
+    // 上一个词法单元是短参数簇（例如 `-abc`）中的一部分，继续处理簇中剩余的字符
+    if (ctx.short_cluster != nullptr) {
+        return next_short_token(ctx, token, errors);
+    }
+    if (ctx.index >= ctx.argc) {
+        return false;
+    }
+
+    const char *current = ctx.argv[ctx.index++];
+    std::string_view text(current);
+    token = internel::Token();
+
+    // 单独的 `-` 以及不以 `-` 开头的都是位置参数
+    if (ctx.only_positions || text.size() < 2 || text[0] != '-') {
+        token.value = current;
+        return true;
+    }
+    // `--` 表示选项结束，其后的全部是位置参数
+    if (text == "--") {
+        ctx.only_positions = true;
+        return next_token(ctx, token, errors);
+    }
+
+    bool is_double_dash = text[1] == '-';
+    size_t prefix_len = is_double_dash ? 2 : 1;
+    std::string_view body = text.substr(prefix_len);
+
+    // 与 `getopt_long_only` 保持一致：形如 `-x` 且 `x` 是已知的短参数时按短参数处理，否则优先按长参数匹配，
+    // 长参数匹配不到时再按短参数簇处理（例如 `-abc` 等价于 `-a -b -c`）
+    if (!is_double_dash && body.size() == 1 && find_arg(body[0]) != nullptr) {
+        ctx.short_cluster = current + 1;
+        return next_short_token(ctx, token, errors);
+    }
+
+    size_t equal_pos = body.find('=');
+    std::string_view name = body.substr(0, equal_pos);
+    const Arg *arg = find_long_arg(name);
+    if (arg == nullptr) {
+        if (!name.empty() && longname_trie_.find_prefix(name) == internel::RadixTrie::AMBIGUOUS) {
+            token.kind = internel::Token::Kind::INVALID;
+            return report_error(errors, ParseErrorCode::AMBIGUOUS_OPTION, nullptr, name, ctx.index - 1);
+        }
+        if (!is_double_dash && find_arg(body[0]) != nullptr) {
+            ctx.short_cluster = current + 1;
+            return next_short_token(ctx, token, errors);
+        }
+        token.kind = internel::Token::Kind::INVALID;
+        return report_error(errors, ParseErrorCode::UNRECOGNIZED_OPTION, nullptr, text, ctx.index - 1);
+    }
+
+    token.kind = internel::Token::Kind::OPTION;
+    token.name = name;
+    token.arg = arg;
+    if (arg->get_arg_type() == ArgType::FLAG) {
+        if (equal_pos != std::string_view::npos) {
+            token.kind = internel::Token::Kind::INVALID;
+            return report_error(errors, ParseErrorCode::UNEXPECTED_VALUE, arg, text, ctx.index - 1);
+        }
+    } else {
+        // 如果一个参数被传递，那么该参数的值也应该被传递。因此除了标志参数外的其它类型参数都需要一个值，
+        // 值可以通过 `--name=value` 或 `--name value` 两种方式传递
+        if (equal_pos != std::string_view::npos) {
+            token.value = current + prefix_len + equal_pos + 1;
+        } else if (ctx.index < ctx.argc) {
+            token.value = ctx.argv[ctx.index++];
+        } else {
+            token.kind = internel::Token::Kind::INVALID;
+            return report_error(errors, ParseErrorCode::MISSING_VALUE, arg, text, ctx.index - 1);
+        }
+    }
+    return true;
+}
+
+bool Command::next_short_token(internel::TokenizerContext &ctx, internel::Token &token,
+                               internel::ErrorSink &errors) const
+{
+    const char *current = ctx.short_cluster++;
+    if (*ctx.short_cluster == '\0') {
+        ctx.short_cluster = nullptr;
+    }
+
+    token = internel::Token();
+    const Arg *arg = find_arg(*current);
+    if (arg == nullptr) {
+        // 跳过这个字符，簇中剩余的字符继续按短参数处理
+        token.kind = internel::Token::Kind::INVALID;
+        return report_error(errors, ParseErrorCode::INVALID_OPTION, nullptr, std::string_view(current, 1),
+                            ctx.index - 1);
+    }
+
+    token.kind = internel::Token::Kind::OPTION;
+    token.name = std::string_view(current, 1);
+    token.is_short = true;
+    token.arg = arg;
+    if (token.arg->get_arg_type() != ArgType::FLAG) {
+        // 短参数的值可以紧跟在后边（`-r1`），也可以是下一个参数（`-r 1`）
+        if (ctx.short_cluster != nullptr) {
+            token.value = ctx.short_cluster;
+            ctx.short_cluster = nullptr;
+        } else if (ctx.index < ctx.argc) {
+            token.value = ctx.argv[ctx.index++];
+        } else {
+            token.kind = internel::Token::Kind::INVALID;
+            return report_error(errors, ParseErrorCode::MISSING_VALUE, arg, token.name, ctx.index - 1);
+        }
+    }
+    return true;
+}
+
+const Arg *Command::find_long_arg(std::string_view name) const
+{
+    if (name.empty()) {
+        return nullptr;
+    }
+    const Arg *arg = find_arg(name);
+    if (arg != nullptr) {
+        return arg;
+    }
+
+    // 精确匹配失败时尝试前缀缩写，前缀树的查找时间只与名字的长度有关，与参数的个数无关
+    // 有多个匹配时返回空，由调用者报错
+    int32_t index = longname_trie_.find_prefix(name);
+    if (index < 0) {
+        return nullptr;
+    }
+    return args_[index].get();
+}
+
+bool Command::check_required_args(const ParseResult &result, internel::ErrorSink &errors) const
+{
+    // 所有必选参数都被传递时直接返回，否则再找出缺少的参数用于报错
+    if (required_mask_.count_hits(result.hit_bits_) == required_mask_.size()) {
+        return true;
+    }
+    for (const Arg *arg : required_args_) {
+        if (!result.is_hit(*arg) && !report_error(errors, ParseErrorCode::MISSING_REQUIRED_OPTION, arg)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Command::check_conflict_with_all_args(const ParseResult &result, internel::ErrorSink &errors) const
+{
+    // 如果与所有参数冲突的参数被传递了，那么不能传递其它任何参数，即总共只能有一个参数被传递
+    if (conflict_with_all_mask_.count_hits(result.hit_bits_) == 0 || result.hit_indexes_.size() <= 1) {
+        return true;
+    }
+    for (const auto &arg : conflict_with_all_args_) {
+        if (result.is_hit(*arg) && !report_error(errors, ParseErrorCode::CONFLICT_WITH_ALL, arg)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Command::check_related_groups(const ParseResult &result, internel::ErrorSink &errors) const
+{
+    for (size_t i = 0; i < related_groups_.size(); i++) {
+        // 相关组用于确保指定的参数必须同时存在或同时不存在，即 `count == 0` 或 `count == related_group.size()`。
+        // 否则，相关组的要求必定无法满足。这里的 `count` 是指相关组中实际传递的参数数量（is_hit() == true），
+        // `related_group.size()` 是相关组中参数的总数。意思是在解析命令行参数时，相关组里的参数要么一个都不传递，
+        // 要么全部传递，不然就不符合相关组的规则。
+        size_t count = related_groups_[i].mask.count_hits(result.hit_bits_);
+        if (count != 0 && count != related_groups_[i].mask.size() &&
+            !report_error(errors, ParseErrorCode::RELATED_GROUP, nullptr, {}, -1, static_cast<uint32_t>(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Command::check_conflict_groups(const ParseResult &result, internel::ErrorSink &errors) const
+{
+    for (size_t i = 0; i < conflict_groups_.size(); i++) {
+        // 冲突组确保其中最多只能有一个参数被传递，即 `count <= 1`。如果 `count > 1`，则必定不满足冲突组的要求。
+        size_t count = conflict_groups_[i].mask.count_hits(result.hit_bits_);
+        if (count > 1 &&
+            !report_error(errors, ParseErrorCode::CONFLICT_GROUP, nullptr, {}, -1, static_cast<uint32_t>(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Command::check_one_required_group(const ParseResult &result, internel::ErrorSink &errors) const
+{
+    for (size_t i = 0; i < one_required_groups_.size(); i++) {
+        // 至少选其一组确保该组中至少有一个参数存在，即 `count >= 1`。如果 `count < 1`，
+        // 则必定不满足至少选其一组的要求。
+        size_t count = one_required_groups_[i].mask.count_hits(result.hit_bits_);
+        if (count < 1 &&
+            !report_error(errors, ParseErrorCode::ONE_REQUIRED_GROUP, nullptr, {}, -1, static_cast<uint32_t>(i))) {
+            return false;
+        }
+    }
+    return true;
 }
 
-std::shared_ptr<Arg> Arg::default_values(std::vector<const char *> &&values)
+bool Command::check_arg_groups(const ParseResult &result, internel::ErrorSink &errors) const
 {
-    if (arg_type_ != ArgType::OPTIONAL) {
-        internel::error_msg << "Only optional argument can set default values.";
-        internel::exit_or_throw(internel::error_msg);
-    }
-    if (values.empty()) {
-        internel::error_msg << "The default values can not empty.";
-        internel::exit_or_throw(internel::error_msg);
-    }
-    values_ = values;
-    default_values_ = std::move(values);
-    has_default_value_ = true;
-    check_range();
-    check_choice();
-    return shared_from_this();
+    return check_conflict_with_all_args(result, errors) && check_related_groups(result, errors) &&
+           check_conflict_groups(result, errors) && check_one_required_group(result, errors);
 }
 
-std::shared_ptr<Arg> Arg::range(NumType type, const char *left, const char *right, bool include_left,
-                                bool include_right)
+bool Command::report_error(internel::ErrorSink &errors, ParseErrorCode code, const Arg *arg, std::string_view text,
+                           int32_t argv_index, uint32_t group_index) const
 {
-    if (arg_type_ == ArgType::FLAG) {
-        internel::error_msg << "The flag option can not set value range.";
-        internel::exit_or_throw(internel::error_msg);
-    }
-    if (is_choice_) {
-        internel::error_msg << "The selection value has been set for the option, and the range value can not be "
-                               "set again.";
-        internel::exit_or_throw(internel::error_msg);
-    }
-    left_ = left;
-    right_ = right;
-    include_left_ = include_left;
-    include_right_ = include_right;
-    num_type_ = type;
-    is_range_ = true;
-    return shared_from_this();
+    ParseError error;
+    error.code = code;
+    error.argv_index = argv_index;
+    error.arg_id = arg ? arg->get_argid() : INT32_MIN;
+    error.group_index = group_index;
+    error.text = text;
+    error.command = this;
+    return errors.report(error);
 }
 
-std::shared_ptr<Arg> Arg::choices(std::vector<const char *> &&choices)
+void Command::raise_error(const ParseError &error)
 {
-    if (arg_type_ == ArgType::FLAG) {
-        internel::error_msg << "The flag option can not set value choices.";
-        internel::exit_or_throw(internel::error_msg);
-    }
-    if (is_range_) {
-        internel::error_msg << "The range value has been set for the option, and the selection value can not be "
-                               "set again.";
-        internel::exit_or_throw(internel::error_msg);
-    }
-    if (choices.empty()) {
-        internel::error_msg << "The value choices vector can not empty.";
-        internel::exit_or_throw(internel::error_msg);
-    }
-    choices_ = std::set<const char *, internel::CStrCmp>(choices.begin(), choices.end());
-    if (choices_.empty()) {
-        internel::error_msg << "The value choices set can not empty.";
-        internel::exit_or_throw(internel::error_msg);
+    // 帮助信息由 `print_usage_help` 输出，并在其中退出或抛出异常
+    if (error.code == ParseErrorCode::HELP) {
+        error.command->print_usage_help();
+        return;
     }
-    is_choice_ = true;
-    return shared_from_this();
+    std::stringstream error_msg;
+    error_msg << error.message();
+    internel::exit_or_throw(error_msg);
 }
 
-void Arg::set_command(Command *command) { command_ = command; }
-
-void Arg::set_hit() { is_hit_ = true; }
-
-void Arg::set_position_id(int position_id) { position_id_ = position_id; }
-
-void Arg::set_value(const char *value)
+const Arg *Command::get_arg_by_id(int32_t arg_id) const
 {
-    if (arg_type_ == ArgType::FLAG) {
-        if (values_.empty()) {
-            values_.resize(1);
-        }
-        values_.at(0) = value;
-    } else {
-        // 如果用户传递了，则用传递的值覆盖默认值
-        if (has_default_value_ && !is_default_value_cleared_) {
-            values_.clear();
-            is_default_value_cleared_ = true;
-        }
-        // 存储用户传递的参数值并进行预设规则校验
-        values_.push_back(std::move(value));
-        check_range();
-        check_choice();
-    }
+    // 参数的 ID 从 -2 开始依次递减，与参数的下标一一对应
+    int64_t index = -2 - static_cast<int64_t>(arg_id);
+    return index >= 0 && index < static_cast<int64_t>(args_.size()) ? args_[index].get() : nullptr;
 }
 
-void Arg::reset_status_info()
+std::string Command::format_error(const ParseError &error) const
 {
-    is_hit_ = false;
-    if (has_default_value_) {
-        values_ = default_values_;
-        is_default_value_cleared_ = false;
+    const Arg *arg = get_arg_by_id(error.arg_id);
+    std::stringstream error_msg;
+    switch (error.code) {
+        case ParseErrorCode::OK:
+        case ParseErrorCode::HELP:
+            break;
+        case ParseErrorCode::UNRECOGNIZED_OPTION:
+            error_msg << command_name_ << ": Unrecognized option '" << error.text << "'.";
+            break;
+        case ParseErrorCode::AMBIGUOUS_OPTION: {
+            std::vector<int32_t> candidates;
+            longname_trie_.collect(error.text, candidates);
+            error_msg << command_name_ << ": Option '" << error.text << "' is ambiguous; possibilities:";
+            for (int32_t candidate : candidates) {
+                error_msg << " '--" << args_[candidate]->get_long() << "'";
+            }
+            break;
+        }
+        case ParseErrorCode::INVALID_OPTION:
+            error_msg << command_name_ << ": Invalid option -- '" << error.text << "'.";
+            break;
+        case ParseErrorCode::UNEXPECTED_VALUE:
+            error_msg << command_name_ << ": Option '--" << arg->get_long() << "' doesn't allow an argument.";
+            break;
+        case ParseErrorCode::MISSING_VALUE:
+            // 短参数时 `text` 只有一个字符，长参数时 `text` 是带前缀的整个词法单元
+            if (error.text.size() == 1) {
+                error_msg << command_name_ << ": Option requires an argument -- '" << error.text << "'.";
+            } else {
+                error_msg << command_name_ << ": Option '--" << arg->get_long() << "' requires an argument.";
+            }
+            break;
+        case ParseErrorCode::INVALID_NUMBER:
+        case ParseErrorCode::OUT_OF_RANGE:
+        case ParseErrorCode::INVALID_CHOICE:
+            error_msg << arg->describe_value_error(error.code, error.text);
+            break;
+        case ParseErrorCode::MISSING_REQUIRED_OPTION:
+            if (arg->get_long()) {
+                error_msg << command_name_ << ": Missing required option: --" << arg->get_long() << ".";
+            } else {
+                error_msg << command_name_ << ": Missing required option: -" << arg->get_short() << ".";
+            }
+            break;
+        case ParseErrorCode::MISSING_POSITION_ARGUMENT:
+            error_msg << command_name_ << ": Missing required position arguments.";
+            break;
+        case ParseErrorCode::CONFLICT_WITH_ALL:
+            if (arg->get_long()) {
+                error_msg << command_name_ << ": The conflict relationship is not satisfied. Option --"
+                          << arg->get_long() << " is conflict with all other options.";
+            } else {
+                error_msg << command_name_ << ": The conflict relationship is not satisfied. Option -"
+                          << arg->get_short() << " is conflict with all other options.";
+            }
+            break;
+        case ParseErrorCode::RELATED_GROUP:
+            error_msg << command_name_ << ": The related relationship is not satisfied. "
+                      << get_description(related_groups_[error.group_index].names) << ": is related with each other.";
+            break;
+        case ParseErrorCode::CONFLICT_GROUP:
+            error_msg << command_name_ << ": The conflict relationship is not satisfied. "
+                      << get_description(conflict_groups_[error.group_index].names)
+                      << ": is conflict with each other.";
+            break;
+        case ParseErrorCode::ONE_REQUIRED_GROUP:
+            error_msg << command_name_ << ": The one of require relationship is not satisfied. "
+                      << get_description(one_required_groups_[error.group_index].names)
+                      << ": at least one option should exist.";
+            break;
+        case ParseErrorCode::MISSING_SUBCOMMAND:
+            error_msg << command_name_ << ": Missing subcommand.";
+            break;
     }
+    return error_msg.str();
 }
 
-std::shared_ptr<Arg> Arg::new_help_arg() { return std::make_shared<Arg>(Private(), "help", 'h', ArgType::FLAG); }
-
-const char *Arg::get_long() { return long_name_; }
-
-char Arg::get_short() { return short_name_; }
-
-int Arg::get_position_id() { return position_id_; }
-
-void Arg::set_argid(int opt_id) { arg_id_ = opt_id; }
-
-int Arg::get_argid() { return arg_id_; }
-
-ArgType Arg::get_arg_type() { return arg_type_; }
-
-const std::vector<const char *> &Arg::get_values() { return values_; }
-
-std::string Arg::get_choice_description()
+std::string Command::get_description(const std::vector<const char *> &group) const
 {
     std::string description;
     description.reserve(100);
     description.push_back('[');
-    for (const auto &elem : choices_) {
-        description.append(elem).append(", ");
+    for (const auto &arg : group) {
+        description.append(strlen(arg) == 1 ? "-" : "--");
+        description.append(arg);
+        description.append(", ");
     }
     description.pop_back();
     description.pop_back();
@@ -243,537 +3113,518 @@ std::string Arg::get_choice_description()
     return description;
 }
 
-std::string Arg::get_boundary_description()
+void Command::add_help_arg(std::shared_ptr<Arg> arg)
 {
-    std::string description;
-    description.reserve(100);
-    if (include_left_) {
-        description.push_back('[');
-    } else {
-        description.push_back('(');
-    }
-    description.append(left_).append(", ").append(right_);
-    if (include_right_) {
-        description.push_back(']');
-    } else {
-        description.push_back(')');
-    }
-    return description;
-}
+    arg->set_conflicts_with_all();
+    arg->default_values_.assign(1, internel::ParsedValue("0"));
 
-bool Arg::is_hit() { return is_hit_; }
-
-bool Arg::is_conflict_with_all() { return is_conflict_with_all_; }
-
-void Arg::check_range()
-{
-    if (is_range_) {
-        bool check_ret = false;
-        if (num_type_ == NumType::INT) {
-            int64_t value = internel::to_value<int64_t>(values_.back());
-            int64_t left = internel::to_value<int64_t>(left_);
-            int64_t right = internel::to_value<int64_t>(right_);
-            check_ret = check_range(value, left, right);
-        } else if (num_type_ == NumType::UINT) {
-            uint64_t value = internel::to_value<uint64_t>(values_.back());
-            uint64_t left = internel::to_value<uint64_t>(left_);
-            uint64_t right = internel::to_value<uint64_t>(right_);
-            check_ret = check_range(value, left, right);
-        } else if (num_type_ == NumType::DOUBlE) {
-            double value = internel::to_value<double>(values_.back());
-            double left = internel::to_value<double>(left_);
-            double right = internel::to_value<double>(right_);
-            check_ret = check_range(value, left, right);
-        } else {
-            internel::error_msg << "Unknown range type.";
-            internel::exit_or_throw(internel::error_msg);
-        }
-
-        if (!check_ret) {
-            if (get_position_id() != -1) {
-                internel::error_msg << "The value of position argument (position index " << get_position_id()
-                                    << ") is not within the range of " << get_boundary_description() << ".";
-            } else if (get_long()) {
-                internel::error_msg << "The value of option --" << get_long() << " is not in the range of "
-                                    << get_boundary_description() << ".";
-            } else if (get_short() != ' ') {
-                internel::error_msg << "The value of option -" << get_short() << " is not in the range of "
-                                    << get_boundary_description() << ".";
-            } else {
-                internel::error_msg << "A argument must have at least a long name or a short name or a position id.";
-            }
-            internel::exit_or_throw(internel::error_msg);
-        }
-    }
+    int argid = current_argid_--;
+    arg->set_argid(argid);
+    arg->set_index(args_.size());
+    arg->set_command(this);
+
+    longname_2_arg_[arg->get_long()] = arg.get();
+    shortname_2_arg_[arg->get_short()] = arg.get();
+    help_arg_ = arg.get();
+    args_.push_back(std::move(arg));
 }
 
-void Arg::check_choice()
+void Command::print_usage_help() const
 {
-    if (is_choice_) {
-        if (choices_.find(values_.back()) == choices_.end()) {
-            if (get_position_id() != -1) {
-                internel::error_msg << "The value of position argument (position index " << get_position_id()
-                                    << ") is not within " << get_choice_description() << ".";
-                internel::exit_or_throw(internel::error_msg);
-            } else {
-                internel::error_msg << "The value of option --" << get_long() << " is not within "
-                                    << get_choice_description() << ".";
-                internel::exit_or_throw(internel::error_msg);
-            }
+    if (usage_format1_ != nullptr) {
+        std::cout << usage_format1_ << std::endl;
+    } else {
+        for (size_t i = 0; i < line_size_; i++) {
+            std::cout << usage_format2_[i] << std::endl;
         }
     }
+    std::stringstream error_msg;
+    internel::exit_or_throw(error_msg);
 }
 
-std::shared_ptr<Command> Command::new_command(const char *name)
+const BlobParseResult &BlobParseResult::get_subcommand() const
 {
-    auto command = std::make_shared<Command>(Private());
-    command->command_name_ = name;
-    return command;
+    if (!has_subcommand_) {
+        std::stringstream error_msg;
+        error_msg << "No subcommand has been parsed.";
+        internel::exit_or_throw(error_msg);
+    }
+    return *subcommand_result_;
 }
 
-std::shared_ptr<Command> Command::usage(const char *usage)
+std::string_view BlobParseResult::command_name_sv() const
 {
-    usage_format1_ = usage;
-    return shared_from_this();
+    return command_ ? std::string_view(blob_->strings_ + command_->name) : std::string_view();
 }
 
-std::shared_ptr<Command> Command::usage(const char *usage[], size_t size)
+void BlobParseResult::reset(const SchemaBlob &blob, const internel::BlobCommand &command)
 {
-    usage_format2_ = usage;
-    line_size_ = size;
-    return shared_from_this();
+    blob_ = &blob;
+    command_ = &command;
+    hit_words_.assign(command.mask_words, 0);
+    hit_count_ = 0;
+    first_value_.assign(command.arg_count, -1);
+    last_value_.assign(command.arg_count, -1);
+    values_.clear();
+    next_value_.clear();
+    positions_.clear();
+    has_subcommand_ = false;
 }
 
-std::shared_ptr<Command> Command::arg(std::shared_ptr<Arg> arg)
+void BlobParseResult::add_value(size_t index, const char *value)
 {
-    if (arg->get_arg_type() != ArgType::POSITION && arg->get_long() == nullptr && arg->get_short() == ' ') {
-        internel::error_msg << "The argument should have a long name or a short name.";
-        internel::exit_or_throw(internel::error_msg);
-    }
-
-    int argid = current_argid_--;
-    arg->set_argid(argid);
-    arg->set_command(this);
-
-    if (arg->get_long()) {
-        longname_2_arg_[arg->get_long()] = arg;
-        update_c_long_args(arg);
+    if (!is_hit(static_cast<int32_t>(index))) {
+        hit_words_[index >> 5] |= uint32_t(1) << (index & 31);
+        hit_count_++;
     }
-
-    if (arg->get_short()) {
-        shortname_2_arg_[arg->get_short()] = arg;
-        update_c_short_args(arg);
-    }
-
-    argid_2_arg_[argid] = arg;
-
-    if (arg->is_conflict_with_all()) {
-        conflict_with_all_args_.push_back(arg);
-    }
-
-    // 如果是标志参数，其初始值被设为 0，也就是 `false`。若用户在参数解析过程中传递了该参数，就会将其设为
-    // 1，即 `true`。
-    if (arg->get_arg_type() == ArgType::FLAG) {
-        arg->set_value("0");
-    }
-
-    // 如果是位置参数，则给位置参数分配标识位置的 ID（从 0 开始，依次递增），并记录位置参数
-    if (arg->get_arg_type() == ArgType::POSITION) {
-        arg->set_position_id(current_position_id_++);
-        position_args_.push_back(arg);
+    int32_t current = static_cast<int32_t>(values_.size());
+    values_.push_back(value);
+    next_value_.push_back(-1);
+    if (last_value_[index] < 0) {
+        first_value_[index] = current;
+    } else {
+        next_value_[last_value_[index]] = current;
     }
-
-    return shared_from_this();
+    last_value_[index] = current;
 }
 
-std::shared_ptr<Command> Command::subcommand(std::shared_ptr<Command> subcommand)
+int32_t BlobParseResult::find_arg(std::string_view long_name) const
 {
-    subcommandname_2_subcommand_[subcommand->command_name_] = subcommand;
-    return shared_from_this();
+    return command_ ? blob_->find_long(*command_, long_name, internel::hash_name(long_name)) : -1;
 }
 
-std::shared_ptr<Command> Command::related_group(std::vector<const char *> &&related_group)
+int32_t BlobParseResult::find_arg(char short_name) const
 {
-    related_groups_.push_back(std::move(related_group));
-    return shared_from_this();
+    return command_ ? blob_->find_short(*command_, short_name) : -1;
 }
 
-std::shared_ptr<Command> Command::conflict_group(std::vector<const char *> &&conflict_group)
+int32_t BlobParseResult::find_arg(const ArgKey &key) const
 {
-    conflict_groups_.push_back(std::move(conflict_group));
-    return shared_from_this();
+    return command_ ? blob_->find_long(*command_, key.view(), key.hash()) : -1;
 }
 
-std::shared_ptr<Command> Command::one_required_group(std::vector<const char *> &&one_required_group)
+size_t BlobParseResult::get_arg(int32_t index, const char *long_name) const
 {
-    one_required_groups_.push_back(std::move(one_required_group));
-    return shared_from_this();
+    if (index < 0) {
+        std::stringstream error_msg;
+        error_msg << "Can not find --" << long_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return static_cast<size_t>(index);
 }
 
-const std::shared_ptr<Command> Command::get_subcommand()
+size_t BlobParseResult::get_arg(int32_t index, char short_name) const
 {
-    return subcommandname_2_subcommand_.at(current_subcommand_name_);
+    if (index < 0) {
+        std::stringstream error_msg;
+        error_msg << "Can not find -" << short_name << " option.";
+        internel::exit_or_throw(error_msg);
+    }
+    return static_cast<size_t>(index);
 }
 
-std::string Command::command_name() { return command_name_; }
-
-std::string_view Command::command_name_sv() { return command_name_; }
-
-void Command::parse_args(int argc, char **argv)
+const char *BlobParseResult::get_first_value(size_t index) const
 {
-    reset_arg_status();
-    do_parse_args(argc, argv);
+    if (first_value_[index] >= 0) {
+        return values_[first_value_[index]];
+    }
+    const internel::BlobArg &arg = blob_->arg_at(*command_, index);
+    if (arg.default_count == 0) {
+        std::stringstream error_msg;
+        error_msg << "Option ";
+        blob_->describe_arg(error_msg, arg);
+        error_msg << " does not have a value.";
+        internel::exit_or_throw(error_msg);
+    }
+    return blob_->strings_ + blob_->words_[arg.defaults];
 }
 
-void Command::parse_args(std::vector<const char *> &&args)
+std::vector<const char *> BlobParseResult::get_values(size_t index) const
 {
-    reset_arg_status();
-    int argc = static_cast<int>(args.size());
-    char *argv[argc];
-    for (int i = 0; i < argc; i++) {
-        argv[i] = const_cast<char *>(args[i]);
+    std::vector<const char *> values;
+    if (first_value_[index] < 0) {
+        const internel::BlobArg &arg = blob_->arg_at(*command_, index);
+        for (uint32_t i = 0; i < arg.default_count; i++) {
+            values.push_back(blob_->strings_ + blob_->words_[arg.defaults + i]);
+        }
+        return values;
     }
-    do_parse_args(argc, argv);
+    for (int32_t i = first_value_[index]; i >= 0; i = next_value_[i]) {
+        values.push_back(values_[i]);
+    }
+    return values;
 }
 
-bool Command::has_arg(const char *long_name)
-{
-    if (longname_2_arg_.count(long_name) == 0) {
-        return false;
+struct SchemaBlob::CommandView {
+    const SchemaBlob &blob;
+    const internel::BlobCommand &command;
+
+    const char *command_name() const { return blob.strings_ + command.name; }
+    int32_t find_long(std::string_view name) const
+    {
+        return blob.find_long(command, name, internel::hash_name(name));
     }
-    return longname_2_arg_.at(long_name)->is_hit();
-}
+    int32_t find_short(char name) const { return blob.find_short(command, name); }
+    bool is_flag(int32_t index) const
+    {
+        return blob.arg_at(command, index).type == static_cast<uint32_t>(ArgType::FLAG);
+    }
+    const char *long_name(int32_t index) const { return blob.strings_ + blob.arg_at(command, index).long_name; }
+    void print_usage() const
+    {
+        if (command.usage != internel::BLOB_NONE) {
+            std::cout << blob.strings_ + command.usage << std::endl;
+        }
+    }
+};
 
-bool Command::has_arg(char short_name)
+SchemaBlob::SchemaBlob(SchemaBlob &&other) noexcept { *this = std::move(other); }
+
+SchemaBlob &SchemaBlob::operator=(SchemaBlob &&other) noexcept
 {
-    if (shortname_2_arg_.count(short_name) == 0) {
-        return false;
+    if (this != &other) {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(commands_, other.commands_);
+        std::swap(args_, other.args_);
+        std::swap(words_, other.words_);
+        std::swap(strings_, other.strings_);
+        std::swap(mapped_, other.mapped_);
+        std::swap(mapped_size_, other.mapped_size_);
     }
-    return shortname_2_arg_.at(short_name)->is_hit();
+    return *this;
 }
 
-void Command::update_c_long_args(std::shared_ptr<Arg> arg)
+SchemaBlob::~SchemaBlob()
 {
-    // 如果一个参数被传递，那么该参数的值也应该被传递。因此在这里，除了标志参数外的其它类型参数都被设置为
-    // `required_argument`（即需要传递值）
-    c_long_opts_.emplace_back(option{arg->get_long(),
-                                     arg->get_arg_type() == ArgType::FLAG ? no_argument : required_argument, NULL,
-                                     arg->get_short() != ' ' ? arg->get_short() : arg->get_argid()});
+    if (mapped_ != nullptr) {
+        munmap(mapped_, mapped_size_);
+    }
 }
 
-void Command::update_c_short_args(std::shared_ptr<Arg> arg)
+SchemaBlob SchemaBlob::from_memory(const void *data, size_t size)
 {
-    // 如果一个参数被传递，那么该参数的值也应该被传递。因此在这里，除了标志参数外的其它类型参数都被设置为
-    // `required_argument`（即需要传递值）
-    if (arg->get_arg_type() == ArgType::FLAG) {
-        c_short_opts_.push_back(arg->get_short());
-    } else {
-        c_short_opts_.push_back(arg->get_short());
-        c_short_opts_.push_back(':');
-    }
+    SchemaBlob blob;
+    blob.data_ = static_cast<const uint8_t *>(data);
+    blob.size_ = size;
+    blob.validate();
+    return blob;
 }
 
-void Command::reset_arg_status()
+SchemaBlob SchemaBlob::load(const char *path)
 {
-    // 可以在主函数中多次调用 `parse_args`，但是需要清除上次调用 `parse_args` 设置的一些信息
-    for (auto &iter : longname_2_arg_) {
-        iter.second->reset_status_info();
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat file_stat {};
+    if (fd < 0 || fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        std::stringstream error_msg;
+        error_msg << "Can not open schema file '" << path << "'.";
+        internel::exit_or_throw(error_msg);
     }
-
-    for (auto &iter : shortname_2_arg_) {
-        iter.second->reset_status_info();
+    size_t size = static_cast<size_t>(file_stat.st_size);
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::stringstream error_msg;
+        error_msg << "Can not map schema file '" << path << "'.";
+        internel::exit_or_throw(error_msg);
     }
 
-    position_values_.clear();
-
-    internel::error_msg = std::stringstream();
+    SchemaBlob blob;
+    blob.mapped_ = addr;
+    blob.mapped_size_ = size;
+    blob.data_ = static_cast<const uint8_t *>(addr);
+    blob.size_ = size;
+    blob.validate();
+    return blob;
 }
 
-void Command::do_parse_args(int argc, char **argv)
+void SchemaBlob::validate()
 {
-    if (subcommandname_2_subcommand_.empty()) {
-        add_help_arg();
-        c_long_opts_.emplace_back(option{NULL, 0, NULL, 0});
-        do_parse_args_internel(argc, argv);
-        check_conflict_with_all_args();
-        check_related_groups();
-        check_conflict_groups();
-        check_one_required_group();
-    } else {
-        // 从 `argv` 中查找子命令对应的索引
-        int idx = 0;
-        for (; idx < argc; idx++) {
-            if (subcommandname_2_subcommand_.count(argv[idx]) == 1) {
-                break;
-            }
-        }
-
-        // 首先，解析当前层级的参数（即父命令的参数）
-        add_help_arg();
-        c_long_opts_.emplace_back(option{NULL, 0, NULL, 0});
-        do_parse_args_internel(idx, argv);
-        check_conflict_with_all_args();
-        check_related_groups();
-        check_conflict_groups();
-        check_one_required_group();
+    internel::BlobHeader header{};
+    bool valid = data_ != nullptr && reinterpret_cast<uintptr_t>(data_) % alignof(uint32_t) == 0 &&
+                 size_ >= sizeof(header);
+    if (valid) {
+        memcpy(&header, data_, sizeof(header));
+        uint64_t expected_size = sizeof(header) + uint64_t(header.command_count) * sizeof(internel::BlobCommand) +
+                                 uint64_t(header.arg_count) * sizeof(internel::BlobArg) +
+                                 uint64_t(header.word_count) * sizeof(uint32_t) + header.string_size;
+        valid = header.magic == internel::BLOB_MAGIC && header.version == internel::BLOB_VERSION &&
+                header.command_count > 0 && header.string_size > 0 && expected_size == header.size &&
+                header.size <= size_ && data_[header.size - 1] == '\0';
+    }
+    if (valid) {
+        commands_ = reinterpret_cast<const internel::BlobCommand *>(data_ + sizeof(header));
+        args_ = reinterpret_cast<const internel::BlobArg *>(commands_ + header.command_count);
+        words_ = reinterpret_cast<const uint32_t *>(args_ + header.arg_count);
+        strings_ = reinterpret_cast<const char *>(words_ + header.word_count);
+    }
 
-        // 然后判断是否找到了子命令
-        // 这涉及到出错时信息显示顺序的问题。采用这种方式，会先显示父命令的错误信息，然后再显示子命令的错误信息。
-        if (idx == argc) {
-            internel::error_msg << command_name_ << ": Missing subcommand.";
-            internel::exit_or_throw(internel::error_msg);
+    // 描述可能来自任意文件，解析时不再做边界检查，因此在这里检查每个记录中的偏移和个数
+    // 字符串表以 `\0` 结尾，偏移在字符串表内的字符串都是完整的
+    auto is_words = [&header](uint64_t offset, uint64_t count) { return offset + count <= header.word_count; };
+    auto is_string = [&header](uint32_t offset) { return offset < header.string_size; };
+    for (uint32_t i = 0; valid && i < header.arg_count; i++) {
+        const internel::BlobArg &arg = args_[i];
+        valid = (arg.long_name == internel::BLOB_NONE ||
+                 uint64_t(arg.long_name) + arg.long_length < header.string_size) &&
+                arg.type <= static_cast<uint32_t>(ArgType::POSITION) && is_words(arg.defaults, arg.default_count);
+        for (uint32_t j = 0; valid && j < arg.default_count; j++) {
+            valid = is_string(words_[arg.defaults + j]);
         }
-
-        current_subcommand_name_ = argv[idx];
-
-        // 进而，解析下一层级的参数（即子命令的参数）
-        subcommandname_2_subcommand_.at(argv[idx])->do_parse_args(argc - idx, argv + idx);
     }
-}
-
-void Command::do_parse_args_internel(int argc, char **argv)
-{
-    // 注意，必须显式地将 `optind` 设置为 1，因为函数 `getopt_long_only` 在解析之前要求 `optind ==1`。
-    // 因为当前支持子命令，并且 `optind` 是一个全局变量，当解析父命令时，`optind` 的值已经被更新了。
-    // 因此，当解析子命令时，`optind` 不再是 1，这将导致解析错误。
-    optind = 1;
-    int ret = 0;
-    int long_index = 0;
-    while ((ret = getopt_long_only(argc, argv, c_short_opts_.c_str(), c_long_opts_.data(), &long_index)) != -1) {
-        std::shared_ptr<Arg> arg;
-        if (ret < 0) {  // 返回负数表示解析遇到了长参数，参看 `current_argid_` 和 `update_c_long_args` 函数
-            if (ret == longname_2_arg_.at("help")->get_argid()) {
-                print_usage_help();
-            }
-            arg = argid_2_arg_.at(ret);  // 正常情况下，这里不应该抛出异常
-        } else {  //  返回正数表示解析遇到了短参数，参看 `current_argid_` 和 `update_c_short_args` 函数
-            if (ret == '?' || ret == ':') {
-                internel::error_msg << command_name_ << ": Function `getopt_long_only` returned an error.";
-                internel::exit_or_throw(internel::error_msg);
+    for (uint32_t i = 0; valid && i < header.command_count; i++) {
+        const internel::BlobCommand &command = commands_[i];
+        // 长名字哈希表的槽位数为 2 的幂并且至少有一个空槽位，否则查找不存在的名字时不会停止
+        valid = is_string(command.name) && (command.usage == internel::BLOB_NONE || is_string(command.usage)) &&
+                uint64_t(command.arg_begin) + command.arg_count <= header.arg_count &&
+                command.long_slot_count > command.arg_count &&
+                (command.long_slot_count & (command.long_slot_count - 1)) == 0 &&
+                is_words(command.long_slots, command.long_slot_count) &&
+                is_words(command.shorts, uint64_t(command.short_count) * 2) &&
+                is_words(command.subcommands, uint64_t(command.subcommand_count) * 2) &&
+                command.mask_words == (uint64_t(command.arg_count) + 31) / 32 &&
+                is_words(command.required_mask, command.mask_words) &&
+                is_words(command.conflict_with_all_mask, command.mask_words);
+        bool has_empty_slot = false;
+        for (uint32_t j = 0; valid && j < command.long_slot_count; j++) {
+            uint32_t index = words_[command.long_slots + j];
+            has_empty_slot |= index == internel::BLOB_NONE;
+            valid = index == internel::BLOB_NONE ||
+                    (index < command.arg_count && args_[command.arg_begin + index].long_name != internel::BLOB_NONE);
+        }
+        valid = valid && has_empty_slot;
+        for (uint32_t j = 0; valid && j < command.short_count; j++) {
+            valid = words_[command.shorts + j * 2 + 1] < command.arg_count;
+        }
+        for (uint32_t j = 0; valid && j < command.subcommand_count; j++) {
+            valid = is_string(words_[command.subcommands + j * 2]) &&
+                    words_[command.subcommands + j * 2 + 1] < header.command_count;
+        }
+        // 参数组依次为：种类、名字个数、名字、掩码
+        uint64_t group = command.groups;
+        for (uint32_t j = 0; valid && j < command.group_count; j++) {
+            valid = is_words(group, 2) && is_words(group + 2, uint64_t(words_[group + 1]) + command.mask_words);
+            for (uint32_t k = 0; valid && k < words_[group + 1]; k++) {
+                valid = is_string(words_[group + 2 + k]);
             }
-            if (ret == 'h') {
-                print_usage_help();
+            if (valid) {
+                group += 2 + uint64_t(words_[group + 1]) + command.mask_words;
             }
-            arg = shortname_2_arg_.at(static_cast<char>(ret));  // 正常情况下，这里不应该抛出异常
-        }
-        arg->set_hit();
-        if (optarg) {
-            arg->set_value(optarg);
-        } else {
-            arg->set_value("1");
         }
     }
-    // 验证所有必选参数是否都已被传递
-    check_required_args();
 
-    // 解析位置参数
-    argc -= optind;
-    argv += optind;
-    if (static_cast<size_t>(argc) < position_args_.size()) {
-        internel::error_msg << command_name_ << ": Missing required position arguments.";
-        internel::exit_or_throw(internel::error_msg);
-    }
-    for (size_t i = 0; i < static_cast<size_t>(argc); i++) {
-        position_values_.emplace_back(argv[i]);
-        // 检查在命令中显式设置的位置参数，而不检查其它未显式设置的位置参数（用户可能仅设置了 3
-        // 个位置参数，但是传递了大于 3 个的位置参数）
-        if (i < position_args_.size()) {
-            position_args_.at(i)->set_value(argv[i]);
-        }
+    if (!valid) {
+        commands_ = nullptr;
+        std::stringstream error_msg;
+        error_msg << "Invalid schema blob.";
+        internel::exit_or_throw(error_msg);
     }
 }
 
-void Command::check_required_args()
+BlobParseResult SchemaBlob::parse(int argc, const char *const *argv) const
 {
-    for (const auto &iter : longname_2_arg_) {
-        const std::shared_ptr<Arg> &arg = iter.second;
-        if (arg->get_arg_type() == ArgType::REQUIRED && !arg->is_hit()) {
-            internel::error_msg << command_name_ << ": Missing required option: --" << arg->get_long() << ".";
-            internel::exit_or_throw(internel::error_msg);
-        }
-    }
+    BlobParseResult result;
+    parse(argc, argv, result);
+    return result;
+}
 
-    for (const auto &iter : shortname_2_arg_) {
-        const std::shared_ptr<Arg> &arg = iter.second;
-        if (arg->get_arg_type() == ArgType::REQUIRED && !arg->is_hit()) {
-            internel::error_msg << command_name_ << ": Missing required option: -" << arg->get_short() << ".";
-            internel::exit_or_throw(internel::error_msg);
-        }
+BlobParseResult SchemaBlob::parse(const std::vector<const char *> &args) const
+{
+    return parse(static_cast<int>(args.size()), args.data());
+}
+
+void SchemaBlob::parse(int argc, const char *const *argv, BlobParseResult &result) const
+{
+    if (commands_ == nullptr) {
+        std::stringstream error_msg;
+        error_msg << "Invalid schema blob.";
+        internel::exit_or_throw(error_msg);
     }
+    do_parse(commands_[0], argc, argv, result);
 }
 
-void Command::check_conflict_with_all_args()
+void SchemaBlob::parse(const std::vector<const char *> &args, BlobParseResult &result) const
 {
-    for (const auto &arg : conflict_with_all_args_) {
-        if (arg->is_hit()) {
-            // 如果这个参数与所有其它参数都冲突，那么不能传递其它任何参数
-            for (const auto &iter : longname_2_arg_) {
-                const std::shared_ptr<Arg> &arg2 = iter.second;
-                if (arg->get_long() == arg2->get_long()) {
-                    continue;
-                } else {
-                    if (arg2->is_hit()) {
-                        internel::error_msg << command_name_
-                                            << ": The conflict relationship is not satisfied. Option --"
-                                            << arg->get_long() << " is conflict with all other options.";
-                        internel::exit_or_throw(internel::error_msg);
-                    }
-                }
-            }
+    parse(static_cast<int>(args.size()), args.data(), result);
+}
 
-            for (const auto &iter : shortname_2_arg_) {
-                const std::shared_ptr<Arg> &arg2 = iter.second;
-                if (arg->get_short() == arg2->get_short()) {
-                    continue;
-                } else {
-                    if (arg2->is_hit()) {
-                        internel::error_msg << command_name_ << ": The conflict relationship is not satisfied. Option -"
-                                            << arg->get_short() << " is conflict with all other options.";
-                        internel::exit_or_throw(internel::error_msg);
-                    }
-                }
-            }
+void SchemaBlob::do_parse(const internel::BlobCommand &command, int argc, const char *const *argv,
+                          BlobParseResult &result) const
+{
+    result.reset(*this, command);
+    CommandView view{*this, command};
+    if (command.subcommand_count == 0) {
+        internel::parse_simple_args(view, argc, argv, result);
+        check_result(command, result);
+        return;
+    }
+
+    // 与 `Command` 一样先找到子命令，再分别解析父命令和子命令的参数
+    // 不同的是从 `argv[1]` 开始查找：`argv[0]` 是程序名，即使与某个子命令同名也不作为子命令
+    int idx = 1;
+    int32_t subcommand = -1;
+    for (; idx < argc; idx++) {
+        subcommand = find_subcommand(command, argv[idx]);
+        if (subcommand >= 0) {
+            break;
         }
     }
+    internel::parse_simple_args(view, idx, argv, result);
+    check_result(command, result);
+    if (idx == argc) {
+        std::stringstream error_msg;
+        error_msg << view.command_name() << ": Missing subcommand.";
+        internel::exit_or_throw(error_msg);
+    }
+    if (!result.subcommand_result_) {
+        result.subcommand_result_ = std::make_unique<BlobParseResult>();
+    }
+    result.has_subcommand_ = true;
+    do_parse(commands_[subcommand], argc - idx, argv + idx, *result.subcommand_result_);
 }
 
-void Command::check_related_groups()
+void SchemaBlob::check_result(const internel::BlobCommand &command, const BlobParseResult &result) const
 {
-    size_t idx = 0;
-    for (const auto &group : related_groups_) {
-        // 相关组用于确保指定的参数必须同时存在或同时不存在，即 `count == 0` 或 `count == related_group.size()`。
-        // 否则，相关组的要求必定无法满足。这里的 `count` 是指相关组中实际传递的参数数量（is_hit() == true），
-        // `related_group.size()` 是相关组中参数的总数。意思是在解析命令行参数时，相关组里的参数要么一个都不传递，
-        // 要么全部传递，不然就不符合相关组的规则。
-        size_t count = std::count_if(group.begin(), group.end(), [this](const char *name) {
-            if (strlen(name) == 1) {
-                if (shortname_2_arg_.count(name[0]) == 0) {
-                    internel::error_msg << command_name_ << ": Can not find -" << name << " option.";
-                    internel::exit_or_throw(internel::error_msg);
-                }
-                return shortname_2_arg_.at(name[0])->is_hit();
-            } else {
-                if (longname_2_arg_.count(name) == 0) {
-                    internel::error_msg << command_name_ << ": Can not find --" << name << " option.";
-                    internel::exit_or_throw(internel::error_msg);
-                }
-                return longname_2_arg_.at(name)->is_hit();
+    const char *command_name = strings_ + command.name;
+    const uint32_t *required_mask = words_ + command.required_mask;
+    for (uint32_t i = 0; i < command.mask_words; i++) {
+        if ((required_mask[i] & result.hit_words_[i]) == required_mask[i]) {
+            continue;
+        }
+        for (uint32_t index = i * 32; index < command.arg_count; index++) {
+            if ((required_mask[index >> 5] >> (index & 31) & 1) != 0 && !result.is_hit(static_cast<int32_t>(index))) {
+                std::stringstream error_msg;
+                error_msg << command_name << ": Missing required option: ";
+                describe_arg(error_msg, arg_at(command, index));
+                error_msg << ".";
+                internel::exit_or_throw(error_msg);
             }
-        });
-        if (count != 0 && count != group.size()) {
-            internel::error_msg << command_name_ << ": The related relationship is not satisfied. "
-                                << get_description(related_groups_.at(idx)) << ": is related with each other.";
-            internel::exit_or_throw(internel::error_msg);
         }
-        idx++;
     }
-}
 
-void Command::check_conflict_groups()
-{
-    size_t idx = 0;
-    for (const auto &group : conflict_groups_) {
-        // 冲突组确保其中最多只能有一个参数被传递，即 `count <= 1`。如果 `count > 1`，则必定不满足冲突组的要求。
-        size_t count = std::count_if(group.begin(), group.end(), [this](const char *name) {
-            if (strlen(name) == 1) {
-                if (shortname_2_arg_.count(name[0]) == 0) {
-                    internel::error_msg << command_name_ << ": Can not find -" << name << " option.";
-                    internel::exit_or_throw(internel::error_msg);
-                }
-                return shortname_2_arg_.at(name[0])->is_hit();
-            } else {
-                if (longname_2_arg_.count(name) == 0) {
-                    internel::error_msg << command_name_ << ": Can not find --" << name << " option.";
-                    internel::exit_or_throw(internel::error_msg);
-                }
-                return longname_2_arg_.at(name)->is_hit();
+    if (result.positions_.size() < command.position_count) {
+        std::stringstream error_msg;
+        error_msg << command_name << ": Missing required position arguments.";
+        internel::exit_or_throw(error_msg);
+    }
+
+    if (result.hit_count_ > 1) {
+        const uint32_t *conflict_mask = words_ + command.conflict_with_all_mask;
+        for (uint32_t index = 0; index < command.arg_count; index++) {
+            if ((conflict_mask[index >> 5] >> (index & 31) & 1) != 0 && result.is_hit(static_cast<int32_t>(index))) {
+                std::stringstream error_msg;
+                error_msg << command_name << ": The conflict relationship is not satisfied. Option ";
+                describe_arg(error_msg, arg_at(command, index));
+                error_msg << " is conflict with all other options.";
+                internel::exit_or_throw(error_msg);
             }
-        });
-        if (count > 1) {
-            internel::error_msg << command_name_ << ": The conflict relationship is not satisfied. "
-                                << get_description(conflict_groups_.at(idx)) << ": is conflict with each other.";
-            internel::exit_or_throw(internel::error_msg);
         }
-        idx++;
     }
-}
 
-void Command::check_one_required_group()
-{
-    size_t idx = 0;
-    for (const auto &group : one_required_groups_) {
-        // 至少选其一组确保该组中至少有一个参数存在，即 `count >= 1`。如果 `count < 1`，
-        // 则必定不满足至少选其一组的要求。
-        size_t count = std::count_if(group.begin(), group.end(), [this](const char *name) {
-            if (strlen(name) == 1) {
-                if (shortname_2_arg_.count(name[0]) == 0) {
-                    internel::error_msg << command_name_ << ": Can not find -" << name << " option.";
-                    internel::exit_or_throw(internel::error_msg);
-                }
-                return shortname_2_arg_.at(name[0])->is_hit();
-            } else {
-                if (longname_2_arg_.count(name) == 0) {
-                    internel::error_msg << command_name_ << ": Can not find --" << name << " option.";
-                    internel::exit_or_throw(internel::error_msg);
-                }
-                return longname_2_arg_.at(name)->is_hit();
-            }
-        });
-        if (count < 1) {
-            internel::error_msg << command_name_ << ": The one of require relationship is not satisfied. "
-                                << get_description(one_required_groups_.at(idx))
-                                << ": at least one option should exist.";
-            internel::exit_or_throw(internel::error_msg);
+    const uint32_t *group = words_ + command.groups;
+    for (uint32_t i = 0; i < command.group_count; i++) {
+        uint32_t kind = group[0];
+        uint32_t name_count = group[1];
+        const uint32_t *names = group + 2;
+        const uint32_t *mask = names + name_count;
+        size_t count = 0;
+        size_t size = 0;
+        for (uint32_t j = 0; j < command.mask_words; j++) {
+            count += __builtin_popcount(mask[j] & result.hit_words_[j]);
+            size += __builtin_popcount(mask[j]);
         }
-        idx++;
+        std::stringstream error_msg;
+        if (kind == internel::BLOB_RELATED_GROUP && count != 0 && count != size) {
+            error_msg << command_name << ": The related relationship is not satisfied. "
+                      << get_group_description(names, name_count) << ": is related with each other.";
+            internel::exit_or_throw(error_msg);
+        } else if (kind == internel::BLOB_CONFLICT_GROUP && count > 1) {
+            error_msg << command_name << ": The conflict relationship is not satisfied. "
+                      << get_group_description(names, name_count) << ": is conflict with each other.";
+            internel::exit_or_throw(error_msg);
+        } else if (kind == internel::BLOB_ONE_REQUIRED_GROUP && count < 1) {
+            error_msg << command_name << ": The one of require relationship is not satisfied. "
+                      << get_group_description(names, name_count) << ": at least one option should exist.";
+            internel::exit_or_throw(error_msg);
+        }
+        group = mask + command.mask_words;
     }
 }
 
-std::string Command::get_description(std::vector<const char *> &group)
+std::string SchemaBlob::get_group_description(const uint32_t *names, uint32_t count) const
 {
     std::string description;
-    description.reserve(100);
     description.push_back('[');
-    for (const auto &arg : group) {
-        description.append(strlen(arg) == 1 ? "-" : "--");
-        description.append(", ");
+    for (uint32_t i = 0; i < count; i++) {
+        const char *name = strings_ + names[i];
+        description.append(i == 0 ? "" : ", ").append(strlen(name) == 1 ? "-" : "--").append(name);
     }
-    description.pop_back();
-    description.pop_back();
     description.push_back(']');
     return description;
 }
 
-void Command::add_help_arg()
+void SchemaBlob::describe_arg(std::stringstream &error_msg, const internel::BlobArg &arg) const
 {
-    std::shared_ptr<Arg> arg = Arg::new_help_arg();
-
-    int argid = current_argid_--;
-    arg->set_argid(argid);
-
-    longname_2_arg_[arg->get_long()] = arg;
-    update_c_long_args(arg);
+    if (arg.long_name != internel::BLOB_NONE) {
+        error_msg << "--" << strings_ + arg.long_name;
+    } else {
+        error_msg << "-" << static_cast<char>(arg.short_name);
+    }
+}
 
-    shortname_2_arg_[arg->get_short()] = arg;
-    update_c_short_args(arg);
+const internel::BlobArg &SchemaBlob::arg_at(const internel::BlobCommand &command, size_t index) const
+{
+    return args_[command.arg_begin + index];
+}
 
-    argid_2_arg_[argid] = arg;
+int32_t SchemaBlob::find_long(const internel::BlobCommand &command, std::string_view name, uint64_t hash) const
+{
+    const uint32_t *slots = words_ + command.long_slots;
+    uint32_t mask = command.long_slot_count - 1;
+    for (uint32_t slot = static_cast<uint32_t>(hash) & mask;; slot = (slot + 1) & mask) {
+        uint32_t index = slots[slot];
+        if (index == internel::BLOB_NONE) {
+            return -1;
+        }
+        const internel::BlobArg &arg = arg_at(command, index);
+        if (arg.long_length == name.size() && memcmp(strings_ + arg.long_name, name.data(), name.size()) == 0) {
+            return static_cast<int32_t>(index);
+        }
+    }
+}
 
-    arg->set_command(this);
-    arg->set_value("0");
-    arg->conflicts_with_all();
+int32_t SchemaBlob::find_short(const internel::BlobCommand &command, char name) const
+{
+    const uint32_t *shorts = words_ + command.shorts;
+    for (uint32_t i = 0; i < command.short_count; i++) {
+        if (shorts[i * 2] == static_cast<unsigned char>(name)) {
+            return static_cast<int32_t>(shorts[i * 2 + 1]);
+        }
+    }
+    return -1;
 }
 
-void Command::print_usage_help()
+int32_t SchemaBlob::find_subcommand(const internel::BlobCommand &command, const char *name) const
 {
-    if (usage_format1_ != nullptr) {
-        std::cout << usage_format1_ << std::endl;
-    } else {
-        for (size_t i = 0; i < line_size_; i++) {
-            std::cout << usage_format2_[i] << std::endl;
+    const uint32_t *subcommands = words_ + command.subcommands;
+    uint32_t left = 0;
+    uint32_t right = command.subcommand_count;
+    while (left < right) {
+        uint32_t middle = left + (right - left) / 2;
+        int cmp = strcmp(strings_ + subcommands[middle * 2], name);
+        if (cmp == 0) {
+            return static_cast<int32_t>(subcommands[middle * 2 + 1]);
+        }
+        if (cmp < 0) {
+            left = middle + 1;
+        } else {
+            right = middle;
         }
     }
-    internel::exit_or_throw(internel::error_msg);
+    return -1;
 }
 
 }  // namespace zul
@@ -1,8 +1,14 @@
+#include <sys/stat.h>
+#include <unistd.h>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 #include "argparse.h"
 #include "unittest_framework.h"
@@ -170,6 +176,60 @@ ADD_UNIT_TEST_CASE(argparse, test_very_big_range_value)
     CHECK_THOW(cmd->parse_args({"my_command", "--rangearg", "2147483648"}), ParseArgsError);
 }
 
+ADD_UNIT_TEST_CASE(argparse, test_typed_range)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("count")->range(1, 100))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("size")->range<uint64_t>(0, UINT64_MAX))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("ratio")->range(0.0, 0.5, true, false));
+
+    CHECK_NO_THOW(cmd->parse_args({"my_command", "--count", "1", "--size", "18446744073709551615", "--ratio", "0"}));
+    CHECK_NO_THOW(cmd->parse_args({"my_command", "--count", "100", "--ratio", "0.25"}));
+    CHECK_THOW(cmd->parse_args({"my_command", "--count", "0"}), ParseArgsError);
+    CHECK_THOW(cmd->parse_args({"my_command", "--count", "1.5"}), ParseArgsError);
+    CHECK_THOW(cmd->parse_args({"my_command", "--size", "-1"}), ParseArgsError);
+    CHECK_THOW(cmd->parse_args({"my_command", "--ratio", "0.5"}), ParseArgsError);
+
+    std::string error;
+    try {
+        cmd->parse_args({"my_command", "--ratio", "0.75"});
+    } catch (const ParseArgsError &e) {
+        error = e.what();
+    }
+    CHECK_EQ(error, "The value of option --ratio is not in the range of [0, 0.5).");
+
+    // 不合法的边界在声明参数时就报错
+    CHECK_THOW(Arg::new_arg(ArgType::OPTIONAL)->long_name("a")->range(NumType::INT, "1", "abc"), ParseArgsError);
+    CHECK_THOW(Arg::new_arg(ArgType::OPTIONAL)->long_name("a")->range(NumType::UINT, "-1", "10"), ParseArgsError);
+    CHECK_THOW(Arg::new_arg(ArgType::OPTIONAL)->long_name("a")->range(NumType::INT, "10", "1"), ParseArgsError);
+    CHECK_THOW(Arg::new_arg(ArgType::OPTIONAL)->long_name("a")->range(2.0, 1.0), ParseArgsError);
+    CHECK_THOW(Arg::new_arg(ArgType::FLAG)->long_name("a")->range(1, 2), ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_range_with_many_values)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("value")->range(NumType::INT, "0", "99999"));
+
+    std::vector<std::string> storage;
+    std::vector<const char *> args{"my_command"};
+    for (int i = 0; i < 100000; i++) {
+        storage.push_back(std::to_string(i));
+    }
+    for (const auto &value : storage) {
+        args.push_back("--value");
+        args.push_back(value.c_str());
+    }
+    ParseResult result = cmd->parse(args);
+    std::vector<int> values = result.get_many_values<int>("value");
+    CHECK_EQ(values.size(), 100000u);
+    CHECK_EQ(values.back(), 99999);
+
+    args.push_back("--value");
+    args.push_back("100000");
+    CHECK_THOW(cmd->parse(args), ParseArgsError);
+}
+
 ADD_UNIT_TEST_CASE(argparse, test_choices_required_long_name_arg)
 {
     auto cmd = Command::new_command("my_command")
@@ -225,6 +285,99 @@ ADD_UNIT_TEST_CASE(argparse, test_choices_position_arg)
     CHECK_THOW(cmd->parse_args({"my_command", "4"}), ParseArgsError);
 }
 
+ADD_UNIT_TEST_CASE(argparse, test_choices_description)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("mode")->choices({"fast", "slow", "fast", "auto"}));
+
+    CHECK_NO_THOW(cmd->parse_args({"my_command", "--mode", "auto"}));
+    CHECK_THOW(cmd->parse_args({"my_command", "--mode", "fas"}), ParseArgsError);
+    CHECK_THOW(cmd->parse_args({"my_command", "--mode", "fastest"}), ParseArgsError);
+
+    std::string error;
+    try {
+        cmd->parse_args({"my_command", "--mode", "medium"});
+    } catch (const ParseArgsError &e) {
+        error = e.what();
+    }
+    CHECK_EQ(error, "The value of option --mode is not within [auto, fast, slow].");
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_many_choices)
+{
+    std::vector<std::string> regions;
+    for (int i = 0; i < 5000; i++) {
+        regions.push_back("region-" + std::to_string(i));
+    }
+    std::vector<const char *> choices;
+    for (const auto &region : regions) {
+        choices.push_back(region.c_str());
+    }
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("region")->choices(std::move(choices)));
+
+    int mismatch_count = 0;
+    for (int i = 0; i < 5000; i += 7) {
+        ParseResult result = cmd->parse({"my_command", "--region", regions[i].c_str()});
+        mismatch_count += result.get_one_value<std::string_view>("region") != regions[i];
+    }
+    CHECK_EQ(mismatch_count, 0);
+    CHECK_THOW(cmd->parse({"my_command", "--region", "region-5000"}), ParseArgsError);
+    CHECK_THOW(cmd->parse({"my_command", "--region", "region-"}), ParseArgsError);
+    CHECK_THOW(cmd->parse({"my_command", "--region", ""}), ParseArgsError);
+}
+
+enum class Mode { FAST = 3, SAFE = 5 };
+
+ADD_UNIT_TEST_CASE(argparse, test_choice_ids)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("level")->choices({{"low", 10}, {"high", 20}}))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)
+                             ->short_name('m')
+                             ->default_value("safe")
+                             ->choices<Mode>({{"fast", Mode::FAST}, {"safe", Mode::SAFE}}))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)
+                             ->long_name("features")
+                             ->choices({{"read", 0}, {"write", 1}, {"exec", 2}}, true));
+
+    ParseResult result =
+        cmd->parse({"my_command", "--level", "high", "--features", "read,exec", "--features", "write"});
+    CHECK_EQ(result.get_choice_id("level"), 20);
+    CHECK_EQ(result.get_one_value<std::string_view>("level"), "high");
+    CHECK_EQ(result.get_one_value<Mode>('m') == Mode::SAFE, true);
+    CHECK_EQ(result.get_choice_mask("features"), 7u);
+    CHECK_EQ(result.get_choice_mask("level"), 1u << 20);
+
+    result = cmd->parse({"my_command", "-m", "fast", "--features", "write"});
+    CHECK_EQ(result.get_choice_id('m'), 3);
+    CHECK_EQ(result.get_one_value<Mode>('m') == Mode::FAST, true);
+    CHECK_EQ(result.get_choice_mask("features"), 2u);
+    CHECK_THOW(result.get_choice_id("features"), ParseArgsError);
+    CHECK_THOW(result.get_choice_id("level"), ParseArgsError);
+
+    CHECK_THOW(cmd->parse({"my_command", "--features", "read,"}), ParseArgsError);
+    CHECK_THOW(cmd->parse({"my_command", "--features", "read,delete"}), ParseArgsError);
+    CHECK_THOW(cmd->parse({"my_command", "--level", "low,high"}), ParseArgsError);
+
+    // 运行时生成的可选值
+    std::vector<std::pair<const char *, uint32_t>> shards{{"shard-a", 7}, {"shard-b", 9}};
+    auto sharded = Command::new_command("my_command")
+                       ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("shard")->choices(std::move(shards)));
+    CHECK_EQ(sharded->parse({"my_command", "--shard", "shard-b"}).get_choice_id("shard"), 9);
+
+    // 没有 ID 的可选值不能取出为枚举值
+    auto plain = Command::new_command("my_command")
+                     ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("mode")->choices({"fast", "safe"}));
+    result = plain->parse({"my_command", "--mode", "fast"});
+    CHECK_THOW(result.get_one_value<Mode>("mode"), ParseArgsError);
+    CHECK_THOW(result.get_choice_id("mode"), ParseArgsError);
+
+    // 重复的带 ID 的可选值、位掩码模式下超出范围的 ID
+    CHECK_THOW(Arg::new_arg(ArgType::OPTIONAL)->long_name("a")->choices({{"x", 1}, {"x", 2}}), ParseArgsError);
+    CHECK_THOW(Arg::new_arg(ArgType::OPTIONAL)->long_name("a")->choices({{"x", 64}}, true), ParseArgsError);
+}
+
 ADD_UNIT_TEST_CASE(argparse, test_optional_long_name_arg_with_default_value)
 {
     auto cmd = Command::new_command("my_command")
@@ -638,6 +791,628 @@ ADD_UNIT_TEST_CASE(argparse, test_mixed_long_short_name_one_required_group)
     CHECK_NO_THOW(cmd->parse_args({"my_command", "--aa", "1", "-b", "2", "-c", "3"}));
 }
 
+ADD_UNIT_TEST_CASE(argparse, test_group_with_unknown_name)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("aa"))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->short_name('b'));
+
+    // 参数组中的名字在声明时就解析，名字不存在时直接报错，而不是等到解析参数时
+    CHECK_THOW(cmd->related_group({"aa", "bb"}), ParseArgsError);
+    CHECK_THOW(cmd->conflict_group({"aa", "c"}), ParseArgsError);
+    CHECK_THOW(cmd->one_required_group({"a"}), ParseArgsError);
+    CHECK_NO_THOW(cmd->conflict_group({"aa", "b"}));
+    CHECK_NO_THOW(cmd->parse_args({"my_command", "--aa", "1"}));
+    CHECK_THOW(cmd->parse_args({"my_command", "--aa", "1", "-b", "2"}), ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_many_groups)
+{
+    // 参数个数超过一个字（64 位），参数组跨越多个字
+    std::vector<std::string> names;
+    for (int i = 0; i < 300; i++) {
+        names.push_back("option_" + std::to_string(i));
+    }
+    auto cmd = Command::new_command("my_command");
+    for (const auto &name : names) {
+        cmd->arg(Arg::new_arg(ArgType::FLAG)->long_name(name.c_str()));
+    }
+    // 每组包含第 i、i + 100、i + 200 个参数
+    for (int i = 0; i < 100; i++) {
+        cmd->related_group({names[i].c_str(), names[i + 100].c_str()});
+        cmd->conflict_group({names[i + 100].c_str(), names[i + 200].c_str()});
+        cmd->one_required_group({names[i].c_str(), names[i + 200].c_str()});
+    }
+
+    std::vector<std::string> storage;
+    for (int i = 0; i < 100; i++) {
+        storage.push_back("--" + names[i % 2 == 0 ? i + 200 : i]);
+        if (i % 2 != 0) {
+            storage.push_back("--" + names[i + 100]);
+        }
+    }
+    std::vector<const char *> args{"my_command"};
+    for (const auto &arg : storage) {
+        args.push_back(arg.c_str());
+    }
+    CHECK_NO_THOW(cmd->parse(args));
+
+    // 破坏关联组：只传递第 i + 100 个参数，不传递第 i 个参数
+    std::vector<const char *> related_args(args);
+    related_args.push_back("--option_150");
+    CHECK_THOW(cmd->parse(related_args), ParseArgsError);
+
+    // 破坏互斥组：同时传递第 i + 100 个和第 i + 200 个参数
+    std::vector<const char *> conflict_args(args);
+    conflict_args.push_back("--option_3");
+    conflict_args.push_back("--option_103");
+    conflict_args.push_back("--option_203");
+    CHECK_THOW(cmd->parse(conflict_args), ParseArgsError);
+
+    // 破坏至少选其一组：缺少第 98 组
+    std::vector<const char *> required_args;
+    for (const char *arg : args) {
+        if (std::string_view(arg) != "--option_298") {
+            required_args.push_back(arg);
+        }
+    }
+    CHECK_THOW(cmd->parse(required_args), ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_hit_bitset)
+{
+    // 参数个数超过两个字（128 位），必选参数和与所有参数互斥的参数分布在不同的字中
+    std::vector<std::string> names;
+    for (int i = 0; i < 130; i++) {
+        names.push_back("option_" + std::to_string(i));
+    }
+    auto cmd = Command::new_command("my_command");
+    for (int i = 0; i < 130; i++) {
+        if (i == 0 || i == 70 || i == 129) {
+            cmd->arg(Arg::new_arg(ArgType::REQUIRED)->long_name(names[i].c_str()));
+        } else if (i == 100) {
+            cmd->arg(Arg::new_arg(ArgType::FLAG)->long_name(names[i].c_str())->conflicts_with_all());
+        } else {
+            cmd->arg(Arg::new_arg(ArgType::FLAG)->long_name(names[i].c_str()));
+        }
+    }
+
+    ParseResult result = cmd->parse({"my_command", "--option_0", "a", "--option_70", "b", "--option_129", "c"});
+    CHECK_EQ(result.has_arg("option_0"), true);
+    CHECK_EQ(result.has_arg("option_129"), true);
+    CHECK_EQ(result.has_arg("option_1"), false);
+    CHECK_EQ(result.has_arg("option_100"), false);
+
+    std::string error;
+    try {
+        cmd->parse({"my_command", "--option_0", "a", "--option_129", "c"});
+    } catch (const ParseArgsError &e) {
+        error = e.what();
+    }
+    CHECK_EQ(error, "my_command: Missing required option: --option_70.");
+
+    // 与所有参数互斥的参数与其它参数一起传递时报错
+    CHECK_THOW(cmd->parse({"my_command", "--option_100", "--option_99"}), ParseArgsError);
+    CHECK_THOW(
+        cmd->parse({"my_command", "--option_0", "a", "--option_70", "b", "--option_129", "c", "--option_100"}),
+        ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_reuse_parse_result)
+{
+    auto sub = Command::new_command("sub");
+    sub->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("level")->default_value("1"));
+    auto cmd = Command::new_command("my_command");
+    cmd->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("name")->default_value("default"))
+        ->arg(Arg::new_arg(ArgType::FLAG)->long_name("verbose"))
+        ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("tag"))
+        ->subcommand(sub);
+
+    ParseResult result;
+    cmd->parse({"my_command", "--name", "a", "--verbose", "--tag", "x", "--tag", "y", "sub", "--level", "3"},
+               result);
+    CHECK_EQ(result.get_one_value<std::string>("name"), "a");
+    CHECK_EQ(result.has_arg("verbose"), true);
+    CHECK_ARRAY_EQ(result.get_many_values<std::string_view>("tag"), (std::vector<std::string_view>{"x", "y"}));
+    CHECK_EQ(result.get_subcommand().get_one_value<int>("level"), 3);
+
+    // 上一次解析的值不会遗留到本次解析中
+    cmd->parse({"my_command", "--tag", "z", "sub"}, result);
+    CHECK_EQ(result.get_one_value<std::string>("name"), "default");
+    CHECK_EQ(result.has_arg("name"), false);
+    CHECK_EQ(result.has_arg("verbose"), false);
+    CHECK_ARRAY_EQ(result.get_many_values<std::string_view>("tag"), (std::vector<std::string_view>{"z"}));
+    CHECK_EQ(result.get_subcommand().has_arg("level"), false);
+    CHECK_EQ(result.get_subcommand().get_one_value<int>("level"), 1);
+
+    // 复用时切换到另一个命令
+    sub->parse({"sub", "--level", "5"}, result);
+    CHECK_EQ(result.get_one_value<int>("level"), 5);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_arg_handle)
+{
+    auto cmd = Command::new_command("my_command");
+    ArgHandle<uint64_t> batch_size =
+        cmd->add_arg<uint64_t>(Arg::new_arg(ArgType::OPTIONAL)->long_name("batch_size")->default_value("32"));
+    ArgHandle<std::string> files = cmd->add_arg<std::string>(Arg::new_arg(ArgType::OPTIONAL)->short_name('f'));
+    ArgHandle<int> verbose = cmd->add_arg<int>(Arg::new_arg(ArgType::FLAG)->long_name("verbose"));
+    ArgHandle<Mode> mode = cmd->add_arg<Mode>(
+        Arg::new_arg(ArgType::OPTIONAL)->long_name("mode")->choices({{"fast", 3}, {"safe", 5}})->default_value("safe"));
+    CHECK_EQ(batch_size.valid(), true);
+    CHECK_EQ(ArgHandle<int>().valid(), false);
+
+    ParseResult result = cmd->parse({"my_command", "--batch_size", "128", "-f", "a", "-f", "b", "--mode", "fast"});
+    CHECK_EQ(result.get_one_value(batch_size), 128);
+    CHECK_EQ(result.has_arg(batch_size), true);
+    CHECK_ARRAY_EQ(result.get_many_values(files), (std::vector<std::string>{"a", "b"}));
+    CHECK_EQ(result.has_arg(verbose), false);
+    CHECK_EQ(result.get_one_value(verbose), 0);
+    CHECK_EQ(result.get_one_value(mode) == Mode::FAST, true);
+
+    // 未传递时返回默认值，没有默认值时报错
+    cmd->parse({"my_command", "--verbose"}, result);
+    CHECK_EQ(result.get_one_value(batch_size), 32);
+    CHECK_EQ(result.get_one_value(verbose), 1);
+    CHECK_EQ(result.get_one_value(mode) == Mode::SAFE, true);
+    CHECK_THOW(result.get_one_value(files), ParseArgsError);
+
+    // 获取已添加的参数的句柄，与按名字取值的结果一致
+    ArgHandle<int> batch_size_int = cmd->get_arg_handle<int>("batch_size");
+    ArgHandle<std::string_view> files_sv = cmd->get_arg_handle<std::string_view>('f');
+    cmd->parse_args({"my_command", "--batch_size", "7", "-f", "c"});
+    CHECK_EQ(cmd->get_one_value(batch_size_int), cmd->get_one_value<int>("batch_size"));
+    CHECK_EQ(cmd->get_one_value(files_sv), "c");
+    CHECK_EQ(cmd->has_arg(verbose), false);
+    CHECK_THOW(cmd->get_arg_handle<int>("unknown"), ParseArgsError);
+
+    // 句柄不属于解析结果对应的命令时报错
+    auto other = Command::new_command("other");
+    ArgHandle<int> other_arg = other->add_arg<int>(Arg::new_arg(ArgType::OPTIONAL)->long_name("batch_size"));
+    CHECK_THOW(result.get_one_value(other_arg), ParseArgsError);
+    CHECK_THOW(result.get_one_value(ArgHandle<int>()), ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_arg_key)
+{
+    // 哈希值在编译期计算
+    static constexpr ArgKey batch_size = "batch_size"_arg;
+    static_assert(batch_size.hash() == internel::hash_name("batch_size"), "hash should be computed at compile time");
+    static_assert(batch_size.view().size() == 10, "length should be computed at compile time");
+
+    auto cmd = Command::new_command("my_command");
+    cmd->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("batch_size")->default_value("32"))
+        ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("file"))
+        ->arg(Arg::new_arg(ArgType::FLAG)->long_name("verbose"));
+
+    ParseResult result = cmd->parse({"my_command", "--batch_size", "64", "--file", "a", "--file", "b"});
+    CHECK_EQ(result.get_one_value<uint64_t>(batch_size), 64);
+    CHECK_EQ(result.has_arg(batch_size), true);
+    CHECK_EQ(result.has_arg("verbose"_arg), false);
+    CHECK_EQ(result.get_one_value<int>("verbose"_arg), 0);
+    CHECK_ARRAY_EQ(result.get_many_values<std::string>("file"_arg), (std::vector<std::string>{"a", "b"}));
+    // 只匹配完整的名字，不做前缀匹配
+    CHECK_THOW(result.get_one_value<int>("batch"_arg), ParseArgsError);
+#ifndef NDEBUG
+    // 调试模式下，`has_arg` 的名字不存在时报错
+    CHECK_THOW(result.has_arg("verbos"_arg), ParseArgsError);
+#endif
+
+    cmd->parse_args({"my_command", "--verbose"});
+    CHECK_EQ(cmd->get_one_value<int>("batch_size"_arg), 32);
+    CHECK_EQ(cmd->has_arg("verbose"_arg), true);
+    CHECK_EQ(cmd->get_many_values<std::string>("file"_arg).size(), 0);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_static_command)
+{
+    // 命令在编译期构造，参数名字不合法时编译失败
+    static constexpr auto cmd =
+        make_static_command("my_command", {StaticArg{ArgType::OPTIONAL, "batch_size", 'b', "32"},
+                                           StaticArg{ArgType::REQUIRED, "file", 'f'},
+                                           StaticArg{ArgType::FLAG, "verbose", 'v'},
+                                           StaticArg{ArgType::FLAG, nullptr, 'x'}, StaticArg{ArgType::POSITION}});
+    static_assert(cmd.size() == 5, "the command should be constructed at compile time");
+    static StaticParseResult<cmd.size()> result;
+
+    cmd.parse({"my_command", "--file=a", "-vx", "in.txt", "-fb", "--", "-b"}, result);
+    CHECK_EQ(result.get_one_value<int>("batch_size"), 32);
+    CHECK_EQ(result.has_arg("batch_size"), false);
+    CHECK_ARRAY_EQ(result.get_many_values<std::string>('f'), (std::vector<std::string>{"a", "b"}));
+    CHECK_EQ(result.has_arg("verbose"_arg), true);
+    CHECK_EQ(result.get_one_value<int>('x'), 1);
+    CHECK_EQ(result.position_count(), 2);
+    CHECK_EQ(result.get_one_position_value<std::string>(0), "in.txt");
+    CHECK_EQ(result.get_one_position_value<std::string>(1), "-b");
+
+    cmd.parse({"my_command", "-b", "64", "--file", "c", "--batch_size=128", "out.txt"}, result);
+    CHECK_ARRAY_EQ(result.get_many_values<int>("batch_size"_arg), (std::vector<int>{64, 128}));
+    CHECK_EQ(result.get_one_value<std::string>("file"), "c");
+    CHECK_EQ(result.get_one_value<int>("verbose"), 0);
+    CHECK_EQ(result.has_arg('v'), false);
+    CHECK_THOW(result.get_one_value<int>("unknown"), ParseArgsError);
+
+    CHECK_THOW(cmd.parse({"my_command", "out.txt"}, result), ParseArgsError);
+    CHECK_THOW(cmd.parse({"my_command", "--file", "a"}, result), ParseArgsError);
+    CHECK_THOW(cmd.parse({"my_command", "--file", "a", "--verbose=1", "out.txt"}, result), ParseArgsError);
+    CHECK_THOW(cmd.parse({"my_command", "--file", "a", "--batch", "1", "out.txt"}, result), ParseArgsError);
+    CHECK_THOW(cmd.parse({"my_command", "--file", "a", "-y", "out.txt"}, result), ParseArgsError);
+    CHECK_THOW(cmd.parse({"my_command", "out.txt", "--file"}, result), ParseArgsError);
+
+    // 与 `Command` 相同，短参数簇中的 `h` 表示帮助参数（输出帮助信息，异常中没有错误信息），
+    // 紧跟在非标志参数之后时是它的值
+    for (const char *cluster : {"-h", "-vh", "-hv"}) {
+        std::string error = "not thrown";
+        try {
+            cmd.parse({"my_command", cluster, "--file", "a", "out.txt"}, result);
+        } catch (const ParseArgsError &e) {
+            error = e.what();
+        }
+        CHECK_EQ(error, "");
+    }
+    CHECK_NO_THOW(cmd.parse({"my_command", "-fh", "out.txt"}, result));
+    CHECK_EQ(result.get_one_value<std::string>('f'), "h");
+
+    // 值的个数超过解析结果的容量时报错
+    StaticParseResult<cmd.size(), 2> small_result;
+    CHECK_NO_THOW(cmd.parse({"my_command", "-fa", "-fb", "out.txt"}, small_result));
+    CHECK_THOW(cmd.parse({"my_command", "-fa", "-fb", "-fc", "out.txt"}, small_result), ParseArgsError);
+
+    // 在运行期构造时，不合法的描述通过异常报错
+    CHECK_THOW(make_static_command("my_command", {StaticArg{ArgType::OPTIONAL, "help"}}), ParseArgsError);
+    CHECK_THOW(make_static_command("my_command", {StaticArg{ArgType::OPTIONAL, nullptr, 'h'}}), ParseArgsError);
+    CHECK_THOW(make_static_command("my_command", {StaticArg{ArgType::OPTIONAL, "a"}}), ParseArgsError);
+    CHECK_THOW(make_static_command("my_command", {StaticArg{ArgType::OPTIONAL}}), ParseArgsError);
+    CHECK_THOW(make_static_command("my_command", {StaticArg{ArgType::FLAG, "verbose", ' ', "1"}}), ParseArgsError);
+    CHECK_THOW(make_static_command("my_command",
+                                   {StaticArg{ArgType::OPTIONAL, "name", 'n'}, StaticArg{ArgType::FLAG, "name"}}),
+               ParseArgsError);
+    CHECK_THOW(make_static_command("my_command",
+                                   {StaticArg{ArgType::OPTIONAL, "name", 'n'}, StaticArg{ArgType::FLAG, "node", 'n'}}),
+               ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_schema_blob)
+{
+    auto sub = Command::new_command("sub");
+    sub->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("level")->short_name('l'))
+        ->arg(Arg::new_arg(ArgType::POSITION));
+    auto cmd = Command::new_command("my_command")->usage("the usage xxx");
+    cmd->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("batch_size")->short_name('b')->default_values({"32", "64"}))
+        ->arg(Arg::new_arg(ArgType::FLAG)->long_name("verbose")->short_name('v'))
+        ->arg(Arg::new_arg(ArgType::FLAG)->short_name('x'))
+        ->arg(Arg::new_arg(ArgType::FLAG)->long_name("version")->conflicts_with_all())
+        ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("user"))
+        ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("password"))
+        ->related_group({"user", "password"})
+        ->conflict_group({"v", "x"})
+        ->subcommand(sub);
+    std::string data = cmd->serialize_schema();
+
+    // 二进制描述中不包含任何指针，复制到另一块内存中也可以使用
+    std::vector<uint32_t> copy(data.size() / sizeof(uint32_t) + 1);
+    memcpy(copy.data(), data.data(), data.size());
+    SchemaBlob blob = SchemaBlob::from_memory(copy.data(), data.size());
+
+    BlobParseResult result = blob.parse({"my_command", "-b", "1", "--batch_size=2", "-v", "sub", "-l3", "in.txt"});
+    CHECK_ARRAY_EQ(result.get_many_values<int>("batch_size"), (std::vector<int>{1, 2}));
+    CHECK_EQ(result.has_arg('v'), true);
+    CHECK_EQ(result.has_arg("verbose"_arg), true);
+    CHECK_EQ(result.get_one_value<int>('x'), 0);
+    CHECK_EQ(result.command_name_sv(), "my_command");
+    CHECK_EQ(result.get_subcommand().command_name_sv(), "sub");
+    CHECK_EQ(result.get_subcommand().get_one_value<int>("level"), 3);
+    CHECK_EQ(result.get_subcommand().get_one_position_value<std::string>(0), "in.txt");
+
+    blob.parse({"my_command", "--user", "a", "--password", "b", "sub", "--level", "1", "out.txt"}, result);
+    CHECK_ARRAY_EQ(result.get_many_values<int>('b'), (std::vector<int>{32, 64}));
+    CHECK_EQ(result.get_one_value<std::string>("user"), "a");
+    CHECK_EQ(result.has_arg("verbose"), false);
+    CHECK_THOW(result.get_one_value<int>("unknown"), ParseArgsError);
+    CHECK_THOW(result.get_one_value<int>("ver"), ParseArgsError);
+
+    // 与 `Command` 相同的校验
+    CHECK_THOW(blob.parse({"my_command", "-v", "-x", "sub", "-l", "1", "out.txt"}), ParseArgsError);
+    CHECK_THOW(blob.parse({"my_command", "--user", "a", "sub", "-l", "1", "out.txt"}), ParseArgsError);
+    CHECK_THOW(blob.parse({"my_command", "--version", "-v", "sub", "-l", "1", "out.txt"}), ParseArgsError);
+    CHECK_THOW(blob.parse({"my_command", "sub", "out.txt"}), ParseArgsError);
+    CHECK_THOW(blob.parse({"my_command", "sub", "-l", "1"}), ParseArgsError);
+    CHECK_THOW(blob.parse({"my_command", "-v"}), ParseArgsError);
+    CHECK_THOW(blob.parse({"my_command", "--verbose=1", "sub", "-l", "1", "out.txt"}), ParseArgsError);
+
+    // 通过 `mmap` 加载
+    std::string path = "/tmp/test_schema_blob_" + std::to_string(getpid()) + ".bin";
+    FILE *file = fopen(path.c_str(), "wb");
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+    SchemaBlob mapped = SchemaBlob::load(path.c_str());
+    remove(path.c_str());
+    CHECK_EQ(mapped.size(), data.size());
+    CHECK_EQ(mapped.parse({"my_command", "--version", "sub", "-l", "1", "out.txt"}).has_arg("version"), true);
+    CHECK_THOW(SchemaBlob::load(path.c_str()), ParseArgsError);
+
+    // 不合法的描述
+    copy[0] = 0;
+    CHECK_THOW(SchemaBlob::from_memory(copy.data(), data.size()), ParseArgsError);
+    CHECK_THOW(SchemaBlob::from_memory(data.data(), 4), ParseArgsError);
+
+    // 命令记录中的偏移、个数不合法：头部有 7 个字，之后是每个 16 个字的命令记录、每个 6 个字的参数记录、`uint32_t` 数组
+    memcpy(copy.data(), data.data(), data.size());
+    auto load_corrupted = [&copy, &data](size_t word_index, uint32_t value) {
+        std::vector<uint32_t> corrupted(copy);
+        corrupted[word_index] = value;
+        return SchemaBlob::from_memory(corrupted.data(), data.size());
+    };
+    const size_t root = 7;
+    const size_t words = 7 + copy[3] * 16 + copy[4] * 6;
+    CHECK_NO_THOW(load_corrupted(root, copy[root]));
+    CHECK_THOW(load_corrupted(root + 2, 1000), ParseArgsError);               // arg_begin
+    CHECK_THOW(load_corrupted(root + 6, 0), ParseArgsError);                  // long_slot_count
+    CHECK_THOW(load_corrupted(root + 6, 3), ParseArgsError);                  // long_slot_count
+    CHECK_THOW(load_corrupted(root + 8, 1000), ParseArgsError);               // short_count
+    CHECK_THOW(load_corrupted(root + 11, 2), ParseArgsError);                 // mask_words
+    CHECK_THOW(load_corrupted(root + 15, 1000), ParseArgsError);              // group_count
+    CHECK_THOW(load_corrupted(words + copy[root + 9] + 1, 9), ParseArgsError);  // 子命令下标
+    // 长名字哈希表没有空槽位
+    std::vector<uint32_t> full_slots(copy);
+    for (uint32_t i = 0; i < copy[root + 6]; i++) {
+        full_slots[words + copy[root + 5] + i] = 0;
+    }
+    CHECK_THOW(SchemaBlob::from_memory(full_slots.data(), data.size()), ParseArgsError);
+
+    CHECK_THOW(Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("mode")->choices({"a", "b"}))
+                   ->serialize_schema(),
+               ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_schema_arena)
+{
+    SchemaArena arena;
+    CommandRef cmd = arena.new_command("my_command");
+    ArgHandle<int> batch_size =
+        cmd.add_arg<int>(arena.new_arg(ArgType::OPTIONAL).long_name("batch_size").short_name('b').default_value("32"));
+    cmd.arg(arena.new_arg(ArgType::OPTIONAL).long_name("level").range(1, 10))
+        .arg(arena.new_arg(ArgType::OPTIONAL).long_name("mode").choices({{"fast", 0}, {"safe", 1}}))
+        .arg(arena.new_arg(ArgType::FLAG).long_name("verbose").short_name('v'))
+        .arg(arena.new_arg(ArgType::FLAG).long_name("quiet").short_name('q'))
+        .arg(arena.new_arg(ArgType::POSITION))
+        .conflict_group({"verbose", "quiet"});
+    CommandRef sub = arena.new_command("sub");
+    sub.arg(arena.new_arg(ArgType::REQUIRED).long_name("file"));
+    cmd.subcommand(sub).compile();
+    CHECK_EQ(cmd.get().is_compiled(), true);
+    CHECK_EQ(sub.get().is_compiled(), true);
+
+    // 与通过 `shared_ptr` 构造的命令解析结果一致
+    ParseResult result = cmd.get().parse(
+        {"my_command", "-b", "64", "--level", "3", "--mode", "safe", "-v", "pos", "sub", "--file", "a"});
+    CHECK_EQ(result.get_one_value(batch_size), 64);
+    CHECK_EQ(result.get_one_value<int>("level"), 3);
+    CHECK_EQ(result.get_choice_id("mode"), 1);
+    CHECK_EQ(result.has_arg('v'), true);
+    CHECK_EQ(result.get_one_position_value<std::string>(0), "pos");
+    CHECK_EQ(result.get_subcommand().command_name(), "sub");
+    CHECK_EQ(result.get_subcommand().get_one_value<std::string>("file"), "a");
+
+    // 参数的校验规则同样生效
+    CHECK_THOW(cmd.get().parse({"my_command", "--level", "11", "sub", "--file", "a"}), ParseArgsError);
+    CHECK_THOW(cmd.get().parse({"my_command", "-v", "-q", "sub", "--file", "a"}), ParseArgsError);
+    CHECK_THOW(cmd.get().parse({"my_command", "sub"}), ParseArgsError);
+
+    // 重复的名字报错，编译后不能再修改命令
+    CHECK_THOW(cmd.arg(arena.new_arg(ArgType::FLAG).long_name("verbose")), ParseArgsError);
+    CommandRef other = arena.new_command("other");
+    other.arg(arena.new_arg(ArgType::FLAG).long_name("verbose"));
+    CHECK_THOW(other.arg(arena.new_arg(ArgType::FLAG).long_name("verbose")), ParseArgsError);
+}
+
+// 统计分配和释放次数的内存资源
+class CountingResource : public std::pmr::memory_resource {
+   public:
+    size_t allocations = 0;
+    size_t deallocations = 0;
+
+   private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        deallocations++;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+ADD_UNIT_TEST_CASE(argparse, test_parse_memory_resource)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("file")->short_name('f'))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("level")->default_value("3"))
+                   ->arg(Arg::new_arg(ArgType::POSITION))
+                   ->subcommand(Command::new_command("sub")->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("target")));
+    std::vector<const char *> args{"my_command", "-f", "a", "--file", "b", "pos", "sub", "--target", "all"};
+
+    // 解析结果的所有存储都从给定的内存资源分配，析构时全部归还
+    CountingResource counting;
+    {
+        ParseResult result = cmd->parse(args, &counting);
+        CHECK_EQ(counting.allocations > 0, true);
+        CHECK_ARRAY_EQ(result.get_many_values<std::string>("file"), (std::vector<std::string>{"a", "b"}));
+        CHECK_EQ(result.get_one_value<int>("level"), 3);
+        CHECK_EQ(result.get_one_position_value<std::string>(0), "pos");
+        CHECK_EQ(result.get_subcommand().get_one_value<std::string>("target"), "all");
+
+        // 复用解析结果时继续使用构造时的内存资源
+        cmd->parse({"my_command", "-f", "c", "pos", "sub", "--target", "x"}, result);
+        CHECK_EQ(result.get_one_value<std::string>('f'), "c");
+        CHECK_EQ(result.get_subcommand().get_one_value<std::string>("target"), "x");
+
+        // 取出的数组也可以从给定的内存资源分配
+        size_t allocations = counting.allocations;
+        std::pmr::vector<std::string_view> files = result.get_many_values<std::string_view>('f', &counting);
+        CHECK_EQ(files.size(), 1);
+        CHECK_EQ(files[0], "c");
+        CHECK_EQ(counting.allocations, allocations + 1);
+    }
+    CHECK_EQ(counting.deallocations, counting.allocations);
+
+    // 上游为 `null_memory_resource` 的栈上缓冲区：只要缓冲区足够大，解析就完全不使用堆
+    alignas(std::max_align_t) unsigned char buffer[8192];
+    std::pmr::monotonic_buffer_resource monotonic(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    ParseResult result(&monotonic);
+    for (int i = 0; i < 3; i++) {
+        cmd->parse(args, result);
+        CHECK_EQ(result.get_one_value<std::string>("file"), "a");
+    }
+
+    // 解析出错时照常报错
+    CHECK_THOW(cmd->parse({"my_command", "sub"}, &counting), ParseArgsError);
+    CHECK_EQ(counting.deallocations, counting.allocations);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_try_parse)
+{
+    auto level = Arg::new_arg(ArgType::OPTIONAL)->long_name("level")->short_name('l')->range(1, 3);
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("verbose")->short_name('v'))
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("version"))
+                   ->arg(level)
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("mode")->choices({"fast", "slow"}))
+                   ->arg(Arg::new_arg(ArgType::POSITION)->range(0, 9))
+                   ->subcommand(Command::new_command("sub")->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("target")))
+                   ->compile();
+    ParseResult result;
+
+    ParseError error = cmd->try_parse({"my_command", "-v", "--level", "2", "5", "sub", "--target", "x"}, result);
+    CHECK_EQ(error.ok(), true);
+    CHECK_EQ(error.message(), "");
+    CHECK_EQ(result.get_one_value<int>("level"), 2);
+    CHECK_EQ(result.get_subcommand().get_one_value<std::string>("target"), "x");
+
+    // 错误记录中的信息与 `parse` 抛出的错误信息一致
+    auto parse_message = [&](const std::vector<const char *> &args) {
+        try {
+            cmd->parse(args, result);
+        } catch (const ParseArgsError &e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    struct Case {
+        std::vector<const char *> args;
+        ParseErrorCode code;
+        int32_t argv_index;
+    };
+    std::vector<Case> cases{
+        {{"my_command", "--unknown", "5", "sub"}, ParseErrorCode::UNRECOGNIZED_OPTION, 1},
+        {{"my_command", "--ver", "5", "sub"}, ParseErrorCode::AMBIGUOUS_OPTION, 1},
+        {{"my_command", "-vx", "5", "sub"}, ParseErrorCode::INVALID_OPTION, 1},
+        {{"my_command", "--verbose=1", "5", "sub"}, ParseErrorCode::UNEXPECTED_VALUE, 1},
+        {{"my_command", "5", "--level"}, ParseErrorCode::MISSING_VALUE, 2},
+        {{"my_command", "5", "-l"}, ParseErrorCode::MISSING_VALUE, 2},
+        {{"my_command", "-l", "abc", "5", "sub"}, ParseErrorCode::INVALID_NUMBER, 2},
+        {{"my_command", "-l", "4", "5", "sub"}, ParseErrorCode::OUT_OF_RANGE, 2},
+        {{"my_command", "--mode", "medium", "5", "sub"}, ParseErrorCode::INVALID_CHOICE, 2},
+        {{"my_command", "-v", "10", "sub"}, ParseErrorCode::OUT_OF_RANGE, 2},
+        {{"my_command", "-v", "sub"}, ParseErrorCode::MISSING_POSITION_ARGUMENT, -1},
+        {{"my_command", "5"}, ParseErrorCode::MISSING_SUBCOMMAND, -1},
+        {{"my_command", "5", "sub"}, ParseErrorCode::MISSING_REQUIRED_OPTION, -1},
+        {{"my_command", "5", "sub", "--target"}, ParseErrorCode::MISSING_VALUE, 3},
+    };
+    for (const Case &c : cases) {
+        error = cmd->try_parse(c.args, result);
+        CHECK_EQ(error.code == c.code, true);
+        CHECK_EQ(error.argv_index, c.argv_index);
+        CHECK_EQ(error.message(), parse_message(c.args));
+    }
+
+    // 错误记录中包含出错的参数、命令和文本
+    error = cmd->try_parse({"my_command", "-l", "4", "5", "sub"}, result);
+    CHECK_EQ(error.is_arg(*level), true);
+    CHECK_EQ(error.text, "4");
+    CHECK_EQ(error.command, cmd.get());
+    error = cmd->try_parse({"my_command", "5", "sub"}, result);
+    CHECK_EQ(error.command->command_name(), "sub");
+
+    // 传递了 `--help` 时只返回 `HELP`，不输出帮助信息
+    error = cmd->try_parse({"my_command", "--help"}, result);
+    CHECK_EQ(error.code == ParseErrorCode::HELP, true);
+    CHECK_EQ(error.message(), "");
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_try_parse_all)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("input")->short_name('i'))
+                   ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("output"))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("level")->short_name('l')->range(1, 3))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("mode")->choices({"fast", "slow"}))
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("quiet")->short_name('q'))
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("verbose")->short_name('v'))
+                   ->conflict_group({"quiet", "verbose"})
+                   ->subcommand(Command::new_command("sub")->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("target")))
+                   ->compile();
+    ParseResult result;
+    ParseErrorList errors;
+
+    CHECK_EQ(cmd->try_parse_all({"my_command", "-i", "a", "--output", "b", "sub", "--target", "x"}, result, errors),
+             true);
+    CHECK_EQ(errors.empty(), true);
+    CHECK_EQ(result.get_one_value<std::string>("input"), "a");
+
+    // 一次解析报告所有的错误，按出现的顺序排列
+    std::vector<const char *> args{"my_command", "--unknown", "-l", "9", "-qxv", "--mode=medium", "sub"};
+    CHECK_EQ(cmd->try_parse_all(args, result, errors), false);
+    std::vector<ParseErrorCode> codes;
+    std::vector<int32_t> indexes;
+    for (const ParseError &error : errors) {
+        codes.push_back(error.code);
+        indexes.push_back(error.argv_index);
+    }
+    CHECK_EQ(codes == (std::vector<ParseErrorCode>{ParseErrorCode::UNRECOGNIZED_OPTION, ParseErrorCode::OUT_OF_RANGE,
+                                                   ParseErrorCode::INVALID_OPTION, ParseErrorCode::INVALID_CHOICE,
+                                                   ParseErrorCode::MISSING_REQUIRED_OPTION,
+                                                   ParseErrorCode::MISSING_REQUIRED_OPTION,
+                                                   ParseErrorCode::CONFLICT_GROUP,
+                                                   ParseErrorCode::MISSING_REQUIRED_OPTION}),
+             true);
+    CHECK_ARRAY_EQ(indexes, (std::vector<int32_t>{1, 3, 4, 5, -1, -1, -1, -1}));
+    CHECK_EQ(errors.truncated(), false);
+    CHECK_EQ(errors[7].command->command_name(), "sub");
+    CHECK_EQ(errors[0].message(), "my_command: Unrecognized option '--unknown'.");
+    CHECK_EQ(errors.message(),
+             "my_command: Unrecognized option '--unknown'.\n"
+             "The value of option --level is not in the range of [1, 3].\n"
+             "my_command: Invalid option -- 'x'.\n"
+             "The value of option --mode is not within [fast, slow].\n"
+             "my_command: Missing required option: --input.\n"
+             "my_command: Missing required option: --output.\n"
+             "my_command: The conflict relationship is not satisfied. [--quiet, --verbose]: is conflict with each "
+             "other.\n"
+             "sub: Missing required option: --target.");
+
+    // 第一个错误与 `try_parse` 相同
+    CHECK_EQ(errors[0].message(), cmd->try_parse(args, result).message());
+
+    // 错误超出容量时停止解析
+    ParseErrorList small_errors(2);
+    CHECK_EQ(cmd->try_parse_all(args, result, small_errors), false);
+    CHECK_EQ(small_errors.size(), 2);
+    CHECK_EQ(small_errors.truncated(), true);
+
+    // 传递了 `--help` 时停止解析
+    CHECK_EQ(cmd->try_parse_all({"my_command", "--unknown", "--help", "--bad"}, result, errors), false);
+    CHECK_EQ(errors.size(), 2);
+    CHECK_EQ(errors[1].code == ParseErrorCode::HELP, true);
+    CHECK_EQ(errors.message(), "my_command: Unrecognized option '--unknown'.");
+}
+
 ADD_UNIT_TEST_CASE(argparse, test_subcommand)
 {
     auto cmd = Command::new_command("my_command")
@@ -692,3 +1467,767 @@ ADD_UNIT_TEST_CASE(argparse, test_subcommand)
         // TODO 你自己的业务逻辑
     }
 }
+
+ADD_UNIT_TEST_CASE(argparse, test_long_name_arg_with_equal_sign)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("reqarg"))
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("flag_arg"));
+
+    cmd->parse_args({"my_command", "--reqarg=1"});
+    CHECK_EQ(cmd->get_one_value<int>("reqarg"), 1);
+
+    cmd->parse_args({"my_command", "-reqarg=a=b"});
+    CHECK_EQ(cmd->get_one_value<std::string_view>("reqarg"), "a=b");
+
+    cmd->parse_args({"my_command", "--reqarg="});
+    CHECK_EQ(cmd->get_one_value<std::string_view>("reqarg"), "");
+
+    CHECK_THOW(cmd->parse_args({"my_command", "--reqarg", "1", "--flag_arg=1"}), ParseArgsError);
+    CHECK_THOW(cmd->parse_args({"my_command", "--reqarg", "1", "--unknown"}), ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_short_name_cluster)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::FLAG)->short_name('a'))
+                   ->arg(Arg::new_arg(ArgType::FLAG)->short_name('b'))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->short_name('o'));
+
+    cmd->parse_args({"my_command", "-ab"});
+    CHECK_EQ(cmd->has_arg('a'), true);
+    CHECK_EQ(cmd->has_arg('b'), true);
+    CHECK_EQ(cmd->has_arg('o'), false);
+
+    cmd->parse_args({"my_command", "-bo10"});
+    CHECK_EQ(cmd->has_arg('a'), false);
+    CHECK_EQ(cmd->has_arg('b'), true);
+    CHECK_EQ(cmd->get_one_value<int>('o'), 10);
+
+    cmd->parse_args({"my_command", "-ao", "-5"});
+    CHECK_EQ(cmd->get_one_value<int>('o'), -5);
+
+    CHECK_THOW(cmd->parse_args({"my_command", "-ax"}), ParseArgsError);
+    CHECK_THOW(cmd->parse_args({"my_command", "-ao"}), ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_long_name_abbreviation)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("verbose"))
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("version"))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("output"));
+
+    cmd->parse_args({"my_command", "--verb", "--out", "a.txt"});
+    CHECK_EQ(cmd->has_arg("verbose"), true);
+    CHECK_EQ(cmd->has_arg("version"), false);
+    CHECK_EQ(cmd->get_one_value<std::string_view>("output"), "a.txt");
+
+    cmd->parse_args({"my_command", "-vers", "-o=b.txt"});
+    CHECK_EQ(cmd->has_arg("verbose"), false);
+    CHECK_EQ(cmd->has_arg("version"), true);
+    CHECK_EQ(cmd->get_one_value<std::string_view>("output"), "b.txt");
+
+    CHECK_THOW(cmd->parse_args({"my_command", "--ver"}), ParseArgsError);
+    std::string error;
+    try {
+        cmd->parse_args({"my_command", "--ver"});
+    } catch (const ParseArgsError &e) {
+        error = e.what();
+    }
+    CHECK_EQ(error, "my_command: Option 'ver' is ambiguous; possibilities: '--verbose' '--version'");
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_position_arg_mixed_with_options)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("flag_arg"))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->short_name('o'))
+                   ->arg(Arg::new_arg(ArgType::POSITION));
+
+    std::vector<const char *> args{"my_command", "1", "--flag_arg", "2", "-o", "3", "--", "-4", "--flag_arg"};
+    const std::vector<const char *> args_copy = args;
+    cmd->parse_args(std::move(args));
+    CHECK_EQ(cmd->has_arg("flag_arg"), true);
+    CHECK_EQ(cmd->get_one_value<int>('o'), 3);
+    CHECK_ARRAY_EQ(cmd->get_all_position_values<std::string_view>(),
+                   (std::vector<std::string_view>{"1", "2", "-4", "--flag_arg"}));
+
+    // 与 GNU `getopt` 不同，解析过程不会重排调用者传入的 `argv`
+    char arg0[] = "my_command", arg1[] = "1", arg2[] = "--flag_arg", arg3[] = "2";
+    char *argv[] = {arg0, arg1, arg2, arg3};
+    cmd->parse_args(4, argv);
+    CHECK_EQ(std::string_view(argv[1]), "1");
+    CHECK_EQ(std::string_view(argv[2]), "--flag_arg");
+    CHECK_EQ(std::string_view(argv[3]), "2");
+    CHECK_ARRAY_EQ(cmd->get_all_position_values<int>(), (std::vector<int>{1, 2}));
+    CHECK_EQ(args_copy.size(), 9u);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_parse_result)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("flag_arg"))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->short_name('o')->default_value("100"))
+                   ->subcommand(Command::new_command("mygrep")
+                                    ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("pattern")));
+
+    // 两次解析的结果互相独立，后一次解析不会影响前一次的结果
+    ParseResult result1 = cmd->parse({"my_command", "--flag_arg", "-o", "1", "mygrep", "--pattern", "xx", "f1"});
+    ParseResult result2 = cmd->parse({"my_command", "mygrep", "--pattern", "yy"});
+
+    CHECK_EQ(result1.has_arg("flag_arg"), true);
+    CHECK_EQ(result1.get_one_value<int>('o'), 1);
+    CHECK_EQ(result1.get_subcommand().command_name_sv(), "mygrep");
+    CHECK_EQ(result1.get_subcommand().get_one_value<std::string_view>("pattern"), "xx");
+    CHECK_EQ(result1.get_subcommand().get_one_position_value<std::string_view>(0), "f1");
+
+    CHECK_EQ(result2.has_arg("flag_arg"), false);
+    CHECK_EQ(result2.get_one_value<int>("flag_arg"), 0);
+    CHECK_EQ(result2.get_one_value<int>('o'), 100);
+    CHECK_EQ(result2.get_subcommand().get_one_value<std::string_view>("pattern"), "yy");
+    CHECK_ARRAY_EQ(result2.get_subcommand().get_all_position_values<int>(), std::vector<int>{});
+
+    CHECK_THOW(result2.get_subcommand().get_subcommand(), ParseArgsError);
+    CHECK_THOW(result2.get_one_value<int>("unknown"), ParseArgsError);
+    CHECK_THOW(cmd->parse({"my_command", "mygrep"}), ParseArgsError);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_concurrent_parse)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("id")->range(NumType::INT, "0", "1000000"))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->short_name('n'))
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("odd"));
+
+    // 多个线程共享同一个命令同时进行解析，每个线程使用自己的解析结果
+    constexpr int thread_count = 4;
+    constexpr int loop_count = 2000;
+    std::vector<int> failure_counts(thread_count, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&cmd, &failure_counts, t]() {
+            for (int i = 0; i < loop_count; i++) {
+                std::string id = std::to_string(t * loop_count + i);
+                std::string n = std::to_string(i);
+                std::vector<const char *> args{"my_command", "--id", id.c_str(), "-n", n.c_str()};
+                if (i % 2 == 1) {
+                    args.push_back("--odd");
+                }
+                ParseResult result = cmd->parse(args);
+                if (result.get_one_value<int>("id") != t * loop_count + i || result.get_one_value<int>('n') != i ||
+                    result.has_arg("odd") != (i % 2 == 1)) {
+                    failure_counts[t]++;
+                }
+                try {
+                    cmd->parse({"my_command", "--id", "-1"});
+                    failure_counts[t]++;
+                } catch (const ParseArgsError &e) {
+                    if (std::string_view(e.what()).find("--id") == std::string_view::npos) {
+                        failure_counts[t]++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    CHECK_ARRAY_EQ(failure_counts, std::vector<int>(thread_count, 0));
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_batch_parser)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("id")->range(NumType::INT, "0", "1000000"))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->short_name('n'))
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("odd"));
+
+    // 每隔几个参数列表构造一个非法的参数列表
+    constexpr int count = 3000;
+    std::vector<std::string> storage;
+    storage.reserve(count * 2);
+    std::vector<std::vector<const char *>> argvs;
+    for (int i = 0; i < count; i++) {
+        storage.push_back(std::to_string(i % 7 == 0 ? -i : i));
+        storage.push_back(std::to_string(i * 2));
+        argvs.push_back({"my_command", "--id", storage[i * 2].c_str(), "-n", storage[i * 2 + 1].c_str()});
+        if (i % 2 == 1) {
+            argvs.back().push_back("--odd");
+        }
+        if (i % 11 == 0) {
+            argvs.back().push_back("--unknown");
+        }
+    }
+
+    // 与逐个顺序解析的结果完全相同，多次批量解析时复用解析结果
+    for (size_t thread_count : {1, 4}) {
+        BatchParser parser(*cmd, thread_count);
+        CHECK_EQ(parser.thread_count(), thread_count);
+        for (int round = 0; round < 2; round++) {
+            size_t ok_count = parser.parse(argvs);
+            CHECK_EQ(parser.size(), count);
+            size_t expected_ok_count = 0;
+            int failure_count = 0;
+            ParseResult expected;
+            for (int i = 0; i < count; i++) {
+                ParseError error = cmd->try_parse(argvs[i], expected);
+                if (error.code != parser.error(i).code || error.argv_index != parser.error(i).argv_index ||
+                    error.message() != parser.error(i).message()) {
+                    failure_count++;
+                }
+                if (!error.ok()) {
+                    continue;
+                }
+                expected_ok_count++;
+                const ParseResult &result = parser.result(i);
+                if (result.get_one_value<int>("id") != i || result.get_one_value<int>('n') != i * 2 ||
+                    result.has_arg("odd") != (i % 2 == 1)) {
+                    failure_count++;
+                }
+            }
+            CHECK_EQ(ok_count, expected_ok_count);
+            CHECK_EQ(failure_count, 0);
+        }
+    }
+
+    // 批量大小小于线程数，以及空的批量
+    BatchParser parser(*cmd, 8);
+    CHECK_EQ(parser.parse(argvs.data(), 3), 2);
+    CHECK_EQ(parser.size(), 3);
+    CHECK_EQ(parser.parse(argvs.data(), 0), 0);
+    CHECK_EQ(parser.size(), 0);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_parse_cache)
+{
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("id")->range(0, 100))
+                   ->arg(Arg::new_arg(ArgType::FLAG)->long_name("odd"))
+                   ->subcommand(Command::new_command("sub")->arg(Arg::new_arg(ArgType::POSITION)));
+
+    // 未开启缓存时每次都重新解析
+    auto first = cmd->cached_parse({"my_command", "--id", "1", "sub", "a"});
+    CHECK_EQ(first != cmd->cached_parse({"my_command", "--id", "1", "sub", "a"}), true);
+    CHECK_EQ(cmd->parse_cache_stats().capacity, 0);
+
+    // 内容相同的参数列表命中缓存，返回同一个解析结果，解析结果不指向调用者的 `argv`
+    cmd->enable_parse_cache(1);
+    std::string id = "7";
+    std::string position = "file";
+    first = cmd->cached_parse({"my_command", "--id", id.c_str(), "--odd", "sub", position.c_str()});
+    std::string same_id = "7";
+    auto second = cmd->cached_parse({"my_command", "--id", same_id.c_str(), "--odd", "sub", "file"});
+    CHECK_EQ(first == second, true);
+    id = "8";
+    position = "other";
+    CHECK_EQ(second->get_one_value<int>("id"), 7);
+    CHECK_EQ(second->has_arg("odd"), true);
+    CHECK_EQ(second->get_subcommand().get_one_position_value<std::string>(0), "file");
+    ParseCacheStats stats = cmd->parse_cache_stats();
+    CHECK_EQ(stats.hits, 1);
+    CHECK_EQ(stats.misses, 1);
+    CHECK_EQ(stats.size, 1);
+    CHECK_EQ(stats.capacity, 1);
+
+    // 出错的参数列表不会被缓存
+    CHECK_THOW(cmd->cached_parse({"my_command", "--id", "101", "sub", "a"}), ParseArgsError);
+    CHECK_EQ(cmd->parse_cache_stats().size, 1);
+
+    // 超出容量时淘汰最久未使用的，被淘汰的解析结果仍然有效
+    auto third = cmd->cached_parse({"my_command", "--id", "9", "sub", "a"});
+    CHECK_EQ(cmd->parse_cache_stats().size, 1);
+    CHECK_EQ(first->get_one_value<int>("id"), 7);
+    CHECK_EQ(cmd->cached_parse({"my_command", "--id", "9", "sub", "a"}) == third, true);
+    CHECK_EQ(cmd->cached_parse({"my_command", "--id", "7", "--odd", "sub", "file"}) != first, true);
+
+    // 多个线程同时查找，容量足够时每个不同的参数列表最多在每个线程中各未命中一次
+    cmd->enable_parse_cache(1024);
+    constexpr int thread_count = 4;
+    constexpr int distinct_count = 32;
+    std::vector<int> failure_counts(thread_count, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&cmd, &failure_counts, t]() {
+            for (int i = 0; i < 1000; i++) {
+                std::string value = std::to_string(i % distinct_count);
+                auto result = cmd->cached_parse({"my_command", "--id", value.c_str(), "sub", "a"});
+                if (result->get_one_value<int>("id") != i % distinct_count) {
+                    failure_counts[t]++;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    CHECK_ARRAY_EQ(failure_counts, std::vector<int>(thread_count, 0));
+    stats = cmd->parse_cache_stats();
+    CHECK_EQ(stats.hits + stats.misses, thread_count * 1000);
+    CHECK_EQ(stats.size, distinct_count);
+    CHECK_EQ(stats.misses >= distinct_count && stats.misses <= distinct_count * thread_count, true);
+}
+
+// 改写只有一个槽位的缓存文件中已有的槽位，用于模拟被没有密钥的程序篡改的缓存文件
+// 槽位头的布局与 `src/argparse.cpp` 中的 `CacheSlot` 相同。保留原有的键（没有密钥时无法计算），认证码随意填写，
+// 解析结果的编码替换为 `encoded`，`result_size` 不为 0 时在槽位头中使用它并且只写入槽位头
+void plant_cache_slot(const std::string &path, const std::vector<uint32_t> &encoded, uint32_t result_size = 0)
+{
+    struct {
+        uint64_t mac;
+        uint64_t key;
+        uint64_t fingerprint;
+        uint32_t argc;
+        uint32_t argv_size;
+        uint32_t result_size;
+        uint32_t reserved;
+    } slot{};
+    FILE *file = fopen(path.c_str(), "r+b");
+    fseek(file, 64, SEEK_SET);
+    std::string argv_data;
+    if (fread(&slot, sizeof(slot), 1, file) == 1) {
+        argv_data.resize(slot.argv_size);
+        fseek(file, 64 + static_cast<long>(sizeof(slot) + slot.result_size), SEEK_SET);
+        argv_data.resize(fread(&argv_data[0], 1, argv_data.size(), file));
+    }
+    slot.mac = 0x0123456789ABCDEFULL;
+    slot.result_size = result_size != 0 ? result_size : static_cast<uint32_t>(encoded.size() * sizeof(uint32_t));
+    fseek(file, 64, SEEK_SET);
+    fwrite(&slot, sizeof(slot), 1, file);
+    if (result_size == 0) {
+        fwrite(encoded.data(), sizeof(uint32_t), encoded.size(), file);
+        fwrite(argv_data.data(), 1, argv_data.size(), file);
+    }
+    fclose(file);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_persistent_parse_cache)
+{
+    auto new_command = [](int max_id) {
+        return Command::new_command("my_command")
+            ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("id")->range(0, max_id))
+            ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("level")->choices({{"low", 10}, {"high", 20}}))
+            ->arg(Arg::new_arg(ArgType::FLAG)->short_name('v'))
+            ->subcommand(Command::new_command("sub")->arg(Arg::new_arg(ArgType::POSITION)));
+    };
+    std::string path = "/tmp/test_argparse_cache_" + std::to_string(getpid());
+    std::string key_path = path + ".key";
+    unlink(path.c_str());
+    unlink(key_path.c_str());
+    auto cmd = new_command(100);
+
+    // 第一次解析未命中并写入文件，之后（例如另一个进程）打开同一个文件时命中，解析结果指向调用者的 `argv`
+    std::string id = "7";
+    std::vector<const char *> args{"my_command", "--id", id.c_str(), "--level=high", "-v", "sub", "a.txt"};
+    {
+        PersistentParseCache cache(path.c_str(), 16);
+        CHECK_EQ(cache.is_open(), true);
+        ParseResult result = cache.parse(*cmd, args);
+        CHECK_EQ(result.get_one_value<int>("id"), 7);
+        CHECK_EQ(cache.stats().misses, 1);
+        CHECK_EQ(cache.stats().size, 1);
+        CHECK_EQ(cache.stats().capacity, 16);
+    }
+    {
+        PersistentParseCache cache(path.c_str());
+        CHECK_EQ(cache.stats().capacity, 16);
+        ParseResult result = cache.parse(*cmd, args);
+        CHECK_EQ(cache.stats().hits, 1);
+        CHECK_EQ(result.get_one_value<int>("id"), 7);
+        CHECK_EQ(result.get_one_value<std::string>("id"), "7");
+        CHECK_EQ(result.get_one_value<std::string_view>("id").data() == id.c_str(), true);
+        CHECK_EQ(result.get_choice_id("level"), 20);
+        CHECK_EQ(result.get_one_value<std::string>("level"), "high");
+        CHECK_EQ(result.has_arg('v'), true);
+        CHECK_EQ(result.get_one_value<int>('v'), 1);
+        CHECK_EQ(result.get_subcommand().get_one_position_value<std::string>(0), "a.txt");
+
+        // 命中时与直接解析的结果相同
+        ParseResult expected = cmd->parse(args);
+        CHECK_EQ(result.has_arg("level") && expected.has_arg("level"), true);
+        CHECK_EQ(result.get_subcommand().command_name(), expected.get_subcommand().command_name());
+
+        // 不同的参数列表未命中
+        result = cache.parse(*cmd, {"my_command", "--id", "8", "sub", "b.txt"});
+        CHECK_EQ(result.get_one_value<int>("id"), 8);
+        CHECK_EQ(result.has_arg('v'), false);
+        CHECK_EQ(cache.stats().misses, 1);
+
+        // 出错的参数列表不会写入缓存
+        CHECK_THOW(cache.parse(*cmd, {"my_command", "--id", "101", "sub", "a"}), ParseArgsError);
+        CHECK_THOW(cache.parse(*cmd, {"my_command", "--id", "101", "sub", "a"}), ParseArgsError);
+        CHECK_EQ(cache.stats().hits, 1);
+        CHECK_EQ(cache.stats().misses, 3);
+
+        // 命令描述改变后缓存的解析结果失效
+        auto changed = new_command(5);
+        CHECK_EQ(changed->schema_fingerprint() != cmd->schema_fingerprint(), true);
+        CHECK_EQ(new_command(100)->schema_fingerprint(), cmd->schema_fingerprint());
+        CHECK_THOW(cache.parse(*changed, args), ParseArgsError);
+        CHECK_EQ(cache.stats().hits, 1);
+    }
+
+    // 文件不是缓存文件时不使用缓存，仍然可以正常解析
+    FILE *file = fopen(path.c_str(), "w");
+    fputs("not a cache file", file);
+    fclose(file);
+    {
+        PersistentParseCache cache(path.c_str());
+        CHECK_EQ(cache.is_open(), false);
+        CHECK_EQ(cache.parse(*cmd, args).get_one_value<int>("id"), 7);
+        CHECK_EQ(cache.stats().capacity, 0);
+    }
+    PersistentParseCache missing_directory("/nonexistent_directory/cache");
+    CHECK_EQ(missing_directory.is_open(), false);
+    unlink(path.c_str());
+
+    // 其它用户可写的文件和符号链接都不使用
+    { PersistentParseCache cache(path.c_str(), 1); }
+    chmod(path.c_str(), 0666);
+    CHECK_EQ(PersistentParseCache(path.c_str()).is_open(), false);
+    chmod(path.c_str(), 0600);
+    std::string link = path + ".link";
+    CHECK_EQ(symlink(path.c_str(), link.c_str()), 0);
+    CHECK_EQ(PersistentParseCache(link.c_str()).is_open(), false);
+    unlink(link.c_str());
+
+    // 篡改的槽位：认证码不匹配时按未命中处理并照常解析
+    // 参数的下标：0 为帮助参数，1 为 `--id`，2 为位置参数
+    auto tool = Command::new_command("tool")
+                    ->arg(Arg::new_arg(ArgType::REQUIRED)->long_name("id")->range(0, 100))
+                    ->arg(Arg::new_arg(ArgType::POSITION));
+    std::vector<const char *> tool_args{"tool", "--id", "7", "500"};
+    unlink(path.c_str());
+    unlink(key_path.c_str());
+    {
+        PersistentParseCache cache(path.c_str(), 1);
+        cache.parse(*tool, tool_args);
+        CHECK_EQ(cache.parse(*tool, tool_args).get_one_value<int>("id"), 7);
+        CHECK_EQ(cache.stats().hits, 1);
+    }
+    // 把 `--id` 缓存的数值改为 500：位于槽位头（40 字节）以及编码中 `--id` 的数值之前的 8 个 `uint32_t` 之后
+    const long bits_offset = 64 + 40 + 8 * 4;
+    uint64_t bits = 0;
+    file = fopen(path.c_str(), "r+b");
+    fseek(file, bits_offset, SEEK_SET);
+    CHECK_EQ(fread(&bits, sizeof(bits), 1, file), 1);
+    CHECK_EQ(bits, 7);
+    bits = 500;
+    fseek(file, bits_offset, SEEK_SET);
+    fwrite(&bits, sizeof(bits), 1, file);
+    fclose(file);
+    {
+        PersistentParseCache cache(path.c_str());
+        CHECK_EQ(cache.parse(*tool, tool_args).get_one_value<int>("id"), 7);
+        CHECK_EQ(cache.stats().hits, 0);
+        CHECK_EQ(cache.parse(*tool, tool_args).get_one_value<int>("id"), 7);
+        CHECK_EQ(cache.stats().hits, 1);
+    }
+    // 没有密钥时伪造的槽位不会命中，即使编码本身是合法的：`--id` 和位置参数的值都是 "500"
+    // 每个值依次为下标、偏移、`kinds`（整数和浮点数）、整数、浮点数（500.0）
+    {
+        PersistentParseCache cache(path.c_str());
+        plant_cache_slot(path, {3, UINT32_MAX, 2, 0x80000001, 1, 3, 0, 7, 500, 0, 0, 0x407F4000, 2, 1, 3, 0, 7, 500,
+                                0, 0, 0x407F4000, 1, 3, 0});
+        CHECK_EQ(cache.parse(*tool, tool_args).get_one_value<int>("id"), 7);
+        CHECK_EQ(cache.stats().hits, 0);
+    }
+    // 密钥文件被删除后重新生成密钥，之前写入的槽位都不再命中
+    unlink(key_path.c_str());
+    {
+        PersistentParseCache cache(path.c_str());
+        CHECK_EQ(cache.parse(*tool, tool_args).get_one_value<int>("id"), 7);
+        CHECK_EQ(cache.stats().hits, 0);
+        CHECK_EQ(cache.parse(*tool, tool_args).get_one_value<int>("id"), 7);
+        CHECK_EQ(cache.stats().hits, 1);
+    }
+    // 密钥文件大小不对或者其它用户可写时不使用缓存
+    chmod(key_path.c_str(), 0666);
+    CHECK_EQ(PersistentParseCache(path.c_str()).is_open(), false);
+    chmod(key_path.c_str(), 0600);
+    CHECK_EQ(truncate(key_path.c_str(), 8), 0);
+    CHECK_EQ(PersistentParseCache(path.c_str()).is_open(), false);
+    unlink(key_path.c_str());
+
+    // 参数列表本身超出槽位大小时不使用缓存；槽位头中解析结果的大小超出槽位时不会越界复制
+    std::string long_value(5000, 'x');
+    std::vector<const char *> long_args{"tool", "--id", "7", long_value.c_str()};
+    {
+        PersistentParseCache cache(path.c_str());
+        ParseResult result = cache.parse(*tool, long_args);
+        CHECK_EQ(result.get_one_position_value<std::string>(0), long_value);
+        CHECK_EQ(cache.stats().hits + cache.stats().misses, 0);
+    }
+    {
+        PersistentParseCache cache(path.c_str());
+        cache.parse(*tool, tool_args);
+        plant_cache_slot(path, {}, 4400);
+        CHECK_EQ(cache.parse(*tool, tool_args).get_one_value<int>("id"), 7);
+        CHECK_EQ(cache.stats().misses, 2);
+    }
+    unlink(path.c_str());
+    unlink(key_path.c_str());
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_compile)
+{
+    auto opt_arg = Arg::new_arg(ArgType::OPTIONAL)->long_name("optarg");
+    auto sub = Command::new_command("mygrep");
+    auto cmd = Command::new_command("my_command")->arg(opt_arg)->subcommand(sub);
+
+    CHECK_THOW(cmd->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("optarg")), ParseArgsError);
+    CHECK_THOW(cmd->arg(opt_arg), ParseArgsError);
+
+    CHECK_EQ(cmd->is_compiled(), false);
+    cmd->compile();
+    CHECK_EQ(cmd->is_compiled(), true);
+    CHECK_EQ(sub->is_compiled(), true);
+    CHECK_NO_THOW(cmd->compile());
+
+    // 编译之后命令及其参数、子命令都不能再被修改
+    CHECK_THOW(cmd->arg(Arg::new_arg(ArgType::FLAG)->long_name("flag_arg")), ParseArgsError);
+    CHECK_THOW(cmd->related_group({"optarg"}), ParseArgsError);
+    CHECK_THOW(cmd->subcommand(Command::new_command("myfind")), ParseArgsError);
+    CHECK_THOW(sub->arg(Arg::new_arg(ArgType::FLAG)->long_name("flag_arg")), ParseArgsError);
+    CHECK_THOW(opt_arg->default_value("1"), ParseArgsError);
+
+    // 第一次解析时自动编译
+    auto cmd2 = Command::new_command("my_command")->arg(Arg::new_arg(ArgType::FLAG)->long_name("flag_arg"));
+    for (int i = 0; i < 3; i++) {
+        cmd2->parse_args({"my_command", "--flag_arg"});
+        CHECK_EQ(cmd2->is_compiled(), true);
+        CHECK_EQ(cmd2->has_arg("flag_arg"), true);
+        CHECK_THOW(cmd2->parse_args({"my_command", "--help"}), ParseArgsError);
+    }
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_perfect_hash_table)
+{
+    std::vector<std::string> storage;
+    for (int i = 0; i < 3000; i++) {
+        storage.push_back("name_" + std::to_string(i * 7919));
+    }
+    std::vector<std::string_view> names(storage.begin(), storage.end());
+    std::vector<int32_t> values;
+    for (int i = 0; i < 3000; i++) {
+        values.push_back(i);
+    }
+
+    internel::PerfectHashTable table;
+    CHECK_EQ(table.find("name_0"), -1);
+    CHECK_EQ(table.build(names, values), true);
+    CHECK_EQ(table.size(), 3000u);
+    int mismatch_count = 0;
+    for (int i = 0; i < 3000; i++) {
+        mismatch_count += table.find(names[i]) != i;
+        mismatch_count += table.find(names[i], internel::hash_name(names[i], table.seed())) != i;
+    }
+    CHECK_EQ(mismatch_count, 0);
+    CHECK_EQ(table.find("name_1"), -1);
+    CHECK_EQ(table.find(""), -1);
+    CHECK_EQ(table.find("name_00"), -1);
+
+    names.push_back("name_0");
+    values.push_back(3000);
+    CHECK_EQ(table.build(names, values), false);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_radix_trie)
+{
+    std::vector<std::string_view> names{"verbose", "version", "output", "out", "o", "input"};
+    std::vector<int32_t> values{0, 1, 2, 3, 4, 5};
+
+    internel::RadixTrie trie;
+    CHECK_EQ(trie.find_prefix("verbose"), internel::RadixTrie::NOT_FOUND);
+    CHECK_EQ(trie.build(names, values), true);
+    CHECK_EQ(trie.size(), 6u);
+    CHECK_EQ(trie.find_prefix("verbose"), 0);
+    CHECK_EQ(trie.find_prefix("verb"), 0);
+    CHECK_EQ(trie.find_prefix("versi"), 1);
+    CHECK_EQ(trie.find_prefix("ver"), internel::RadixTrie::AMBIGUOUS);
+    CHECK_EQ(trie.find_prefix("o"), 4);
+    CHECK_EQ(trie.find_prefix("ou"), internel::RadixTrie::AMBIGUOUS);
+    CHECK_EQ(trie.find_prefix("out"), 3);
+    CHECK_EQ(trie.find_prefix("outp"), 2);
+    CHECK_EQ(trie.find_prefix("i"), 5);
+    CHECK_EQ(trie.find_prefix("verbosee"), internel::RadixTrie::NOT_FOUND);
+    CHECK_EQ(trie.find_prefix("x"), internel::RadixTrie::NOT_FOUND);
+
+    std::vector<int32_t> candidates;
+    trie.collect("o", candidates);
+    CHECK_EQ(candidates.size(), 3u);
+    CHECK_EQ(candidates[0], 4);
+    CHECK_EQ(candidates[1], 3);
+    CHECK_EQ(candidates[2], 2);
+
+    names.push_back("out");
+    values.push_back(6);
+    CHECK_EQ(trie.build(names, values), false);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_to_value)
+{
+    CHECK_EQ(internel::to_value<int>("123"), 123);
+    CHECK_EQ(internel::to_value<int>("+123"), 123);
+    CHECK_EQ(internel::to_value<int>("-2147483648"), -2147483648LL);
+    CHECK_EQ(internel::to_value<int64_t>("9223372036854775807"), 9223372036854775807LL);
+    CHECK_EQ(internel::to_value<uint32_t>("4294967295"), 4294967295U);
+    CHECK_EQ(internel::to_value<uint64_t>("18446744073709551615"), 18446744073709551615ULL);
+    CHECK_EQ(internel::to_value<double>("0.1"), 0.1);
+    CHECK_EQ(internel::to_value<double>("-1.5e3"), -1500.0);
+    CHECK_EQ(internel::to_value<float>("3.14"), 3.14f);
+    CHECK_EQ(internel::to_value<std::string_view>("abc"), "abc");
+
+    // 非法的数字：空字符串、多余的字符、空白、多个符号、无符号类型的负数
+    CHECK_THOW(internel::to_value<int>(""), ParseArgsError);
+    CHECK_THOW(internel::to_value<int>("12abc"), ParseArgsError);
+    CHECK_THOW(internel::to_value<int>(" 12"), ParseArgsError);
+    CHECK_THOW(internel::to_value<int>("+-12"), ParseArgsError);
+    CHECK_THOW(internel::to_value<int>("1.5"), ParseArgsError);
+    CHECK_THOW(internel::to_value<uint32_t>("-1"), ParseArgsError);
+    CHECK_THOW(internel::to_value<double>("1.5x"), ParseArgsError);
+
+    // 超出范围
+    CHECK_THOW(internel::to_value<int>("2147483648"), ParseArgsError);
+    CHECK_THOW(internel::to_value<uint32_t>("4294967296"), ParseArgsError);
+    CHECK_THOW(internel::to_value<double>("1e400"), ParseArgsError);
+
+    std::string error;
+    try {
+        internel::to_value<int>("12abc");
+    } catch (const ParseArgsError &e) {
+        error = e.what();
+    }
+    CHECK_EQ(error, "The value '12abc' is not a valid int.");
+
+    int value = 0;
+    CHECK_EQ(internel::try_to_number(std::string_view("42x", 2), value) == internel::ConvertResult::OK, true);
+    CHECK_EQ(value, 42);
+    CHECK_EQ(internel::try_to_number("99999999999", value) == internel::ConvertResult::OUT_OF_RANGE, true);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_parsed_value)
+{
+    internel::ParsedValue negative("-42");
+    CHECK_EQ(negative.is_int(), true);
+    CHECK_EQ(negative.is_uint(), false);
+    CHECK_EQ(negative.is_double(), true);
+    CHECK_EQ(negative.get<int>(), -42);
+    CHECK_EQ(negative.get<double>(), -42.0);
+    CHECK_THOW(negative.get<uint32_t>(), ParseArgsError);
+
+    internel::ParsedValue big("18446744073709551615");
+    CHECK_EQ(big.is_int(), false);
+    CHECK_EQ(big.get<uint64_t>(), 18446744073709551615ULL);
+    CHECK_THOW(big.get<int64_t>(), ParseArgsError);
+    CHECK_THOW(big.get<uint32_t>(), ParseArgsError);
+
+    internel::ParsedValue real("2.5");
+    CHECK_EQ(real.is_int(), false);
+    CHECK_EQ(real.get<double>(), 2.5);
+    CHECK_EQ(real.get<float>(), 2.5f);
+    CHECK_THOW(real.get<int>(), ParseArgsError);
+
+    internel::ParsedValue text("abc");
+    CHECK_EQ(text.is_int() || text.is_uint() || text.is_double(), false);
+    CHECK_EQ(text.get<std::string_view>(), "abc");
+    CHECK_THOW(text.get<double>(), ParseArgsError);
+
+    // 默认值在设置时就已经转换好
+    auto cmd = Command::new_command("my_command")
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("ratio")->default_value("0.75"))
+                   ->arg(Arg::new_arg(ArgType::OPTIONAL)->long_name("sizes")->default_values({"1", "2", "3"}));
+    ParseResult result = cmd->parse({"my_command"});
+    CHECK_EQ(result.get_one_value<double>("ratio"), 0.75);
+    CHECK_ARRAY_EQ(result.get_many_values<uint64_t>("sizes"), (std::vector<uint64_t>{1, 2, 3}));
+    result = cmd->parse({"my_command", "--ratio", "1e3", "--sizes", "7"});
+    CHECK_EQ(result.get_one_value<double>("ratio"), 1000.0);
+    CHECK_EQ(result.get_one_value<int>("sizes"), 7);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_small_vector)
+{
+    CountingResource counting;
+    {
+        // 不超过内联容量时不分配内存
+        internel::SmallVector<int, 2> values(&counting);
+        CHECK_EQ(values.empty(), true);
+        values.push_back(1);
+        values.push_back(2);
+        CHECK_EQ(counting.allocations, 0);
+
+        // 超过内联容量后从内存资源分配
+        values.push_back(3);
+        CHECK_EQ(counting.allocations, 1);
+        CHECK_ARRAY_EQ(std::vector<int>(values.begin(), values.end()), (std::vector<int>{1, 2, 3}));
+
+        // 移动时接管对方的内存，拷贝时按元素复制
+        internel::SmallVector<int, 2> moved(std::move(values));
+        CHECK_EQ(values.empty(), true);
+        CHECK_EQ(moved.size(), 3);
+        CHECK_EQ(counting.allocations, 1);
+        internel::SmallVector<int, 2> copied(moved);
+        CHECK_EQ(copied[2], 3);
+        CHECK_EQ(counting.allocations, 2);
+
+        // 清空后复用之前分配的内存
+        moved.clear();
+        moved.assign(4, 7);
+        CHECK_EQ(moved.size(), 4);
+        CHECK_EQ(moved[3], 7);
+        CHECK_EQ(counting.allocations, 2);
+
+        internel::SmallVector<int, 2> small(&counting);
+        small.push_back(5);
+        copied = std::move(small);
+        CHECK_EQ(copied.size(), 1);
+        CHECK_EQ(copied[0], 5);
+    }
+    CHECK_EQ(counting.deallocations, counting.allocations);
+}
+
+ADD_UNIT_TEST_CASE(argparse, test_many_options)
+{
+    std::vector<std::string> names;
+    for (int i = 0; i < 2000; i++) {
+        names.push_back("option_" + std::to_string(i));
+    }
+    auto cmd = Command::new_command("my_command");
+    for (int i = 0; i < 2000; i++) {
+        auto arg = Arg::new_arg(ArgType::OPTIONAL)->long_name(names[i].c_str());
+        if (i < 26) {
+            arg->short_name(static_cast<char>('A' + i));
+        }
+        cmd->arg(arg);
+    }
+
+    std::vector<std::string> values;
+    std::vector<const char *> args{"my_command"};
+    for (int i = 0; i < 2000; i += 37) {
+        values.push_back("--" + names[i] + "=" + std::to_string(i));
+    }
+    values.push_back("-Z");
+    values.push_back("25");
+    for (const auto &value : values) {
+        args.push_back(value.c_str());
+    }
+    ParseResult result = cmd->parse(args);
+
+    int mismatch_count = 0;
+    for (int i = 0; i < 2000; i++) {
+        bool expected_hit = i % 37 == 0 || i == 25;
+        mismatch_count += result.has_arg(names[i].c_str()) != expected_hit;
+        if (expected_hit) {
+            mismatch_count += result.get_one_value<int>(names[i].c_str()) != i;
+        }
+    }
+    CHECK_EQ(mismatch_count, 0);
+    CHECK_EQ(result.get_one_value<int>('Z'), 25);
+    CHECK_EQ(result.has_arg('Y'), false);
+    CHECK_EQ(result.has_arg("option_2000"), false);
+
+    result = cmd->parse({"my_command", "--option_199=1", "--option_1999", "2"});
+    CHECK_EQ(result.get_one_value<int>("option_199"), 1);
+    CHECK_EQ(result.get_one_value<int>("option_1999"), 2);
+    CHECK_THOW(cmd->parse({"my_command", "--option_=1"}), ParseArgsError);
+}
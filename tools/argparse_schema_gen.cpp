@@ -0,0 +1,248 @@
+// 二进制命令描述的生成器
+//
+// 在构建时把文本格式的命令描述转换为二进制描述（参看 `SchemaBlob`），运行时直接在二进制描述上解析参数，
+// 不需要在每次启动时通过 `Command::arg`、`Command::subcommand` 等构造命令。
+//
+// 使用方式：
+//     argparse_schema_gen <描述文件> <输出文件>
+//         输出二进制描述，运行时通过 `SchemaBlob::load` 使用
+//     argparse_schema_gen <描述文件> <输出文件> --source <符号>
+//         输出 C++ 源文件，链接到程序中，运行时通过 `SchemaBlob::from_memory(符号, 符号_size)` 使用
+// 在 CMake 中可以通过 `add_custom_command` 调用，例如：
+//     add_custom_command(OUTPUT my_tool_schema.cpp
+//                        COMMAND argparse_schema_gen ${CMAKE_CURRENT_SOURCE_DIR}/my_tool.schema
+//                                my_tool_schema.cpp --source my_tool_schema
+//                        DEPENDS argparse_schema_gen my_tool.schema)
+//
+// 描述文件的格式，每行一条指令，`#` 开头的行是注释，名字为 `-` 表示没有这个名字：
+//     command my_tool                     根命令，必须是第一条指令
+//     usage Usage: my_tool [options]      当前命令的帮助信息，可以有多行
+//     arg OPTIONAL batch_size b 32 64     参数：类型、长名字、短名字、默认值（可以有多个）
+//     arg FLAG verbose -
+//     arg POSITION
+//     conflicts_with_all verbose          与所有参数互斥的参数
+//     related_group a b                   参数组，名字为长名字或短名字
+//     conflict_group a b
+//     one_required_group a b
+//     command my_tool sub                 子命令，给出从根命令开始的完整路径，之后的指令都作用于这个子命令
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "argparse.h"
+
+using namespace zul;
+
+namespace {
+
+// 描述中的名字、帮助信息被 `Command`、`Arg` 以指针的形式保存，需要在整个生成过程中保持有效
+std::deque<std::string> g_names;
+std::deque<std::vector<const char *>> g_usages;
+
+const char *keep_name(const std::string &name)
+{
+    g_names.push_back(name);
+    return g_names.back().c_str();
+}
+
+bool parse_arg_type(const std::string &text, ArgType &type)
+{
+    static const std::map<std::string, ArgType> types = {{"FLAG", ArgType::FLAG},
+                                                         {"REQUIRED", ArgType::REQUIRED},
+                                                         {"OPTIONAL", ArgType::OPTIONAL},
+                                                         {"POSITION", ArgType::POSITION}};
+    auto it = types.find(text);
+    if (it == types.end()) {
+        return false;
+    }
+    type = it->second;
+    return true;
+}
+
+// 解析描述文件，返回根命令，出错时输出错误信息并返回空
+std::shared_ptr<Command> load_description(const char *path)
+{
+    std::ifstream input(path);
+    if (!input) {
+        std::cerr << "Can not open description file '" << path << "'." << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<Command> root;
+    std::shared_ptr<Command> current;
+    // 命令的完整路径（以空格分隔） -> 命令
+    std::map<std::string, std::shared_ptr<Command>> commands;
+    // 当前命令的长名字、短名字 -> 参数
+    std::map<std::string, std::shared_ptr<Arg>> args;
+    // 当前命令的帮助信息
+    std::vector<const char *> *usage = nullptr;
+
+    std::string line;
+    for (size_t line_number = 1; std::getline(input, line); line_number++) {
+        std::istringstream words(line);
+        std::string directive;
+        if (!(words >> directive) || directive[0] == '#') {
+            continue;
+        }
+        // 指令之后的全部内容，去掉一个分隔的空格
+        std::string rest;
+        std::getline(words, rest);
+        if (!rest.empty() && rest[0] == ' ') {
+            rest.erase(0, 1);
+        }
+        std::vector<std::string> operands;
+        std::istringstream operand_words(rest);
+        for (std::string word; operand_words >> word;) {
+            operands.push_back(word);
+        }
+        auto fail = [&](const char *reason) {
+            std::cerr << path << ":" << line_number << ": " << reason << std::endl;
+            return nullptr;
+        };
+
+        if (directive == "command") {
+            if (operands.empty()) {
+                return fail("Missing command name.");
+            }
+            std::string full_path;
+            for (const std::string &operand : operands) {
+                full_path.append(full_path.empty() ? "" : " ").append(operand);
+            }
+            if (root == nullptr) {
+                if (operands.size() != 1) {
+                    return fail("The first command should be the root command.");
+                }
+                root = current = Command::new_command(keep_name(operands[0]));
+            } else {
+                std::string parent_path = full_path.substr(0, full_path.rfind(' '));
+                auto parent = commands.find(parent_path);
+                if (operands.size() < 2 || parent == commands.end() || commands.count(full_path) == 1) {
+                    return fail("The parent command does not exist or the command is duplicate.");
+                }
+                current = Command::new_command(keep_name(operands.back()));
+                parent->second->subcommand(current);
+            }
+            commands[full_path] = current;
+            args.clear();
+            g_usages.emplace_back();
+            usage = &g_usages.back();
+            continue;
+        }
+        if (current == nullptr) {
+            return fail("The first directive should be command.");
+        }
+
+        if (directive == "usage") {
+            usage->push_back(keep_name(rest));
+            current->usage(usage->data(), usage->size());
+        } else if (directive == "arg") {
+            ArgType type;
+            if (operands.empty() || !parse_arg_type(operands[0], type)) {
+                return fail("Invalid argument type.");
+            }
+            std::shared_ptr<Arg> arg = Arg::new_arg(type);
+            if (type != ArgType::POSITION) {
+                if (operands.size() < 3) {
+                    return fail("Missing long name or short name.");
+                }
+                if (operands[1] != "-") {
+                    arg->long_name(keep_name(operands[1]));
+                    args[operands[1]] = arg;
+                }
+                if (operands[2] != "-") {
+                    if (operands[2].size() != 1) {
+                        return fail("The short name should be a single character.");
+                    }
+                    arg->short_name(operands[2][0]);
+                    args[operands[2]] = arg;
+                }
+                std::vector<const char *> default_values;
+                for (size_t i = 3; i < operands.size(); i++) {
+                    default_values.push_back(keep_name(operands[i]));
+                }
+                if (!default_values.empty()) {
+                    arg->default_values(std::move(default_values));
+                }
+            }
+            current->arg(arg);
+        } else if (directive == "conflicts_with_all") {
+            if (operands.size() != 1 || args.count(operands[0]) == 0) {
+                return fail("Unknown argument.");
+            }
+            args[operands[0]]->conflicts_with_all();
+        } else if (directive == "related_group" || directive == "conflict_group" ||
+                   directive == "one_required_group") {
+            std::vector<const char *> names;
+            for (const std::string &operand : operands) {
+                names.push_back(keep_name(operand));
+            }
+            if (directive == "related_group") {
+                current->related_group(std::move(names));
+            } else if (directive == "conflict_group") {
+                current->conflict_group(std::move(names));
+            } else {
+                current->one_required_group(std::move(names));
+            }
+        } else {
+            return fail("Unknown directive.");
+        }
+    }
+    if (root == nullptr) {
+        std::cerr << path << ": Missing root command." << std::endl;
+    }
+    return root;
+}
+
+bool write_source(const std::string &blob, const char *output, const char *symbol)
+{
+    std::ofstream out(output);
+    if (!out) {
+        return false;
+    }
+    out << "// 由 argparse_schema_gen 生成，不要手动修改\n";
+    out << "#include <cstddef>\n\n";
+    out << "alignas(8) extern const unsigned char " << symbol << "[] = {";
+    for (size_t i = 0; i < blob.size(); i++) {
+        out << (i % 16 == 0 ? "\n    " : " ") << static_cast<unsigned>(static_cast<unsigned char>(blob[i])) << ",";
+    }
+    out << "\n};\n";
+    out << "extern const size_t " << symbol << "_size = " << blob.size() << ";\n";
+    return static_cast<bool>(out);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    bool is_source = argc == 5 && std::string(argv[3]) == "--source";
+    if (argc != 3 && !is_source) {
+        std::cerr << "Usage: " << argv[0] << " <description> <output> [--source <symbol>]" << std::endl;
+        return 1;
+    }
+
+    std::shared_ptr<Command> root = load_description(argv[1]);
+    if (root == nullptr) {
+        return 1;
+    }
+    std::string blob = root->serialize_schema();
+
+    bool ok = false;
+    if (is_source) {
+        ok = write_source(blob, argv[2], argv[4]);
+    } else {
+        std::ofstream out(argv[2], std::ios::binary);
+        ok = static_cast<bool>(out.write(blob.data(), static_cast<std::streamsize>(blob.size())));
+    }
+    if (!ok) {
+        std::cerr << "Can not write '" << argv[2] << "'." << std::endl;
+        return 1;
+    }
+    return 0;
+}